@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""比较两次微基准测试的JSON结果 标记性能回退
+
+用法:
+    ./bin/microbench --json base.json --repetitions 5
+    (修改代码 重新编译)
+    ./bin/microbench --json new.json --repetitions 5
+    python3 bench/compare.py base.json new.json [--threshold 0.10]
+
+耗时(real_time)增加超过阈值的项标记为REGRESSION 减少超过阈值的标记为improved；
+allocs/req等附加计数增加时同样标记为回退。存在回退时退出码为1 便于在脚本中使用。
+也可以直接比较Google Benchmark的--benchmark_out输出。
+"""
+
+import argparse
+import json
+import sys
+
+KNOWN_FIELDS = {"name", "iterations", "real_time", "cpu_time", "time_unit",
+                "bytes_per_second", "items_per_second", "run_name", "run_type",
+                "repetitions", "repetition_index", "threads", "family_index",
+                "per_family_instance_index", "aggregate_name", "aggregate_unit"}
+
+UNIT_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    for bench in data.get("benchmarks", []):
+        if bench.get("run_type") == "aggregate":
+            continue
+        ns = bench["real_time"] * UNIT_NS.get(bench.get("time_unit", "ns"), 1.0)
+        counters = {k: v for k, v in bench.items()
+                    if k not in KNOWN_FIELDS and isinstance(v, (int, float))}
+        results[bench["name"]] = (ns, counters)
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compare two microbench JSON results")
+    parser.add_argument("baseline")
+    parser.add_argument("contender")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative change treated as significant (default 0.10)")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    new = load(args.contender)
+
+    regressions = 0
+    print("%-44s %14s %14s %9s" % ("benchmark", "base ns/op", "new ns/op", "change"))
+    for name in base:
+        if name not in new:
+            print("%-44s %14.2f %14s %9s" % (name, base[name][0], "-", "removed"))
+            continue
+        old_ns, old_counters = base[name]
+        new_ns, new_counters = new[name]
+        change = (new_ns - old_ns) / old_ns if old_ns > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            flag = "improved"
+        print("%-44s %14.2f %14.2f %+8.1f%% %s" % (name, old_ns, new_ns, change * 100, flag))
+
+        for key, old_value in old_counters.items():
+            new_value = new_counters.get(key)
+            if new_value is None or new_value == old_value:
+                continue
+            counter_flag = ""
+            if new_value > old_value * (1 + args.threshold) and new_value - old_value > 1e-9:
+                counter_flag = "REGRESSION"
+                regressions += 1
+            print("%-44s %14.2f %14.2f %9s %s" % ("  " + key, old_value, new_value, "", counter_flag))
+
+    for name in new:
+        if name not in base:
+            print("%-44s %14s %14.2f %9s" % (name, "-", new[name][0], "added"))
+
+    print("\n%d regression(s) over %.0f%% threshold" % (regressions, args.threshold * 100))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,131 @@
+#include "../../code/buffer/buffer.h"
+#include "../../code/http/httprequest.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * HttpRequest的请求头与请求体划分的模糊测试
+ * 以FUZZ_LIBFUZZER构建时是libFuzzer的目标 否则自带main 先检查固定的走私用例 再运行随机变异的请求
+ * 每个输入检查: 一次收到与逐字节收到时 解析结果与请求结束后剩余的字节数相同
+ */
+namespace
+{
+struct Result
+{
+    HttpRequest::HTTP_CODE code;
+    size_t rest; // 请求结束后缓冲区中剩余的字节 即下一个请求的开头
+};
+
+Result Parse(const char *data, size_t size, size_t slice)
+{
+    HttpRequest request;
+    Buffer buff(0);
+    HttpRequest::HTTP_CODE code = HttpRequest::NO_REQUEST;
+    size_t appended = 0;
+    while (appended < size && code == HttpRequest::NO_REQUEST)
+    {
+        size_t len = std::min(slice, size - appended);
+        buff.Append(data + appended, len);
+        appended += len;
+        code = request.parse(buff);
+    }
+    return {code, size - (appended - buff.ReadableBytes())};
+}
+
+void Fail(const char *what, const uint8_t *data, size_t size)
+{
+    fprintf(stderr, "httprequest_fuzz: %s, input(%zu): %.*s\n", what, size, (int)size, (const char *)data);
+    abort();
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    Result whole = Parse((const char *)data, size, size ? size : 1);
+    Result bytes = Parse((const char *)data, size, 1);
+    if (whole.code != bytes.code || (whole.code == HttpRequest::GET_REQUEST && whole.rest != bytes.rest))
+    {
+        Fail("framing depends on how the request arrives", data, size);
+    }
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+// 没有libFuzzer时的驱动 用法: httprequest_fuzz [迭代次数] [随机种子]
+int main(int argc, char *argv[])
+{
+    // 前端与本服务器可能对请求体划分不同的请求一律400 合法的请求之后剩余的是下一个请求
+    static const struct
+    {
+        const char *request;
+        HttpRequest::HTTP_CODE code;
+        size_t rest;
+    } cases[] = {
+        {"POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 10\r\n\r\nhelloGET / HTTP/1.1\r\n\r\n",
+         HttpRequest::BAD_REQUEST, 0},
+        {"POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\nhelloGET / HTTP/1.1\r\n\r\n",
+         HttpRequest::GET_REQUEST, 18},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n",
+         HttpRequest::BAD_REQUEST, 0},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 3\r\n\r\n0\r\n\r\n",
+         HttpRequest::BAD_REQUEST, 0},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\nGET / HTTP/1.1\r\n\r\n",
+         HttpRequest::GET_REQUEST, 18},
+        {"POST / HTTP/1.1\r\nContent-Length : 10\r\n\r\n0123456789", HttpRequest::BAD_REQUEST, 0},
+        {"POST / HTTP/1.1\r\nTransfer-Encoding\t: chunked\r\n\r\n0\r\n\r\n", HttpRequest::BAD_REQUEST, 0},
+        {"POST / HTTP/1.1\r\n Content-Length: 10\r\n\r\n0123456789", HttpRequest::BAD_REQUEST, 0},
+        {"GET / HTTP/1.1\r\nX Forwarded: a\r\n\r\n", HttpRequest::BAD_REQUEST, 0},
+        {"GET / HTTP/1.1\r\n: a\r\n\r\n", HttpRequest::BAD_REQUEST, 0},
+        {"GET / HTTP/1.1\r\nX-Ok_Header.1~: a : b\r\nHost:x\r\n\r\n", HttpRequest::GET_REQUEST, 0},
+    };
+    for (const auto &c : cases)
+    {
+        size_t size = strlen(c.request);
+        Result result = Parse(c.request, size, size);
+        if (result.code != c.code || (c.code == HttpRequest::GET_REQUEST && result.rest != c.rest))
+        {
+            fprintf(stderr, "httprequest_fuzz: expected code %d rest %zu, got code %d rest %zu\n", (int)c.code, c.rest,
+                    (int)result.code, result.rest);
+            Fail("unexpected framing", (const uint8_t *)c.request, size);
+        }
+        LLVMFuzzerTestOneInput((const uint8_t *)c.request, size);
+    }
+
+    long iterations = argc > 1 ? atol(argv[1]) : 20000;
+    unsigned seed = argc > 2 ? (unsigned)atol(argv[2]) : 1;
+    srand(seed);
+    // 在固定用例上随机替换、插入、删除字节 偏向划分请求体相关的字符
+    static const char alphabet[] = " \t:\r\n0123456789abcdef-;,";
+    std::string input;
+    for (long i = 0; i < iterations; i++)
+    {
+        input = cases[rand() % (sizeof(cases) / sizeof(cases[0]))].request;
+        for (int n = rand() % 4 + 1; n > 0 && !input.empty(); n--)
+        {
+            size_t pos = rand() % input.size();
+            char ch = rand() % 4 ? alphabet[rand() % (sizeof(alphabet) - 1)] : (char)rand();
+            switch (rand() % 3)
+            {
+            case 0:
+                input[pos] = ch;
+                break;
+            case 1:
+                input.insert(pos, 1, ch);
+                break;
+            default:
+                input.erase(pos, 1);
+                break;
+            }
+        }
+        LLVMFuzzerTestOneInput((const uint8_t *)input.data(), input.size());
+    }
+    printf("httprequest_fuzz: %zu framing cases, %ld mutated requests (seed %u) passed\n",
+           sizeof(cases) / sizeof(cases[0]), iterations, seed);
+    return 0;
+}
+#endif
@@ -0,0 +1,206 @@
+#include "../../code/http/urlencoded.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * UrlEncoded的模糊测试
+ * 以FUZZ_LIBFUZZER构建时是libFuzzer的目标 否则自带main 运行边界用例与随机输入
+ * 每个输入检查:
+ *   Decode与逐字节的参考实现结果一致 不读写输入之外的内存
+ *   Parse的每个字段都指向输入内部 与参考切分、解码的结果一致
+ *   任意键值编码后再解析得到原值
+ */
+namespace
+{
+void Fail(const char *what, const uint8_t *data, size_t size)
+{
+    fprintf(stderr, "urlencoded_fuzz: %s, input(%zu):", what, size);
+    for (size_t i = 0; i < size; i++)
+    {
+        fprintf(stderr, " %02x", data[i]);
+    }
+    fprintf(stderr, "\n");
+    abort();
+}
+
+int RefHex(char ch)
+{
+    unsigned char c = ch;
+    if (!isxdigit(c))
+    {
+        return -1;
+    }
+    return isdigit(c) ? c - '0' : tolower(c) - 'a' + 10;
+}
+
+// 参考解码 '+'为空格 完整的%XX为字节 其余原样保留
+std::string RefDecode(const std::string &in)
+{
+    std::string out;
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        if (in[i] == '+')
+        {
+            out += ' ';
+        }
+        else if (in[i] == '%' && i + 2 < in.size() && RefHex(in[i + 1]) >= 0 && RefHex(in[i + 2]) >= 0)
+        {
+            out += (char)(RefHex(in[i + 1]) * 16 + RefHex(in[i + 2]));
+            i += 2;
+        }
+        else
+        {
+            out += in[i];
+        }
+    }
+    return out;
+}
+
+std::string Encode(const std::string &in)
+{
+    static const char *hex = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char ch : in)
+    {
+        if (ch == ' ')
+        {
+            out += '+';
+        }
+        else if (isalnum(ch) || ch == '-' || ch == '.' || ch == '_' || ch == '~')
+        {
+            out += (char)ch;
+        }
+        else
+        {
+            out += '%';
+            out += hex[ch >> 4];
+            out += hex[ch & 15];
+        }
+    }
+    return out;
+}
+
+void CheckDecode(const uint8_t *data, size_t size)
+{
+    // 恰好size字节的堆内存 越界读写由ASan报告
+    std::vector<char> buf(data, data + size);
+    size_t len = UrlEncoded::Decode(buf.data(), buf.size());
+    if (len > size)
+    {
+        Fail("Decode grew the input", data, size);
+    }
+    if (std::string(buf.data(), len) != RefDecode(std::string((const char *)data, size)))
+    {
+        Fail("Decode differs from the reference", data, size);
+    }
+}
+
+void CheckParse(const uint8_t *data, size_t size)
+{
+    std::vector<char> buf(data, data + size);
+    UrlEncoded::FieldList fields;
+    UrlEncoded::Parse(buf.data(), buf.size(), fields);
+
+    // 参考切分 空片段忽略 第一个'='分隔键值
+    std::string in((const char *)data, size);
+    size_t n = 0;
+    for (size_t start = 0; start <= in.size();)
+    {
+        size_t amp = in.find('&', start);
+        size_t end = amp == std::string::npos ? in.size() : amp;
+        if (end > start)
+        {
+            std::string seg = in.substr(start, end - start);
+            size_t eq = seg.find('=');
+            std::string key = RefDecode(seg.substr(0, eq));
+            std::string value = eq == std::string::npos ? "" : RefDecode(seg.substr(eq + 1));
+            if (n >= fields.size())
+            {
+                Fail("Parse dropped a field", data, size);
+            }
+            const UrlEncoded::Field &field = fields[n++];
+            for (std::string_view view : {field.first, field.second})
+            {
+                if (view.size() && (view.data() < buf.data() || view.data() + view.size() > buf.data() + buf.size()))
+                {
+                    Fail("Parse field points outside the input", data, size);
+                }
+            }
+            if (field.first != key || field.second != value)
+            {
+                Fail("Parse differs from the reference", data, size);
+            }
+        }
+        start = end + 1;
+    }
+    if (n != fields.size())
+    {
+        Fail("Parse produced extra fields", data, size);
+    }
+}
+
+// 输入的前一半作为键 后一半作为值 编码后解析应还原
+void CheckRoundTrip(const uint8_t *data, size_t size)
+{
+    std::string key((const char *)data, size / 2);
+    std::string value((const char *)data + size / 2, size - size / 2);
+    std::string form = "a=b&" + Encode(key) + "=" + Encode(value) + "&";
+    UrlEncoded::FieldList fields;
+    UrlEncoded::Parse(&form[0], form.size(), fields);
+    std::string_view found;
+    if (fields.size() != 2 || fields[1].first != key || fields[1].second != value ||
+        !UrlEncoded::Find(fields, "a", found) || found != "b")
+    {
+        Fail("round trip failed", data, size);
+    }
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    CheckDecode(data, size);
+    CheckParse(data, size);
+    CheckRoundTrip(data, size);
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+// 没有libFuzzer时的驱动 用法: urlencoded_fuzz [迭代次数] [随机种子]
+int main(int argc, char *argv[])
+{
+    // 截断的转义、'+'与'='的边界
+    static const char *edges[] = {
+        "", "%", "a%", "a=%", "%4", "a=%4", "%4g", "%g4", "%%41", "%41%", "%414", "%2B", "%3D=%26",
+        "+", "++", "a+b=c+d", "=", "==", "a==b", "=a", "a=", "&", "&&=&", "a&b=&=c", "%00=%ff",
+    };
+    for (const char *edge : edges)
+    {
+        LLVMFuzzerTestOneInput((const uint8_t *)edge, strlen(edge));
+    }
+
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    unsigned seed = argc > 2 ? (unsigned)atol(argv[2]) : 1;
+    srand(seed);
+    // 偏向特殊字符的字母表 更容易碰到截断的转义
+    static const char alphabet[] = "%%%++==&&09afAFgGz ";
+    std::vector<uint8_t> input;
+    for (long i = 0; i < iterations; i++)
+    {
+        input.resize(rand() % 24);
+        for (uint8_t &byte : input)
+        {
+            byte = rand() % 8 ? alphabet[rand() % (sizeof(alphabet) - 1)] : (uint8_t)rand();
+        }
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    printf("urlencoded_fuzz: %zu edge cases, %ld random inputs (seed %u) passed\n", sizeof(edges) / sizeof(edges[0]),
+           iterations, seed);
+    return 0;
+}
+#endif
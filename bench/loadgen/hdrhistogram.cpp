@@ -0,0 +1,93 @@
+#include "hdrhistogram.h"
+
+#include <algorithm>
+
+namespace
+{
+const uint64_t SUB_BUCKET_HALF_COUNT = 1ull << HdrHistogram::SUB_BUCKET_HALF_MAGNITUDE;
+const uint64_t SUB_BUCKET_MASK = (SUB_BUCKET_HALF_COUNT << 1) - 1;
+const int BUCKET_COUNT = HdrHistogram::MAX_MAGNITUDE - HdrHistogram::SUB_BUCKET_HALF_MAGNITUDE;
+const uint64_t HIGHEST_VALUE = (1ull << HdrHistogram::MAX_MAGNITUDE) - 1;
+} // namespace
+
+HdrHistogram::HdrHistogram() : counts_((BUCKET_COUNT + 1) * SUB_BUCKET_HALF_COUNT)
+{
+    Reset();
+}
+
+// 桶号为最高位超出子桶范围的位数 子桶号为去掉这些低位后的值
+size_t HdrHistogram::Index_(uint64_t value)
+{
+    int bucket = 63 - __builtin_clzll(value | SUB_BUCKET_MASK) - SUB_BUCKET_HALF_MAGNITUDE;
+    uint64_t subBucket = value >> bucket;
+    return ((size_t)bucket << SUB_BUCKET_HALF_MAGNITUDE) + subBucket;
+}
+
+uint64_t HdrHistogram::HighestEquivalent_(size_t index)
+{
+    // 0号桶的子桶覆盖[0, 2*HALF) 之后每个桶只使用上半部分子桶
+    int bucket = (int)(index >> SUB_BUCKET_HALF_MAGNITUDE) - 1;
+    uint64_t subBucket = (index & (SUB_BUCKET_HALF_COUNT - 1)) + SUB_BUCKET_HALF_COUNT;
+    if (bucket < 0)
+    {
+        bucket = 0;
+        subBucket -= SUB_BUCKET_HALF_COUNT;
+    }
+    return (subBucket << bucket) + (1ull << bucket) - 1;
+}
+
+void HdrHistogram::Record(uint64_t value)
+{
+    value = std::min(value, HIGHEST_VALUE);
+    counts_[Index_(value)]++;
+    total_++;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += value;
+}
+
+void HdrHistogram::Merge(const HdrHistogram &other)
+{
+    for (size_t i = 0; i < counts_.size(); i++)
+    {
+        counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+}
+
+void HdrHistogram::Reset()
+{
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+    sum_ = 0;
+}
+
+double HdrHistogram::Mean() const
+{
+    return total_ ? sum_ / total_ : 0;
+}
+
+uint64_t HdrHistogram::Percentile(double percentile) const
+{
+    if (total_ == 0)
+    {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(std::min(percentile, 100.0) / 100 * total_ + 0.5);
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); i++)
+    {
+        seen += counts_[i];
+        if (seen >= target)
+        {
+            return std::min(HighestEquivalent_(i), max_);
+        }
+    }
+    return max_;
+}
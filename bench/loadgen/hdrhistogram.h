@@ -0,0 +1,44 @@
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * HDR(High Dynamic Range)直方图
+ * 按2的幂分桶，每个桶再线性分为SUB_BUCKET_COUNT个子桶，
+ * 在1到2^MAX_MAGNITUDE的范围内保持3位有效数字的精度，记录为O(1)且不分配内存。
+ * 每个压测线程一个实例，结束时合并。
+ */
+class HdrHistogram
+{
+public:
+    HdrHistogram();
+
+    void Record(uint64_t value);
+    void Merge(const HdrHistogram &other);
+    void Reset();
+
+    uint64_t Count() const { return total_; }
+    uint64_t Min() const { return total_ ? min_ : 0; }
+    uint64_t Max() const { return max_; }
+    double Mean() const;
+    // percentile取值0~100 返回该分位所在子桶的上界
+    uint64_t Percentile(double percentile) const;
+
+    static const int SUB_BUCKET_HALF_MAGNITUDE = 10; // 子桶数2048 3位有效数字
+    static const int MAX_MAGNITUDE = 40;             // 以纳秒计约18分钟 超出的值记为上限
+
+private:
+    static size_t Index_(uint64_t value);
+    static uint64_t HighestEquivalent_(size_t index);
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t min_;
+    uint64_t max_;
+    double sum_;
+};
+
+#endif // HDR_HISTOGRAM_H
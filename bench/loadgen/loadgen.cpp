@@ -0,0 +1,602 @@
+/**
+ * HTTP压测工具
+ * M个线程各自用epoll驱动N/M个连接，每个连接保持keep-alive(-C时每个请求新建连接)，
+ * 同时在途的请求数为流水线深度(1为普通的keep-alive)，按权重随机选择请求。
+ * 延迟从请求写入发送队列开始到响应完整结束，记录在HDR直方图中，2xx响应另外单独统计，
+ * 过载时服务器快速拒绝的请求不会拉低正常请求的延迟数据。结束后输出文本或JSON。
+ *
+ * 用法: bench [-a 地址] [-p 端口] [-c 连接数] [-t 线程数] [-d 秒数] [-P 流水线深度] [-C]
+ *             [-r 方法:路径[:权重]]... [-b POST请求体] [-j] [-o JSON文件]
+ * 例:   bench -p 3000 -c 64 -t 4 -d 10 -r GET:/index.html:8 -r GET:/video/xxx.mp4:1 \
+ *             -r POST:/api/login:1 -b "username=a&password=b"
+ */
+#include "hdrhistogram.h"
+#include "responseparser.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+typedef chrono::steady_clock Clock;
+
+namespace
+{
+struct Options
+{
+    string host = "127.0.0.1";
+    int port = 3000;
+    int connections = 64;
+    int threads = 4;
+    int duration = 10;
+    int pipeline = 1;
+    bool close = false; // 每个请求使用新连接
+    string body = "username=bench&password=bench";
+    vector<string> routes;
+    bool json = false;
+    string jsonFile;
+};
+
+// 预先生成的请求报文
+struct Request
+{
+    string method;
+    string path;
+    int weight;
+    string data;
+};
+
+struct Stats
+{
+    HdrHistogram latency; // 纳秒
+    HdrHistogram served;  // 只含2xx响应
+    uint64_t bytes = 0;
+    uint64_t errors = 0;     // 连接失败 读写出错 响应无法解析
+    uint64_t non2xx = 0;     // 状态码不是2xx
+    uint64_t reconnects = 0; // 服务器关闭连接后重连
+    vector<uint64_t> perRoute;
+};
+
+struct Conn
+{
+    int fd = -1;
+    bool connected = false;
+    string out;
+    size_t outOff = 0;
+    deque<pair<size_t, Clock::time_point>> inflight; // 请求下标 写入时间
+    ResponseParser parser;
+    bool wantWrite = false;
+};
+
+class Worker
+{
+public:
+    Worker(const Options &opt, const vector<Request> &requests, const sockaddr_in &addr, int conns, unsigned seed)
+        : opt_(opt), requests_(requests), addr_(addr), conns_(conns), rng_(seed)
+    {
+        stats_.perRoute.assign(requests.size(), 0);
+        for (const Request &req : requests)
+        {
+            totalWeight_ += req.weight;
+        }
+    }
+
+    void Run(Clock::time_point deadline);
+    const Stats &GetStats() const { return stats_; }
+
+private:
+    bool Connect_(Conn &conn);
+    void Close_(Conn &conn, bool error);
+    void Fill_(Conn &conn);
+    bool Flush_(Conn &conn);
+    bool Read_(Conn &conn);
+    void Complete_(Conn &conn);
+    void UpdateEvents_(Conn &conn);
+    size_t Pick_();
+
+    const Options &opt_;
+    const vector<Request> &requests_;
+    sockaddr_in addr_;
+    vector<Conn> conns_;
+    int epfd_ = -1;
+    int totalWeight_ = 0;
+    bool stopping_ = false;
+    mt19937 rng_;
+    Stats stats_;
+};
+
+size_t Worker::Pick_()
+{
+    if (requests_.size() == 1)
+    {
+        return 0;
+    }
+    int r = uniform_int_distribution<int>(0, totalWeight_ - 1)(rng_);
+    for (size_t i = 0; i < requests_.size(); i++)
+    {
+        r -= requests_[i].weight;
+        if (r < 0)
+        {
+            return i;
+        }
+    }
+    return requests_.size() - 1;
+}
+
+bool Worker::Connect_(Conn &conn)
+{
+    conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn.fd < 0)
+    {
+        return false;
+    }
+    int one = 1;
+    setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(conn.fd, (const sockaddr *)&addr_, sizeof(addr_)) < 0 && errno != EINPROGRESS)
+    {
+        close(conn.fd);
+        conn.fd = -1;
+        return false;
+    }
+    conn.connected = false;
+    conn.out.clear();
+    conn.outOff = 0;
+    conn.inflight.clear();
+    conn.parser.Reset();
+    conn.wantWrite = true;
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = &conn;
+    epoll_ctl(epfd_, EPOLL_CTL_ADD, conn.fd, &ev);
+    return true;
+}
+
+void Worker::Close_(Conn &conn, bool error)
+{
+    if (conn.fd >= 0)
+    {
+        epoll_ctl(epfd_, EPOLL_CTL_DEL, conn.fd, nullptr);
+        close(conn.fd);
+        conn.fd = -1;
+    }
+    if (error)
+    {
+        stats_.errors++;
+    }
+    if (!stopping_)
+    {
+        stats_.reconnects++;
+        if (!Connect_(conn))
+        {
+            stats_.errors++;
+        }
+    }
+}
+
+// 补足在途请求到流水线深度
+void Worker::Fill_(Conn &conn)
+{
+    while (!stopping_ && conn.inflight.size() < (size_t)opt_.pipeline)
+    {
+        size_t i = Pick_();
+        conn.out.append(requests_[i].data);
+        conn.inflight.emplace_back(i, Clock::now());
+    }
+}
+
+bool Worker::Flush_(Conn &conn)
+{
+    while (conn.outOff < conn.out.size())
+    {
+        ssize_t n = write(conn.fd, conn.out.data() + conn.outOff, conn.out.size() - conn.outOff);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                break;
+            }
+            return false;
+        }
+        conn.outOff += n;
+    }
+    if (conn.outOff == conn.out.size())
+    {
+        conn.out.clear();
+        conn.outOff = 0;
+    }
+    UpdateEvents_(conn);
+    return true;
+}
+
+void Worker::UpdateEvents_(Conn &conn)
+{
+    bool want = !conn.out.empty();
+    if (want != conn.wantWrite)
+    {
+        conn.wantWrite = want;
+        epoll_event ev = {};
+        ev.events = EPOLLIN | (want ? EPOLLOUT : 0);
+        ev.data.ptr = &conn;
+        epoll_ctl(epfd_, EPOLL_CTL_MOD, conn.fd, &ev);
+    }
+}
+
+// 读取并解析响应 连接需要关闭时返回false
+bool Worker::Read_(Conn &conn)
+{
+    char buf[64 * 1024];
+    for (;;)
+    {
+        ssize_t n = read(conn.fd, buf, sizeof(buf));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN)
+            {
+                return true;
+            }
+            Close_(conn, true);
+            return false;
+        }
+        if (n == 0)
+        {
+            // 没有长度的响应以关闭连接结束 其余情况是服务器中途关闭
+            conn.parser.Eof();
+            bool ok = conn.parser.IsComplete() && conn.inflight.size() == 1;
+            if (ok)
+            {
+                Complete_(conn);
+            }
+            Close_(conn, !ok && !conn.inflight.empty() && !stopping_);
+            return false;
+        }
+
+        size_t off = 0;
+        while (off < (size_t)n)
+        {
+            off += conn.parser.Feed(buf + off, n - off);
+            if (conn.parser.IsError() || (conn.parser.IsComplete() && conn.inflight.empty()))
+            {
+                Close_(conn, true);
+                return false;
+            }
+            if (!conn.parser.IsComplete())
+            {
+                continue;
+            }
+            Complete_(conn);
+            bool close = conn.parser.IsClose();
+            conn.parser.Reset();
+            if (close)
+            {
+                // 其余在途的请求不会再有响应
+                stats_.errors += conn.inflight.size();
+                Close_(conn, false);
+                return false;
+            }
+        }
+        Fill_(conn);
+        if (!Flush_(conn))
+        {
+            Close_(conn, true);
+            return false;
+        }
+    }
+}
+
+// 记录解析完的响应 按状态码区分是否计入served
+void Worker::Complete_(Conn &conn)
+{
+    // 100 Continue之类的临时响应不对应请求
+    if (conn.parser.Status() >= 200)
+    {
+        auto done = conn.inflight.front();
+        conn.inflight.pop_front();
+        uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - done.second).count();
+        stats_.latency.Record(ns);
+        stats_.perRoute[done.first]++;
+        if (conn.parser.Status() >= 300)
+        {
+            stats_.non2xx++;
+        }
+        else
+        {
+            stats_.served.Record(ns);
+        }
+    }
+    stats_.bytes += conn.parser.Bytes();
+}
+
+void Worker::Run(Clock::time_point deadline)
+{
+    epfd_ = epoll_create1(EPOLL_CLOEXEC);
+    for (Conn &conn : conns_)
+    {
+        if (!Connect_(conn))
+        {
+            stats_.errors++;
+        }
+    }
+
+    epoll_event events[256];
+    while (Clock::now() < deadline)
+    {
+        int n = epoll_wait(epfd_, events, 256, 100);
+        for (int i = 0; i < n; i++)
+        {
+            Conn &conn = *static_cast<Conn *>(events[i].data.ptr);
+            if (conn.fd < 0)
+            {
+                continue;
+            }
+            if (!conn.connected)
+            {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(conn.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0)
+                {
+                    Close_(conn, true);
+                    continue;
+                }
+                conn.connected = true;
+                Fill_(conn);
+            }
+            if ((events[i].events & EPOLLIN) && !Read_(conn))
+            {
+                continue;
+            }
+            if ((events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && !Flush_(conn))
+            {
+                Close_(conn, true);
+            }
+        }
+    }
+
+    stopping_ = true;
+    for (Conn &conn : conns_)
+    {
+        Close_(conn, false);
+    }
+    close(epfd_);
+}
+
+bool ParseRoute(const string &spec, const Options &opt, Request &req)
+{
+    // 方法:路径[:权重]
+    size_t first = spec.find(':');
+    if (first == string::npos)
+    {
+        return false;
+    }
+    size_t second = spec.find(':', first + 1);
+    req.method = spec.substr(0, first);
+    req.path = spec.substr(first + 1, second == string::npos ? string::npos : second - first - 1);
+    req.weight = second == string::npos ? 1 : atoi(spec.c_str() + second + 1);
+    if (req.method.empty() || req.path.empty() || req.path[0] != '/' || req.weight <= 0)
+    {
+        return false;
+    }
+
+    req.data = req.method + " " + req.path + " HTTP/1.1\r\n"
+               "Host: " + opt.host + ":" + to_string(opt.port) + "\r\n"
+               "Connection: " + string(opt.close ? "close" : "keep-alive") + "\r\n"
+               "User-Agent: webserver-bench\r\n";
+    if (req.method == "POST")
+    {
+        req.data += "Content-Type: application/x-www-form-urlencoded\r\n"
+                    "Content-Length: " + to_string(opt.body.size()) + "\r\n\r\n" + opt.body;
+    }
+    else
+    {
+        req.data += "\r\n";
+    }
+    return true;
+}
+
+void Usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [-a host] [-p port] [-c connections] [-t threads] [-d seconds]\n"
+            "          [-P pipeline] [-C] [-r METHOD:PATH[:WEIGHT]]... [-b post-body] [-j] [-o json-file]\n",
+            prog);
+}
+
+string ToJson(const Options &opt, const vector<Request> &requests, const Stats &stats, double seconds)
+{
+    const HdrHistogram &lat = stats.latency;
+    const HdrHistogram &ok = stats.served;
+    char buf[1536];
+    snprintf(buf, sizeof(buf),
+             "{\"host\":\"%s\",\"port\":%d,\"connections\":%d,\"threads\":%d,\"pipeline\":%d,\"duration_s\":%.3f,"
+             "\"requests\":%llu,\"errors\":%llu,\"non_2xx\":%llu,\"reconnects\":%llu,\"rps\":%.1f,\"bytes_per_s\":%.1f,"
+             "\"latency_us\":{\"min\":%.1f,\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f},"
+             "\"served_latency_us\":{\"min\":%.1f,\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f},"
+             "\"routes\":[",
+             opt.host.c_str(), opt.port, opt.connections, opt.threads, opt.pipeline, seconds,
+             (unsigned long long)lat.Count(), (unsigned long long)stats.errors, (unsigned long long)stats.non2xx,
+             (unsigned long long)stats.reconnects, lat.Count() / seconds, stats.bytes / seconds,
+             lat.Min() / 1e3, lat.Mean() / 1e3, lat.Percentile(50) / 1e3, lat.Percentile(90) / 1e3,
+             lat.Percentile(99) / 1e3, lat.Percentile(99.9) / 1e3, lat.Max() / 1e3, ok.Min() / 1e3, ok.Mean() / 1e3,
+             ok.Percentile(50) / 1e3, ok.Percentile(90) / 1e3, ok.Percentile(99) / 1e3, ok.Percentile(99.9) / 1e3,
+             ok.Max() / 1e3);
+    string json = buf;
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        snprintf(buf, sizeof(buf), "%s{\"method\":\"%s\",\"path\":\"%s\",\"weight\":%d,\"requests\":%llu}",
+                 i ? "," : "", requests[i].method.c_str(), requests[i].path.c_str(), requests[i].weight,
+                 (unsigned long long)stats.perRoute[i]);
+        json += buf;
+    }
+    json += "]}\n";
+    return json;
+}
+
+void PrintText(const Options &opt, const vector<Request> &requests, const Stats &stats, double seconds)
+{
+    const HdrHistogram &lat = stats.latency;
+    printf("%d connections, %d threads, pipeline %d, %.2fs against %s:%d\n", opt.connections, opt.threads,
+           opt.pipeline, seconds, opt.host.c_str(), opt.port);
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        printf("  %-6s %-32s weight %-3d %llu requests\n", requests[i].method.c_str(), requests[i].path.c_str(),
+               requests[i].weight, (unsigned long long)stats.perRoute[i]);
+    }
+    printf("Requests:   %llu (%.1f req/s, %.2f MB/s)\n", (unsigned long long)lat.Count(), lat.Count() / seconds,
+           stats.bytes / seconds / (1024 * 1024));
+    printf("Errors:     %llu, non-2xx %llu, reconnects %llu\n", (unsigned long long)stats.errors,
+           (unsigned long long)stats.non2xx, (unsigned long long)stats.reconnects);
+    printf("Latency(us) min %.1f  mean %.1f  max %.1f\n", lat.Min() / 1e3, lat.Mean() / 1e3, lat.Max() / 1e3);
+    printf("            p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f\n", lat.Percentile(50) / 1e3,
+           lat.Percentile(90) / 1e3, lat.Percentile(99) / 1e3, lat.Percentile(99.9) / 1e3);
+    if (stats.non2xx)
+    {
+        const HdrHistogram &ok = stats.served;
+        printf("2xx only    p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", ok.Percentile(50) / 1e3,
+               ok.Percentile(90) / 1e3, ok.Percentile(99) / 1e3, ok.Percentile(99.9) / 1e3, ok.Max() / 1e3);
+    }
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    int ch;
+    while ((ch = getopt(argc, argv, "a:p:c:t:d:P:Cr:b:jo:h")) != -1)
+    {
+        switch (ch)
+        {
+        case 'a': opt.host = optarg; break;
+        case 'p': opt.port = atoi(optarg); break;
+        case 'c': opt.connections = atoi(optarg); break;
+        case 't': opt.threads = atoi(optarg); break;
+        case 'd': opt.duration = atoi(optarg); break;
+        case 'P': opt.pipeline = atoi(optarg); break;
+        case 'C': opt.close = true; break;
+        case 'r': opt.routes.push_back(optarg); break;
+        case 'b': opt.body = optarg; break;
+        case 'j': opt.json = true; break;
+        case 'o': opt.jsonFile = optarg; break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.connections <= 0 || opt.threads <= 0 || opt.duration <= 0 || opt.pipeline <= 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    opt.threads = min(opt.threads, opt.connections);
+    if (opt.close)
+    {
+        opt.pipeline = 1; // 服务器响应后关闭连接 流水线中后续的请求没有响应
+    }
+    if (opt.routes.empty())
+    {
+        opt.routes.push_back("GET:/index.html");
+    }
+
+    vector<Request> requests(opt.routes.size());
+    for (size_t i = 0; i < opt.routes.size(); i++)
+    {
+        if (!ParseRoute(opt.routes[i], opt, requests[i]))
+        {
+            fprintf(stderr, "invalid route: %s\n", opt.routes[i].c_str());
+            return 1;
+        }
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    if (inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "invalid address: %s\n", opt.host.c_str());
+        return 1;
+    }
+
+    // 连接平均分配到各个线程
+    vector<unique_ptr<Worker>> workers;
+    for (int i = 0; i < opt.threads; i++)
+    {
+        int conns = opt.connections / opt.threads + (i < opt.connections % opt.threads ? 1 : 0);
+        workers.emplace_back(new Worker(opt, requests, addr, conns, 12345 + i));
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + chrono::seconds(opt.duration);
+    vector<thread> threads;
+    for (auto &worker : workers)
+    {
+        threads.emplace_back([&worker, deadline]() { worker->Run(deadline); });
+    }
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    Stats total;
+    total.perRoute.assign(requests.size(), 0);
+    for (auto &worker : workers)
+    {
+        const Stats &stats = worker->GetStats();
+        total.latency.Merge(stats.latency);
+        total.served.Merge(stats.served);
+        total.bytes += stats.bytes;
+        total.errors += stats.errors;
+        total.non2xx += stats.non2xx;
+        total.reconnects += stats.reconnects;
+        for (size_t i = 0; i < requests.size(); i++)
+        {
+            total.perRoute[i] += stats.perRoute[i];
+        }
+    }
+
+    string json = ToJson(opt, requests, total, seconds);
+    if (opt.json)
+    {
+        fputs(json.c_str(), stdout);
+    }
+    else
+    {
+        PrintText(opt, requests, total, seconds);
+    }
+    if (!opt.jsonFile.empty())
+    {
+        FILE *fp = fopen(opt.jsonFile.c_str(), "w");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "open %s failed: %s\n", opt.jsonFile.c_str(), strerror(errno));
+            return 1;
+        }
+        fputs(json.c_str(), fp);
+        fclose(fp);
+    }
+    return 0;
+}
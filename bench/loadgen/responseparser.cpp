@@ -0,0 +1,209 @@
+#include "responseparser.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+using namespace std;
+
+ResponseParser::ResponseParser()
+{
+    Reset();
+}
+
+void ResponseParser::Reset()
+{
+    state_ = HEADER;
+    header_.clear();
+    line_.clear();
+    remaining_ = 0;
+    bytes_ = 0;
+    status_ = 0;
+    close_ = false;
+}
+
+size_t ResponseParser::Feed(const char *data, size_t len)
+{
+    size_t used = 0;
+    while (used < len && state_ != COMPLETE && state_ != ERROR)
+    {
+        const char *p = data + used;
+        size_t n = len - used;
+        switch (state_)
+        {
+        case HEADER:
+        {
+            // 头部结束符可能跨两次输入 从上次末尾的前3个字节开始查找
+            size_t old = header_.size();
+            header_.append(p, n);
+            size_t end = header_.find("\r\n\r\n", old < 3 ? 0 : old - 3);
+            if (end == string::npos)
+            {
+                used = len;
+                if (header_.size() > MAX_HEADER)
+                {
+                    state_ = ERROR;
+                }
+                break;
+            }
+            header_.resize(end + 4);
+            used += end + 4 - old;
+            if (!ParseHeader_())
+            {
+                state_ = ERROR;
+            }
+            break;
+        }
+        case BODY:
+        case CHUNK_DATA:
+        {
+            size_t take = min(n, remaining_);
+            remaining_ -= take;
+            used += take;
+            if (remaining_ == 0)
+            {
+                state_ = state_ == BODY ? COMPLETE : CHUNK_CRLF;
+            }
+            break;
+        }
+        case UNTIL_CLOSE:
+            used = len;
+            break;
+        default:
+        {
+            size_t take = 0;
+            bool full = ReadLine_(p, n, take);
+            used += take;
+            if (full)
+            {
+                OnLine_();
+            }
+            break;
+        }
+        }
+    }
+    bytes_ += used;
+    return used;
+}
+
+void ResponseParser::Eof()
+{
+    state_ = state_ == UNTIL_CLOSE ? COMPLETE : ERROR;
+}
+
+bool ResponseParser::ParseHeader_()
+{
+    // HTTP/1.1 200 OK
+    if (header_.compare(0, 5, "HTTP/") != 0)
+    {
+        return false;
+    }
+    size_t sp = header_.find(' ');
+    status_ = atoi(header_.c_str() + sp + 1);
+    if (status_ < 100)
+    {
+        return false;
+    }
+
+    bool chunked = false;
+    bool hasLength = false;
+    size_t pos = header_.find("\r\n") + 2;
+    while (pos + 2 < header_.size())
+    {
+        size_t end = header_.find("\r\n", pos);
+        size_t colon = header_.find(':', pos);
+        if (colon < end)
+        {
+            const char *key = header_.c_str() + pos;
+            size_t keyLen = colon - pos;
+            size_t valuePos = header_.find_first_not_of(' ', colon + 1);
+            const char *value = header_.c_str() + valuePos;
+            if (keyLen == 14 && strncasecmp(key, "Content-Length", keyLen) == 0)
+            {
+                hasLength = true;
+                remaining_ = strtoull(value, nullptr, 10);
+            }
+            else if (keyLen == 17 && strncasecmp(key, "Transfer-Encoding", keyLen) == 0)
+            {
+                chunked = strncasecmp(value, "chunked", 7) == 0;
+            }
+            else if (keyLen == 10 && strncasecmp(key, "Connection", keyLen) == 0)
+            {
+                close_ = strncasecmp(value, "close", 5) == 0;
+            }
+        }
+        pos = end + 2;
+    }
+
+    if (status_ < 200 || status_ == 204 || status_ == 304)
+    {
+        // 1xx(如100 Continue)之后还有最终响应 这里只把它当作一个没有响应体的响应
+        state_ = COMPLETE;
+    }
+    else if (chunked)
+    {
+        state_ = CHUNK_SIZE;
+    }
+    else if (hasLength)
+    {
+        state_ = remaining_ ? BODY : COMPLETE;
+    }
+    else
+    {
+        state_ = UNTIL_CLOSE;
+        close_ = true;
+    }
+    return true;
+}
+
+bool ResponseParser::ReadLine_(const char *data, size_t len, size_t &used)
+{
+    const char *lf = static_cast<const char *>(memchr(data, '\n', len));
+    used = lf ? lf - data + 1 : len;
+    line_.append(data, used);
+    if (line_.size() > MAX_HEADER)
+    {
+        state_ = ERROR;
+        return false;
+    }
+    return lf != nullptr;
+}
+
+void ResponseParser::OnLine_()
+{
+    // 去掉行尾的回车换行
+    while (!line_.empty() && (line_.back() == '\n' || line_.back() == '\r'))
+    {
+        line_.pop_back();
+    }
+    switch (state_)
+    {
+    case CHUNK_SIZE:
+    {
+        char *end = nullptr;
+        remaining_ = strtoull(line_.c_str(), &end, 16);
+        if (end == line_.c_str())
+        {
+            state_ = ERROR;
+        }
+        else
+        {
+            state_ = remaining_ ? CHUNK_DATA : TRAILER;
+        }
+        break;
+    }
+    case CHUNK_CRLF:
+        state_ = line_.empty() ? CHUNK_SIZE : ERROR;
+        break;
+    case TRAILER:
+        if (line_.empty())
+        {
+            state_ = COMPLETE;
+        }
+        break;
+    default:
+        break;
+    }
+    line_.clear();
+}
@@ -0,0 +1,61 @@
+#ifndef RESPONSE_PARSER_H
+#define RESPONSE_PARSER_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * 压测客户端的增量响应解析器
+ * 只解析状态行和决定响应边界的头部(Content-Length、Transfer-Encoding、Connection)，
+ * 响应体只计数不保存，大文件响应也不占用内存。
+ */
+class ResponseParser
+{
+public:
+    ResponseParser();
+
+    // 开始解析下一个响应
+    void Reset();
+
+    // 输入数据 返回消耗的字节数 响应完整时IsComplete()为true 之后的数据属于下一个响应
+    size_t Feed(const char *data, size_t len);
+    // 连接关闭 没有长度的响应以此结束
+    void Eof();
+
+    bool IsComplete() const { return state_ == COMPLETE; }
+    bool IsError() const { return state_ == ERROR; }
+    int Status() const { return status_; }
+    bool IsClose() const { return close_; }
+    size_t Bytes() const { return bytes_; }
+
+    static const size_t MAX_HEADER = 16 * 1024;
+
+private:
+    enum STATE
+    {
+        HEADER,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_CRLF,
+        TRAILER,
+        UNTIL_CLOSE,
+        COMPLETE,
+        ERROR,
+    };
+
+    bool ParseHeader_();
+    // 读取一行到line_ 行完整时返回true
+    bool ReadLine_(const char *data, size_t len, size_t &used);
+    void OnLine_();
+
+    STATE state_;
+    std::string header_;
+    std::string line_;
+    size_t remaining_;
+    size_t bytes_;
+    int status_;
+    bool close_;
+};
+
+#endif // RESPONSE_PARSER_H
@@ -0,0 +1,138 @@
+#include "microbench.h"
+#include "legacy_buffer.h"
+#include "../../code/buffer/buffer.h"
+
+#include <algorithm>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 对比旧版Buffer(原子下标 + bzero) 与当前实现
+
+// 日志路径: 每行追加约百字节后清空
+template <class BufferT>
+static void BM_Buffer_AppendLine(microbench::State &state)
+{
+    BufferT buff;
+    const std::string line(96, 'x');
+    while (state.KeepRunning())
+    {
+        buff.Append(line);
+        microbench::DoNotOptimize(buff.Peek());
+        buff.RetrieveAll();
+    }
+    state.SetBytesPerIteration(line.size());
+}
+MICROBENCH_TEMPLATE(BM_Buffer_AppendLine, LegacyBuffer)
+MICROBENCH_TEMPLATE(BM_Buffer_AppendLine, Buffer)
+
+// 响应头: 多次小块追加 缓冲区扩到约4KB后清空
+template <class BufferT>
+static void BM_Buffer_AppendHeaders(microbench::State &state)
+{
+    BufferT buff;
+    const std::string field = "Content-type: text/html\r\n";
+    const size_t count = 4096 / field.size();
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            buff.Append(field);
+        }
+        microbench::DoNotOptimize(buff.Peek());
+        buff.RetrieveAll();
+    }
+    state.SetBytesPerIteration(count * field.size());
+}
+MICROBENCH_TEMPLATE(BM_Buffer_AppendHeaders, LegacyBuffer)
+MICROBENCH_TEMPLATE(BM_Buffer_AppendHeaders, Buffer)
+
+// 从socket读取一个1KB的请求后清空
+template <class BufferT>
+static void BM_Buffer_ReadFd(microbench::State &state)
+{
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    BufferT buff;
+    const std::string request(1024, 'r');
+    int err = 0;
+    while (state.KeepRunning())
+    {
+        ssize_t n = ::write(fds[0], request.data(), request.size());
+        microbench::DoNotOptimize(n);
+        buff.ReadFd(fds[1], &err);
+        buff.RetrieveAll();
+    }
+    close(fds[0]);
+    close(fds[1]);
+    state.SetBytesPerIteration(request.size());
+}
+MICROBENCH_TEMPLATE(BM_Buffer_ReadFd, LegacyBuffer)
+MICROBENCH_TEMPLATE(BM_Buffer_ReadFd, Buffer)
+
+// 按行解析: 逐行RetrieveUntil 最后RetrieveAll
+template <class BufferT>
+static void BM_Buffer_RetrieveLines(microbench::State &state)
+{
+    const std::string request =
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: localhost:3050\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+        "Accept: text/html,application/xhtml+xml\r\n"
+        "Accept-Language: zh-CN,zh;q=0.9\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+    const char CRLF[] = "\r\n";
+    BufferT buff;
+    while (state.KeepRunning())
+    {
+        buff.Append(request);
+        while (buff.ReadableBytes() > 0)
+        {
+            const char *end = buff.Peek() + buff.ReadableBytes();
+            const char *lineEnd = std::search(buff.Peek(), end, CRLF, CRLF + 2);
+            buff.RetrieveUntil(lineEnd + 2);
+        }
+        buff.RetrieveAll();
+    }
+    state.SetBytesPerIteration(request.size());
+}
+MICROBENCH_TEMPLATE(BM_Buffer_RetrieveLines, LegacyBuffer)
+MICROBENCH_TEMPLATE(BM_Buffer_RetrieveLines, Buffer)
+
+// MakeSpace_ 前移未读数据
+template <class BufferT>
+static void BM_Buffer_MakeSpaceCompact(microbench::State &state)
+{
+    BufferT buff(4096);
+    const std::string chunk(3000, 'c');
+    while (state.KeepRunning())
+    {
+        buff.Append(chunk);
+        buff.Retrieve(2900);
+        buff.Append(chunk.data(), 2000); // 可写空间不足 触发前移
+        buff.RetrieveAll();
+    }
+}
+MICROBENCH_TEMPLATE(BM_Buffer_MakeSpaceCompact, LegacyBuffer)
+MICROBENCH_TEMPLATE(BM_Buffer_MakeSpaceCompact, Buffer)
+
+// MakeSpace_ 扩容 新缓冲区以1KB为单位追加到64KB
+template <class BufferT>
+static void BM_Buffer_MakeSpaceGrow(microbench::State &state)
+{
+    const std::string chunk(1024, 'g');
+    while (state.KeepRunning())
+    {
+        BufferT buff;
+        for (int i = 0; i < 64; i++)
+        {
+            buff.Append(chunk);
+        }
+        microbench::DoNotOptimize(buff.Peek());
+    }
+    state.SetBytesPerIteration(64 * chunk.size());
+}
+MICROBENCH_TEMPLATE(BM_Buffer_MakeSpaceGrow, LegacyBuffer)
+MICROBENCH_TEMPLATE(BM_Buffer_MakeSpaceGrow, Buffer)
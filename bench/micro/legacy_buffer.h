@@ -0,0 +1,106 @@
+#ifndef LEGACY_BUFFER_H
+#define LEGACY_BUFFER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <assert.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+// 旧版Buffer(原子下标 + RetrieveAll时bzero整块内存) 仅用于基准测试对比
+class LegacyBuffer
+{
+public:
+    LegacyBuffer(int initBuffSize = 1024) : buffer_(initBuffSize), readPos_(0), writePos_(0) {}
+
+    size_t WritableBytes() const { return buffer_.size() - writePos_; }
+    size_t ReadableBytes() const { return writePos_ - readPos_; }
+    size_t PrependableBytes() const { return readPos_; }
+    const char *Peek() const { return &buffer_[0] + readPos_; }
+
+    void Retrieve(size_t len)
+    {
+        assert(len <= ReadableBytes());
+        readPos_ += len;
+    }
+
+    void RetrieveUntil(const char *end) { Retrieve(end - Peek()); }
+
+    void RetrieveAll()
+    {
+        bzero(&buffer_[0], buffer_.size());
+        readPos_ = 0;
+        writePos_ = 0;
+    }
+
+    std::string RetrieveAllToStr()
+    {
+        std::string str(Peek(), ReadableBytes());
+        RetrieveAll();
+        return str;
+    }
+
+    void Append(const std::string &str) { Append(str.data(), str.length()); }
+
+    void Append(const char *str, size_t len)
+    {
+        if (WritableBytes() < len)
+        {
+            MakeSpace_(len);
+        }
+        std::copy(str, str + len, &buffer_[0] + writePos_);
+        writePos_ += len;
+    }
+
+    ssize_t ReadFd(int fd, int *saveErrno)
+    {
+        char buff[65535];
+        struct iovec iov[2];
+        const size_t writable = WritableBytes();
+        iov[0].iov_base = &buffer_[0] + writePos_;
+        iov[0].iov_len = writable;
+        iov[1].iov_base = buff;
+        iov[1].iov_len = sizeof(buff);
+
+        const ssize_t len = readv(fd, iov, 2);
+        if (len < 0)
+        {
+            *saveErrno = errno;
+        }
+        else if (static_cast<size_t>(len) <= writable)
+        {
+            writePos_ += len;
+        }
+        else
+        {
+            writePos_ = buffer_.size();
+            Append(buff, len - writable);
+        }
+        return len;
+    }
+
+private:
+    void MakeSpace_(size_t len)
+    {
+        if (WritableBytes() + PrependableBytes() < len)
+        {
+            buffer_.resize(writePos_ + len + 1);
+        }
+        else
+        {
+            size_t readable = ReadableBytes();
+            std::copy(&buffer_[0] + readPos_, &buffer_[0] + writePos_, &buffer_[0]);
+            readPos_ = 0;
+            writePos_ = readable;
+        }
+    }
+
+    std::vector<char> buffer_;
+    std::atomic<std::size_t> readPos_;
+    std::atomic<std::size_t> writePos_;
+};
+
+#endif // LEGACY_BUFFER_H
@@ -0,0 +1,54 @@
+#include "microbench.h"
+#include "../../code/log/log.h"
+
+#include <thread>
+#include <vector>
+
+static const char LOG_DIR[] = "/tmp/microbench_logs";
+// 高于所有日志等级 基准结束后关闭输出 不影响其他基准
+static const int LOG_SILENT = 4;
+
+// threads个线程共同写完state的迭代次数 每次迭代一条日志 与LOG_INFO的调用路径一致
+static void RunLog(microbench::State &state, int queueSize, int threads)
+{
+    Log::Instance()->init(1, LOG_DIR, ".log", queueSize);
+    size_t total = state.Iterations();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        size_t lines = total / threads + (t < (int)(total % threads) ? 1 : 0);
+        workers.emplace_back([lines, t]
+                             {
+            for (size_t i = 0; i < lines; i++)
+            {
+                LOG_INFO("Client[%d](127.0.0.1:%d) in, userCount:%d", (int)i, 40000 + t, (int)i % 1024);
+            } });
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    Log::Instance()->SetLevel(LOG_SILENT);
+    state.SetItemsPerIteration(1);
+}
+
+MICROBENCH(BM_Log_Sync_1Thread)
+{
+    RunLog(state, 0, 1);
+}
+
+MICROBENCH(BM_Log_Sync_4Threads)
+{
+    RunLog(state, 0, 4);
+}
+
+MICROBENCH(BM_Log_Async_1Thread)
+{
+    RunLog(state, 1024, 1);
+}
+
+MICROBENCH(BM_Log_Async_4Threads)
+{
+    RunLog(state, 1024, 4);
+}
@@ -0,0 +1,184 @@
+#include "microbench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace microbench
+{
+namespace
+{
+struct Bench
+{
+    const char *name;
+    BenchFunc fn;
+};
+
+std::vector<Bench> &Registry()
+{
+    static std::vector<Bench> benches;
+    return benches;
+}
+
+struct Result
+{
+    std::string name;
+    size_t iterations;
+    double nsPerOp;
+    double bytesPerSecond;
+    double itemsPerSecond;
+    std::string counterName;
+    double counter;
+};
+
+// 运行一次并返回耗时(秒)
+double RunOnce(BenchFunc fn, State &state)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn(state);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// 名称中只有字母数字和<>_/ 不需要转义
+bool WriteJson(const char *path, const std::vector<Result> &results)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "open %s failed\n", path);
+        return false;
+    }
+    fprintf(fp, "{\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result &r = results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"iterations\": %zu, \"real_time\": %.3f, \"time_unit\": \"ns\"",
+                r.name.c_str(), r.iterations, r.nsPerOp);
+        if (r.bytesPerSecond > 0)
+        {
+            fprintf(fp, ", \"bytes_per_second\": %.1f", r.bytesPerSecond);
+        }
+        if (r.itemsPerSecond > 0)
+        {
+            fprintf(fp, ", \"items_per_second\": %.1f", r.itemsPerSecond);
+        }
+        if (!r.counterName.empty())
+        {
+            fprintf(fp, ", \"%s\": %.3f", r.counterName.c_str(), r.counter);
+        }
+        fprintf(fp, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+    return true;
+}
+} // namespace
+
+bool Register(const char *name, BenchFunc fn)
+{
+    Registry().push_back({name, fn});
+    return true;
+}
+} // namespace microbench
+
+using namespace microbench;
+
+int main(int argc, char *argv[])
+{
+    // 参数: [--json 输出文件] [--repetitions 次数] [名称过滤子串] [每项最少运行秒数]
+    const char *jsonPath = nullptr;
+    int repetitions = 1;
+    std::vector<const char *> args;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            jsonPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc)
+        {
+            repetitions = std::max(1, atoi(argv[++i]));
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+    const char *filter = args.size() > 0 ? args[0] : "";
+    double minTime = args.size() > 1 ? atof(args[1]) : 0.3;
+    std::vector<Result> results;
+
+    printf("%-40s %14s %14s %16s\n", "benchmark", "iterations", "ns/op", "throughput");
+    for (const Bench &bench : Registry())
+    {
+        if (strstr(bench.name, filter) == nullptr)
+        {
+            continue;
+        }
+        // 迭代次数按10倍递增 直到耗时超过目标的十分之一 再按比例推算最终次数
+        size_t iters = 1;
+        double elapsed = 0;
+        while (true)
+        {
+            State probe(iters);
+            elapsed = RunOnce(bench.fn, probe);
+            if (elapsed >= minTime / 10 || iters >= (size_t(1) << 40))
+            {
+                break;
+            }
+            iters *= 10;
+        }
+        if (elapsed < minTime)
+        {
+            iters = static_cast<size_t>(iters * (minTime / (elapsed > 0 ? elapsed : 1e-9)));
+        }
+
+        // 重复运行取最快的一次 减少调度和频率变化带来的噪声
+        State state(iters);
+        elapsed = RunOnce(bench.fn, state);
+        for (int i = 1; i < repetitions; i++)
+        {
+            State again(iters);
+            double t = RunOnce(bench.fn, again);
+            if (t < elapsed)
+            {
+                elapsed = t;
+                state = again;
+            }
+        }
+        double nsPerOp = elapsed * 1e9 / iters;
+
+        Result result = {bench.name, iters, nsPerOp, state.BytesPerIteration() * iters / elapsed,
+                         state.ItemsPerIteration() * iters / elapsed, state.CounterName(), state.Counter()};
+        results.push_back(result);
+
+        char throughput[64] = "";
+        if (state.BytesPerIteration())
+        {
+            snprintf(throughput, sizeof(throughput), "%.1f MB/s", result.bytesPerSecond / (1024 * 1024));
+        }
+        else if (state.ItemsPerIteration())
+        {
+            double rate = result.itemsPerSecond;
+            snprintf(throughput, sizeof(throughput), rate >= 1e6 ? "%.2f M/s" : "%.1f k/s",
+                     rate >= 1e6 ? rate / 1e6 : rate / 1e3);
+        }
+        printf("%-40s %14zu %14.2f %16s", bench.name, iters, nsPerOp, throughput);
+        if (!state.CounterName().empty())
+        {
+            printf("  %s=%.2f", state.CounterName().c_str(), state.Counter());
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    if (jsonPath && !WriteJson(jsonPath, results))
+    {
+        return 1;
+    }
+    return 0;
+}
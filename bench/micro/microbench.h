@@ -0,0 +1,83 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * 自包含的微基准测试框架 不依赖第三方库
+ * 用法:
+ *     MICROBENCH(BM_Name)
+ *     {
+ *         while (state.KeepRunning()) { ... }
+ *     }
+ * 框架自动增加迭代次数直到单次运行时间足够长 输出每次迭代耗时
+ */
+namespace microbench
+{
+class State
+{
+public:
+    explicit State(size_t iterations) : iterations_(iterations), remaining_(iterations) {}
+
+    bool KeepRunning()
+    {
+        if (remaining_ == 0)
+        {
+            return false;
+        }
+        remaining_--;
+        return true;
+    }
+
+    size_t Iterations() const { return iterations_; }
+
+    // 每次迭代处理的字节数/条目数 用于计算吞吐
+    void SetBytesPerIteration(size_t bytes) { bytesPerIter_ = bytes; }
+    void SetItemsPerIteration(size_t items) { itemsPerIter_ = items; }
+
+    size_t BytesPerIteration() const { return bytesPerIter_; }
+    size_t ItemsPerIteration() const { return itemsPerIter_; }
+
+    // 附加的统计值 如每次迭代的内存分配次数 输出在吞吐之后
+    void SetCounter(const std::string &name, double value) { counterName_ = name, counter_ = value; }
+    const std::string &CounterName() const { return counterName_; }
+    double Counter() const { return counter_; }
+
+private:
+    size_t iterations_;
+    size_t remaining_;
+    size_t bytesPerIter_ = 0;
+    size_t itemsPerIter_ = 0;
+    std::string counterName_;
+    double counter_ = 0;
+};
+
+typedef void (*BenchFunc)(State &);
+
+bool Register(const char *name, BenchFunc fn);
+
+// 阻止编译器把被测结果优化掉
+template <class T>
+inline void DoNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory()
+{
+    asm volatile("" : : : "memory");
+}
+} // namespace microbench
+
+#define MICROBENCH(fn)                                                    \
+    static void fn(microbench::State &state);                             \
+    static const bool fn##_registered_ = microbench::Register(#fn, fn);   \
+    static void fn(microbench::State &state)
+
+// 注册模板基准 如 MICROBENCH_TEMPLATE(BM_Append, Buffer) 用于同一场景比较不同实现
+#define MICROBENCH_TEMPLATE(fn, T) \
+    static const bool fn##_##T##_registered_ = microbench::Register(#fn "<" #T ">", fn<T>);
+
+#endif // MICROBENCH_H
@@ -0,0 +1,76 @@
+#include "microbench.h"
+#include "../../code/http/mimetype.h"
+
+#include <string>
+#include <unordered_map>
+
+// 旧版实现: unordered_map<string,string> + substr + count/find 两次哈希 返回string拷贝
+static const std::unordered_map<std::string, std::string> LEGACY_SUFFIX_TYPE = {
+    {".html", "text/html"},
+    {".xml", "text/xml"},
+    {".xhtml", "application/xhtml+xml"},
+    {".txt", "text/plain"},
+    {".rtf", "application/rtf"},
+    {".pdf", "application/pdf"},
+    {".word", "application/nsword"},
+    {".png", "image/png"},
+    {".gif", "image/gif"},
+    {".jpg", "image/jpeg"},
+    {".jpeg", "image/jpeg"},
+    {".au", "audio/basic"},
+    {".mpeg", "video/mpeg"},
+    {".mpg", "video/mpeg"},
+    {".avi", "video/x-msvideo"},
+    {".gz", "application/x-gzip"},
+    {".tar", "application/x-tar"},
+    {".css", "text/css "},
+    {".js", "text/javascript "},
+};
+
+static std::string LegacyFileType(const std::string &path)
+{
+    std::string::size_type idx = path.find_last_of('.');
+    if (idx == std::string::npos)
+    {
+        return "text/plain";
+    }
+    std::string suffix = path.substr(idx);
+    if (LEGACY_SUFFIX_TYPE.count(suffix) == 1)
+    {
+        return LEGACY_SUFFIX_TYPE.find(suffix)->second;
+    }
+    return "text/plain";
+}
+
+// 典型的静态资源请求路径
+static const std::string PATHS[] = {
+    "/index.html",
+    "/css/bootstrap.min.css",
+    "/js/jquery.min.js",
+    "/images/instagram-image1.jpg",
+    "/images/favicon.ico",
+    "/video/xxx.mp4",
+    "/login.html",
+    "/README",
+};
+static const size_t PATH_NUM = sizeof(PATHS) / sizeof(PATHS[0]);
+
+MICROBENCH(BM_MimeLookup_Legacy)
+{
+    size_t i = 0;
+    while (state.KeepRunning())
+    {
+        std::string type = LegacyFileType(PATHS[i++ % PATH_NUM]);
+        microbench::DoNotOptimize(type);
+    }
+}
+
+MICROBENCH(BM_MimeLookup_PerfectHash)
+{
+    size_t i = 0;
+    while (state.KeepRunning())
+    {
+        std::string_view type = MimeType::Lookup(PATHS[i++ % PATH_NUM]);
+        microbench::DoNotOptimize(type);
+    }
+}
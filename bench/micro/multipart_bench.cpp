@@ -0,0 +1,82 @@
+#include "microbench.h"
+#include "../../code/http/multipartparser.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+static const char BOUNDARY[] = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+static const char TITLE[] = "holiday pictures";
+static const size_t FILE_SIZE = 16 * 1024 * 1024;
+
+// 一个普通字段加一个16MB的随机内容文件 文件内容中混入回车换行和分隔符前缀
+static const std::string &UploadBody()
+{
+    static const std::string body = []()
+    {
+        std::string b;
+        b += std::string("--") + BOUNDARY + "\r\n";
+        b += "Content-Disposition: form-data; name=\"title\"\r\n\r\n";
+        b += TITLE;
+        b += std::string("\r\n--") + BOUNDARY + "\r\n";
+        b += "Content-Disposition: form-data; name=\"file\"; filename=\"video.mp4\"\r\n";
+        b += "Content-Type: video/mp4\r\n\r\n";
+        std::mt19937 rng(42);
+        size_t start = b.size();
+        b.resize(start + FILE_SIZE);
+        for (size_t i = start; i < b.size(); i++)
+        {
+            b[i] = static_cast<char>(rng());
+        }
+        for (size_t i = start + 4096; i + 16 < b.size(); i += 65536)
+        {
+            b.replace(i, 8, "\r\n--\r\n--");
+        }
+        b += std::string("\r\n--") + BOUNDARY + "--\r\n";
+        return b;
+    }();
+    return body;
+}
+
+// 在计时之前生成
+static const std::string &BODY = UploadBody();
+
+template <size_t SLICE>
+static void BM_MultipartUpload(microbench::State &state)
+{
+    const std::string &body = BODY;
+    MultipartParser parser;
+    size_t received = 0;
+    parser.SetHandler(nullptr, [&received](const MultipartParser::Part &, const char *, size_t len)
+                      {
+                          received += len;
+                          return true;
+                      },
+                      nullptr);
+    // 两个部分的内容之和 分隔符前缀的诱饵被误判时不相等
+    const size_t expected = sizeof(TITLE) - 1 + FILE_SIZE;
+    while (state.KeepRunning())
+    {
+        parser.Init(BOUNDARY);
+        received = 0;
+        // 按socket读取的粒度分片输入
+        for (size_t off = 0; off < body.size(); off += SLICE)
+        {
+            parser.Feed(body.data() + off, std::min(SLICE, body.size() - off));
+        }
+        // 解析错误时测到的只是出错前的部分 不输出吞吐 直接失败
+        if (!parser.IsDone() || received != expected)
+        {
+            fprintf(stderr, "BM_MultipartUpload<%zu>: parser %s, received %zu of %zu bytes\n", SLICE,
+                    parser.IsDone() ? "done" : (parser.IsError() ? "failed" : "not done"), received, expected);
+            abort();
+        }
+    }
+    state.SetBytesPerIteration(body.size());
+}
+
+static const size_t SLICE_4K = 4096;
+static const size_t SLICE_64K = 65536;
+MICROBENCH_TEMPLATE(BM_MultipartUpload, SLICE_4K)
+MICROBENCH_TEMPLATE(BM_MultipartUpload, SLICE_64K)
@@ -0,0 +1,101 @@
+#include "microbench.h"
+#include "../../code/buffer/buffer.h"
+#include "../../code/http/httprequest.h"
+
+#include <string>
+
+// 浏览器发出的典型GET请求
+static const std::string GET_REQUEST =
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:3000\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark\r\n"
+    "\r\n";
+
+// 登录表单
+static const std::string POST_REQUEST =
+    "POST /api/login HTTP/1.1\r\n"
+    "Host: 127.0.0.1:3000\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "Content-Length: 40\r\n"
+    "Origin: http://127.0.0.1:3000\r\n"
+    "Referer: http://127.0.0.1:3000/login.html\r\n"
+    "\r\n"
+    "username=alice%40example.com&password=pw";
+
+// 带查询字符串的GET
+static const std::string QUERY_REQUEST =
+    "GET /search?q=web+server&page=2&sort=desc HTTP/1.1\r\n"
+    "Host: 127.0.0.1:3000\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+// 一次读取到的完整请求 解析后复用同一个HttpRequest 与keep-alive连接上的处理一致
+static void RunParse(microbench::State &state, const std::string &request, size_t requestsPerRead)
+{
+    std::string data;
+    for (size_t i = 0; i < requestsPerRead; i++)
+    {
+        data += request;
+    }
+    Buffer buff(0);
+    HttpRequest req;
+    while (state.KeepRunning())
+    {
+        buff.Append(data);
+        for (size_t i = 0; i < requestsPerRead; i++)
+        {
+            req.Init();
+            HttpRequest::HTTP_CODE ret = req.parse(buff);
+            microbench::DoNotOptimize(ret);
+        }
+        buff.RetrieveAll();
+    }
+    state.SetBytesPerIteration(data.size());
+}
+
+MICROBENCH(BM_Parse_Get)
+{
+    RunParse(state, GET_REQUEST, 1);
+}
+
+MICROBENCH(BM_Parse_PostForm)
+{
+    RunParse(state, POST_REQUEST, 1);
+}
+
+MICROBENCH(BM_Parse_Query)
+{
+    RunParse(state, QUERY_REQUEST, 1);
+}
+
+// 流水线 一次读取包含8个请求
+MICROBENCH(BM_Parse_Pipelined8)
+{
+    RunParse(state, GET_REQUEST, 8);
+}
+
+// 请求分多次到达 每次16字节 不完整的行留在缓冲区等待下一次
+MICROBENCH(BM_Parse_Trickle16)
+{
+    const size_t STEP = 16;
+    Buffer buff(0);
+    HttpRequest req;
+    while (state.KeepRunning())
+    {
+        req.Init();
+        for (size_t off = 0; off < GET_REQUEST.size(); off += STEP)
+        {
+            buff.Append(GET_REQUEST.data() + off, std::min(STEP, GET_REQUEST.size() - off));
+            HttpRequest::HTTP_CODE ret = req.parse(buff);
+            microbench::DoNotOptimize(ret);
+        }
+        buff.RetrieveAll();
+    }
+    state.SetBytesPerIteration(GET_REQUEST.size());
+}
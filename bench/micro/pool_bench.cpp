@@ -0,0 +1,59 @@
+#include "microbench.h"
+#include "../../code/pool/threadpool.h"
+
+#include <atomic>
+
+// 提交一个任务并等待它开始执行 测量从AddTask到工作线程运行任务的延迟
+static void RunDispatch(microbench::State &state, size_t threads)
+{
+    ThreadPool pool(threads);
+    std::atomic<size_t> done(0);
+    size_t expected = 0;
+    while (state.KeepRunning())
+    {
+        pool.AddTask([&done] { done.fetch_add(1, std::memory_order_release); });
+        expected++;
+        while (done.load(std::memory_order_acquire) != expected)
+        {
+        }
+    }
+    state.SetItemsPerIteration(1);
+}
+
+MICROBENCH(BM_ThreadPool_Dispatch_1Thread)
+{
+    RunDispatch(state, 1);
+}
+
+MICROBENCH(BM_ThreadPool_Dispatch_8Threads)
+{
+    RunDispatch(state, 8);
+}
+
+// 连续提交空任务 最后等待全部完成 测量队列的吞吐
+static void RunThroughput(microbench::State &state, size_t threads)
+{
+    ThreadPool pool(threads);
+    std::atomic<size_t> done(0);
+    size_t submitted = 0;
+    while (state.KeepRunning())
+    {
+        pool.AddTask([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        submitted++;
+    }
+    while (done.load(std::memory_order_acquire) != submitted)
+    {
+        std::this_thread::yield();
+    }
+    state.SetItemsPerIteration(1);
+}
+
+MICROBENCH(BM_ThreadPool_Throughput_1Thread)
+{
+    RunThroughput(state, 1);
+}
+
+MICROBENCH(BM_ThreadPool_Throughput_8Threads)
+{
+    RunThroughput(state, 8);
+}
@@ -0,0 +1,52 @@
+#include "microbench.h"
+#include "../../code/server/ratelimiter.h"
+
+// 同一个客户端反复检查 表项在缓存中 速率足够高 每次都通过
+MICROBENCH(BM_RateLimiter_SameClient)
+{
+    RateLimiter limiter(1000000000, 1000, 1 << 20);
+    uint64_t key = (0xffffULL << 48) | 0x7f000001;
+    uint64_t now = 1000000000;
+    size_t allowed = 0;
+    while (state.KeepRunning())
+    {
+        allowed += limiter.Allow(key, now);
+        now += 1000;
+    }
+    microbench::DoNotOptimize(allowed);
+    state.SetItemsPerIteration(1);
+}
+
+// 100万个不同的IPv4客户端轮流检查 表项大多不在缓存中 预热后全部命中已有项
+MICROBENCH(BM_RateLimiter_MillionClients)
+{
+    const uint64_t clients = 1 << 20;
+    static RateLimiter limiter(100, 100, 1 << 21);
+    uint64_t now = 1000000000;
+    size_t allowed = 0;
+    uint64_t i = 0;
+    while (state.KeepRunning())
+    {
+        allowed += limiter.Allow((0xffffULL << 48) | (0x0a000000 + (i++ & (clients - 1))), now);
+        now += 10;
+    }
+    microbench::DoNotOptimize(allowed);
+    state.SetItemsPerIteration(1);
+}
+
+// 客户端数是表容量的4倍 大多数检查要加锁插入并替换旧项
+MICROBENCH(BM_RateLimiter_Eviction)
+{
+    const uint64_t clients = 1 << 22;
+    static RateLimiter limiter(100, 100, 1 << 20);
+    uint64_t now = 1000000000;
+    size_t allowed = 0;
+    uint64_t i = 0;
+    while (state.KeepRunning())
+    {
+        allowed += limiter.Allow((0xffffULL << 48) | (0x0a000000 + (i++ & (clients - 1))), now);
+        now += 10;
+    }
+    microbench::DoNotOptimize(allowed);
+    state.SetItemsPerIteration(1);
+}
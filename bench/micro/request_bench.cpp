@@ -0,0 +1,116 @@
+#include "microbench.h"
+#include "../../code/buffer/buffer.h"
+#include "../../code/buffer/chainbuffer.h"
+#include "../../code/http/filecache.h"
+#include "../../code/http/httprequest.h"
+#include "../../code/http/httpresponse.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string>
+
+// 统计operator new调用次数 只在请求基准的计时循环中由本线程开启 其他基准与小文件缓存的监视线程不计入
+static thread_local size_t *t_allocs = nullptr;
+
+namespace
+{
+class CountAllocs
+{
+public:
+    explicit CountAllocs(size_t &count) { t_allocs = &count; }
+    ~CountAllocs() { t_allocs = nullptr; }
+};
+} // namespace
+
+void *operator new(size_t len)
+{
+    if (t_allocs)
+    {
+        ++*t_allocs;
+    }
+    void *p = malloc(len ? len : 1);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+static const char SRC_DIR[] = "./resources";
+
+// 浏览器发出的典型请求
+static std::string MakeRequest(const char *path)
+{
+    return std::string("GET ") + path + " HTTP/1.1\r\n"
+                                        "Host: 127.0.0.1:3000\r\n"
+                                        "Connection: keep-alive\r\n"
+                                        "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+                                        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                                        "Accept-Encoding: gzip, deflate, br\r\n"
+                                        "Accept-Language: en-US,en;q=0.9\r\n"
+                                        "Cache-Control: max-age=0\r\n"
+                                        "\r\n";
+}
+
+// 一个keep-alive连接上反复处理同一个请求: 解析 + 生成响应 + 发送完成 与HttpConn::process一致
+static void RunRequestCycle(microbench::State &state, const char *path)
+{
+    static bool cacheReady = false;
+    if (!cacheReady)
+    {
+        FileCache::Instance()->Init(SRC_DIR, 64 * 1024, 32 * 1024 * 1024);
+        cacheReady = true;
+    }
+
+    const std::string request = MakeRequest(path);
+    Buffer readBuff(0);
+    ChainBuffer writeBuff;
+    HttpRequest req;
+    HttpResponse res;
+
+    size_t allocs = 0;
+    size_t bytes = 0;
+    CountAllocs counting(allocs);
+    while (state.KeepRunning())
+    {
+        req.Init();
+        readBuff.Append(request);
+        req.parse(readBuff);
+        res.Init(SRC_DIR, req.path(), req.retjson(), req.IsKeepAlive(), 200);
+        readBuff.Release();
+        res.MakeResponse(writeBuff);
+        bytes += writeBuff.ReadableBytes();
+        writeBuff.RetrieveAll();
+    }
+    microbench::DoNotOptimize(bytes);
+    state.SetItemsPerIteration(1);
+    state.SetCounter("allocs/req", static_cast<double>(allocs) / state.Iterations());
+}
+
+// 命中小文件缓存
+MICROBENCH(BM_RequestCycle_Cached)
+{
+    RunRequestCycle(state, "/index.html");
+}
+
+// 超过缓存上限的文件 映射后发送
+MICROBENCH(BM_RequestCycle_Mapped)
+{
+    RunRequestCycle(state, "/video/xxx.mp4");
+}
+
+// 缓存的错误页
+MICROBENCH(BM_RequestCycle_NotFound)
+{
+    RunRequestCycle(state, "/nope.html");
+}
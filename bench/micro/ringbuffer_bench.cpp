@@ -0,0 +1,94 @@
+#include "microbench.h"
+#include "../../code/buffer/buffer.h"
+#include "../../code/buffer/ringbuffer.h"
+
+#include <algorithm>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 对比Buffer(前移/扩容) 与镜像环形缓冲区 RingBuffer
+
+// 流式接收大POST请求体: 每次从socket读入16KB 处理掉完整的4KB块 不足4KB的尾部留到下次
+template <class BufferT>
+static void BM_StreamBody(microbench::State &state)
+{
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    int sndbuf = 1 << 20;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    BufferT buff(64 * 1024);
+    const std::string chunk(16 * 1024 + 1000, 'b'); // 故意不对齐 让尾部数据跨越读取边界
+    const size_t BLOCK = 4096;
+    int err = 0;
+    size_t checksum = 0;
+    while (state.KeepRunning())
+    {
+        ssize_t n = ::write(fds[0], chunk.data(), chunk.size());
+        microbench::DoNotOptimize(n);
+        size_t remain = chunk.size();
+        while (remain > 0)
+        {
+            ssize_t len = buff.ReadFd(fds[1], &err);
+            if (len <= 0)
+            {
+                break;
+            }
+            remain -= len;
+        }
+        while (buff.ReadableBytes() >= BLOCK)
+        {
+            checksum += static_cast<unsigned char>(buff.Peek()[BLOCK - 1]);
+            buff.Retrieve(BLOCK);
+        }
+    }
+    microbench::DoNotOptimize(checksum);
+    close(fds[0]);
+    close(fds[1]);
+    state.SetBytesPerIteration(chunk.size());
+}
+MICROBENCH_TEMPLATE(BM_StreamBody, Buffer)
+MICROBENCH_TEMPLATE(BM_StreamBody, RingBuffer)
+
+// 管线化请求: 一次追加多个请求 逐行解析 最后一个请求不完整 留到下一轮
+template <class BufferT>
+static void BM_PipelinedRequests(microbench::State &state)
+{
+    const std::string request =
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: localhost:3050\r\n"
+        "User-Agent: bench\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+    std::string batch;
+    for (int i = 0; i < 32; i++)
+    {
+        batch += request;
+    }
+    batch += request.substr(0, request.size() / 2);
+    const std::string rest = request.substr(request.size() / 2);
+    const char CRLF[] = "\r\n";
+
+    BufferT buff(64 * 1024);
+    size_t lines = 0;
+    while (state.KeepRunning())
+    {
+        buff.Append(batch);
+        while (true)
+        {
+            const char *end = buff.Peek() + buff.ReadableBytes();
+            const char *lineEnd = std::search(buff.Peek(), end, CRLF, CRLF + 2);
+            if (lineEnd == end)
+            {
+                break;
+            }
+            lines++;
+            buff.RetrieveUntil(lineEnd + 2);
+        }
+        buff.Append(rest);
+    }
+    microbench::DoNotOptimize(lines);
+    state.SetBytesPerIteration(batch.size() + rest.size());
+}
+MICROBENCH_TEMPLATE(BM_PipelinedRequests, Buffer)
+MICROBENCH_TEMPLATE(BM_PipelinedRequests, RingBuffer)
@@ -0,0 +1,93 @@
+#include "microbench.h"
+#include "../../code/http/router.h"
+
+#include <string>
+#include <vector>
+
+// 每个资源注册8条路由 共4096条
+static const int RESOURCES = 512;
+
+static void BuildRoutes(Router &router, std::vector<std::string> &pages)
+{
+    for (int i = 0; i < RESOURCES; i++)
+    {
+        std::string res = "/api/v1/res" + std::to_string(i);
+        Router::Handler handler = [](const HttpRequest &, const Router::Match &, std::string &) {};
+        router.AddHandler("GET", res, "application/json", handler);
+        router.AddHandler("POST", res, "application/json", handler);
+        router.AddHandler("GET", res + "/:id", "application/json", handler);
+        router.AddHandler("DELETE", res + "/:id", "application/json", handler);
+        router.AddHandler("GET", res + "/:id/items/:item", "application/json", handler);
+        router.AddCgi("POST", res + "/:id/run", "./resources_cgi/run.cgi", {"run", "$id"});
+        router.AddStatic("/static" + std::to_string(i) + "/*file", "/assets/");
+        pages.push_back("/page" + std::to_string(i));
+        router.AddAlias(pages.back(), pages.back() + ".html");
+    }
+}
+
+struct Routes
+{
+    Router router;
+    std::vector<std::string> pages;
+
+    Routes() { BuildRoutes(router, pages); }
+};
+
+static Routes &GetRoutes()
+{
+    static Routes routes;
+    return routes;
+}
+
+static void RunFind(microbench::State &state, const char *method, const char *path)
+{
+    const Router &router = GetRoutes().router;
+    Router::Match match;
+    while (state.KeepRunning())
+    {
+        router.Find(method, path, match);
+        microbench::DoNotOptimize(match.route);
+    }
+    state.SetItemsPerIteration(1);
+}
+
+MICROBENCH(BM_Router_Alias)
+{
+    RunFind(state, "GET", "/page317");
+}
+
+MICROBENCH(BM_Router_Param)
+{
+    RunFind(state, "GET", "/api/v1/res317/12345/items/99");
+}
+
+MICROBENCH(BM_Router_Wildcard)
+{
+    RunFind(state, "GET", "/static317/css/bootstrap.min.css");
+}
+
+MICROBENCH(BM_Router_Miss)
+{
+    RunFind(state, "GET", "/api/v2/res317");
+}
+
+// 旧版做法: 逐个比较已知的页面路径 耗时随路由数线性增长
+MICROBENCH(BM_Router_LinearScan)
+{
+    const std::vector<std::string> &pages = GetRoutes().pages;
+    const std::string path = "/page317";
+    while (state.KeepRunning())
+    {
+        const std::string *found = nullptr;
+        for (const std::string &page : pages)
+        {
+            if (page == path)
+            {
+                found = &page;
+                break;
+            }
+        }
+        microbench::DoNotOptimize(found);
+    }
+    state.SetItemsPerIteration(1);
+}
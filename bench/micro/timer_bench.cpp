@@ -0,0 +1,75 @@
+#include "microbench.h"
+#include "../../code/timer/heaptimer.h"
+
+#include <random>
+#include <vector>
+
+// 与连接数相当的定时器数量
+static const int TIMERS = 10000;
+
+static const TimeoutCallBack NOOP = [] {};
+
+// 随机超时时间 模拟连接在不同时刻建立
+static std::vector<int> RandomTimeouts(int n, int maxMs)
+{
+    std::mt19937 rng(42);
+    std::vector<int> timeouts(n);
+    for (int &t : timeouts)
+    {
+        t = std::uniform_int_distribution<int>(1, maxMs)(rng);
+    }
+    return timeouts;
+}
+
+// 一次迭代添加TIMERS个定时器后清空
+MICROBENCH(BM_HeapTimer_Add)
+{
+    static const std::vector<int> timeouts = RandomTimeouts(TIMERS, 60000);
+    HeapTimer timer;
+    while (state.KeepRunning())
+    {
+        for (int i = 0; i < TIMERS; i++)
+        {
+            timer.add(i, timeouts[i], NOOP);
+        }
+        timer.clear();
+    }
+    state.SetItemsPerIteration(TIMERS);
+}
+
+// TIMERS个定时器中随机延长一个 对应连接上有新的请求
+MICROBENCH(BM_HeapTimer_Adjust)
+{
+    static const std::vector<int> timeouts = RandomTimeouts(TIMERS, 60000);
+    HeapTimer timer;
+    for (int i = 0; i < TIMERS; i++)
+    {
+        timer.add(i, timeouts[i], NOOP);
+    }
+    std::mt19937 rng(7);
+    int extend = 60000;
+    while (state.KeepRunning())
+    {
+        int id = std::uniform_int_distribution<int>(0, TIMERS - 1)(rng);
+        timer.adjust(id, ++extend);
+    }
+    state.SetItemsPerIteration(1);
+}
+
+// 一次迭代添加TIMERS个已到期的定时器 tick全部触发并删除
+MICROBENCH(BM_HeapTimer_Tick)
+{
+    HeapTimer timer;
+    int fired = 0;
+    TimeoutCallBack cb = [&fired] { fired++; };
+    while (state.KeepRunning())
+    {
+        for (int i = 0; i < TIMERS; i++)
+        {
+            timer.add(i, 0, cb);
+        }
+        timer.tick();
+    }
+    microbench::DoNotOptimize(fired);
+    state.SetItemsPerIteration(TIMERS);
+}
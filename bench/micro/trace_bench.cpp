@@ -0,0 +1,38 @@
+#include "microbench.h"
+#include "../../code/metrics/flightrecorder.h"
+
+// 一个请求的追踪开销 填写阶段并写入环形缓冲区
+// 时间戳由指标统计读取 追踪直接复用 这里不计入读取时钟的开销
+MICROBENCH(BM_FlightRecorder_Request)
+{
+    FlightRecorder::Record record = FlightRecorder::Record();
+    uint64_t now = 1000000;
+    while (state.KeepRunning())
+    {
+        record = FlightRecorder::Record();
+        record.start = now;
+        record.spans[FlightRecorder::SPAN_READ][0] = now;
+        record.spans[FlightRecorder::SPAN_READ][1] = record.spans[FlightRecorder::SPAN_PARSE][0] = now + 100;
+        record.spans[FlightRecorder::SPAN_PARSE][1] = now + 1100;
+        record.SetRequest("GET", "/index.html");
+        record.spans[FlightRecorder::SPAN_BUILD][0] = now + 1100;
+        record.spans[FlightRecorder::SPAN_BUILD][1] = now + 1500;
+        record.spans[FlightRecorder::SPAN_WRITE][0] = now + 1500;
+        record.spans[FlightRecorder::SPAN_WRITE][1] = now + 9000;
+        record.code = 200;
+        FlightRecorder::Commit(record);
+        now += 10000;
+    }
+    state.SetItemsPerIteration(1);
+}
+
+// 导出时扫描所有环 取最慢的100个
+MICROBENCH(BM_FlightRecorder_Slowest)
+{
+    std::vector<FlightRecorder::Record> records;
+    while (state.KeepRunning())
+    {
+        FlightRecorder::Instance()->Slowest(100, records);
+        microbench::DoNotOptimize(records.data());
+    }
+}
@@ -0,0 +1,89 @@
+#include "microbench.h"
+#include "../../code/http/urlencoded.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 典型的登录表单
+static const std::string FORM =
+    "username=alice%40example.com&password=p%40ss+w0rd%21&remember=on&redirect=%2Fwelcome.html%3Ftab%3D1";
+
+// 旧版实现: 每个键值substr拷贝后存入unordered_map %XX写回十进制数字
+static int LegacyConverHex(char ch)
+{
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    return ch;
+}
+
+static void LegacyParse(std::string body, std::unordered_map<std::string, std::string> &post)
+{
+    std::string key, value;
+    int num = 0;
+    int n = body.size();
+    int i = 0, j = 0;
+    for (; i < n; i++)
+    {
+        char ch = body[i];
+        switch (ch)
+        {
+        case '=':
+            key = body.substr(j, i - j);
+            j = i + 1;
+            break;
+        case '+':
+            body[i] = ' ';
+            break;
+        case '%':
+            num = LegacyConverHex(body[i + 1]) * 16 + LegacyConverHex(body[i + 2]);
+            body[i + 2] = num % 10 + '0';
+            body[i + 1] = num / 10 + '0';
+            i += 2;
+            break;
+        case '&':
+            value = body.substr(j, i - j);
+            j = i + 1;
+            post[key] = value;
+            break;
+        default:
+            break;
+        }
+    }
+    if (post.count(key) == 0 && j < i)
+    {
+        value = body.substr(j, i - j);
+        post[key] = value;
+    }
+}
+
+MICROBENCH(BM_UrlEncoded_Legacy)
+{
+    std::unordered_map<std::string, std::string> post;
+    while (state.KeepRunning())
+    {
+        post.clear();
+        LegacyParse(FORM, post);
+        microbench::DoNotOptimize(post.find("password")->second);
+    }
+    state.SetBytesPerIteration(FORM.size());
+}
+
+MICROBENCH(BM_UrlEncoded_InPlace)
+{
+    // 与请求中一样 原文在可复用的存储中 字段数组复用容量
+    std::string body;
+    UrlEncoded::FieldList fields;
+    std::string_view value;
+    while (state.KeepRunning())
+    {
+        body.assign(FORM);
+        fields.clear();
+        UrlEncoded::Parse(&body[0], body.size(), fields);
+        UrlEncoded::Find(fields, "password", value);
+        microbench::DoNotOptimize(value);
+    }
+    state.SetBytesPerIteration(FORM.size());
+}
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""在压测过程中热升级 检查升级期间没有失败的请求
+
+用法(在工作目录下 需要resources与resources_cgi):
+    python3 bench/upgrade.py --server ./build/bin/server --bench ./build/bin/bench [--port 3400]
+
+启动服务器与负载生成器 运行中向服务器发送SIGUSR2 (可多次 --upgrades)
+新进程继承监听socket后旧进程退出。负载生成器报告的错误数不为0、
+或最后存活的服务器进程数不为1时退出码为1。--close 每个请求新建连接。
+"""
+
+import argparse
+import os
+import re
+import signal
+import subprocess
+import sys
+import time
+
+
+def server_pids(port):
+    out = subprocess.run(["pgrep", "-f", "server -p %d$" % port], capture_output=True, text=True).stdout
+    return [int(pid) for pid in out.split()]
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--server", default="./build/bin/server")
+    parser.add_argument("--bench", default="./build/bin/bench")
+    parser.add_argument("--port", type=int, default=3400)
+    parser.add_argument("--connections", type=int, default=50)
+    parser.add_argument("--duration", type=int, default=6)
+    parser.add_argument("--upgrades", type=int, default=2)
+    parser.add_argument("--close", action="store_true")
+    args = parser.parse_args()
+
+    server = os.path.abspath(args.server)
+    subprocess.Popen([server, "-p", str(args.port)], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    time.sleep(0.5)
+    cmd = [args.bench, "-p", str(args.port), "-c", str(args.connections), "-d", str(args.duration)]
+    if args.close:
+        cmd.append("-C")
+    bench = subprocess.Popen(cmd, stdout=subprocess.PIPE, text=True)
+
+    # 均匀分布在压测时间内 每次升级最新的进程
+    interval = args.duration / (args.upgrades + 1)
+    for _ in range(args.upgrades):
+        time.sleep(interval)
+        pids = server_pids(args.port)
+        print("upgrade pid %d" % max(pids))
+        os.kill(max(pids), signal.SIGUSR2)
+
+    out, _ = bench.communicate()
+    print(out, end="")
+    time.sleep(0.5)
+    pids = server_pids(args.port)
+    for pid in pids:
+        os.kill(pid, signal.SIGTERM)
+
+    errors = int(re.search(r"Errors:\s+(\d+)", out).group(1))
+    ok = errors == 0 and len(pids) == 1
+    print("%s: %d errors, %d server processes after upgrade" % ("OK" if ok else "FAIL", errors, len(pids)))
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
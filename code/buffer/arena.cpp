@@ -0,0 +1,105 @@
+#include "arena.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+Arena::Arena(size_t blockSize) : blockSize_(blockSize), current_(0), offset_(0), used_(0), reserved_(0) {}
+
+void *Arena::Allocate(size_t len, size_t align)
+{
+    assert(align && (align & (align - 1)) == 0);
+    if (!blocks_.empty())
+    {
+        Block &block = blocks_[current_];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t start = ((base + offset_ + align - 1) & ~(align - 1)) - base;
+        if (start + len <= block.size)
+        {
+            offset_ = start + len;
+            used_ += len;
+            return block.data.get() + start;
+        }
+    }
+    NextBlock_(len, align);
+    Block &block = blocks_[current_];
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    size_t start = ((base + align - 1) & ~(align - 1)) - base;
+    offset_ = start + len;
+    used_ += len;
+    return block.data.get() + start;
+}
+
+std::string_view Arena::Copy(std::string_view str)
+{
+    return std::string_view(CopyMutable(str), str.size());
+}
+
+char *Arena::CopyMutable(std::string_view str)
+{
+    if (str.empty())
+    {
+        return nullptr;
+    }
+    char *p = static_cast<char *>(Allocate(str.size(), 1));
+    memcpy(p, str.data(), str.size());
+    return p;
+}
+
+void Arena::Reset()
+{
+    // 一般情况下只移动指针 偶尔的大请求之后释放多余的块
+    if (reserved_ > MAX_RETAINED)
+    {
+        while (blocks_.size() > 1 && reserved_ > MAX_RETAINED)
+        {
+            reserved_ -= blocks_.back().size;
+            blocks_.pop_back();
+        }
+    }
+    current_ = 0;
+    offset_ = 0;
+    used_ = 0;
+}
+
+size_t Arena::Used() const
+{
+    return used_;
+}
+
+size_t Arena::Reserved() const
+{
+    return reserved_;
+}
+
+void *Arena::do_allocate(size_t bytes, size_t align)
+{
+    return Allocate(bytes, align);
+}
+
+// 单独的释放不回收内存 Reset时统一回收
+void Arena::do_deallocate(void *, size_t, size_t) {}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+void Arena::NextBlock_(size_t len, size_t align)
+{
+    // 复用Reset之前申请的块
+    while (!blocks_.empty() && current_ + 1 < blocks_.size())
+    {
+        current_++;
+        offset_ = 0;
+        if (len + align <= blocks_[current_].size)
+        {
+            return;
+        }
+    }
+    size_t size = len + align > blockSize_ ? len + align : blockSize_;
+    blocks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+    reserved_ += size;
+    current_ = blocks_.size() - 1;
+    offset_ = 0;
+}
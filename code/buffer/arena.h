@@ -0,0 +1,73 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+/**
+ * 请求级的线性分配器
+ * 按块申请内存，分配只移动指针，不单独释放；Reset()把指针移回第一块，已申请的块留给下一个请求复用。
+ * 保存解析出的字符串等只在一个请求内使用的数据，请求之间不再产生内存分配。
+ * 同时是std::pmr::memory_resource，std::pmr容器可以直接在其上分配，释放为空操作；
+ * Reset()之前必须先丢弃这些容器(见ResetContainer)。
+ */
+class Arena : public std::pmr::memory_resource
+{
+public:
+    explicit Arena(size_t blockSize = BLOCK_SIZE);
+    ~Arena() override = default;
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *Allocate(size_t len, size_t align = alignof(std::max_align_t));
+
+    // 拷贝字符串 返回指向拷贝的视图
+    std::string_view Copy(std::string_view str);
+    // 拷贝为可写的字符数组 用于原地解码
+    char *CopyMutable(std::string_view str);
+
+    // 丢弃所有分配 保留的块超过上限时释放多余的块
+    void Reset();
+
+    // 丢弃分配在arena上的pmr容器 元素不需要析构时为O(1) 在Reset()之前调用
+    template <class Container>
+    static void ResetContainer(Container &c)
+    {
+        Container(c.get_allocator()).swap(c);
+    }
+
+    // 当前已分配的字节数 / 持有的内存
+    size_t Used() const;
+    size_t Reserved() const;
+
+    static const size_t BLOCK_SIZE = 4096;
+    static const size_t MAX_RETAINED = 64 * 1024;
+
+protected:
+    void *do_allocate(size_t bytes, size_t align) override;
+    void do_deallocate(void *p, size_t bytes, size_t align) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    // 切换到能容纳len字节的下一块
+    void NextBlock_(size_t len, size_t align);
+
+    std::vector<Block> blocks_;
+    size_t blockSize_;
+    size_t current_; // 当前块的下标
+    size_t offset_;  // 当前块已使用的字节数
+    size_t used_;
+    size_t reserved_;
+};
+
+#endif // ARENA_H
@@ -1,7 +1,53 @@
 #include "buffer.h"
+#include "bufferpool.h"
+
+#ifdef BUFFER_THREAD_CHECK
+Buffer::AccessGuard_::AccessGuard_(const Buffer *buff) : buff_(buff)
+{
+    std::thread::id self = std::this_thread::get_id();
+    std::thread::id expected;
+    if (!buff_->accessThread_.compare_exchange_strong(expected, self))
+    {
+        // 已被占用 只允许同一线程重入
+        assert(expected == self && "Buffer accessed by multiple threads concurrently");
+    }
+    buff_->accessDepth_++;
+}
+
+Buffer::AccessGuard_::~AccessGuard_()
+{
+    if (--buff_->accessDepth_ == 0)
+    {
+        buff_->accessThread_.store(std::thread::id());
+    }
+}
+
+#define BUFFER_THREAD_CHECK_SCOPE() AccessGuard_ accessGuard_(this)
+#else
+#define BUFFER_THREAD_CHECK_SCOPE()
+#endif
 
 Buffer::Buffer(int initBuffSize) : buffer_(initBuffSize), readPos_(0), writePos_(0) {}
 
+// 归还存储 之后的写入会重新借用
+void Buffer::Release()
+{
+    BUFFER_THREAD_CHECK_SCOPE();
+    if (ReadableBytes() > 0 || buffer_.empty())
+    {
+        return;
+    }
+    BufferPool::Release(std::move(buffer_));
+    buffer_.clear();
+    readPos_ = 0;
+    writePos_ = 0;
+}
+
+size_t Buffer::Capacity() const
+{
+    return buffer_.size();
+}
+
 // 可读数量
 size_t Buffer::ReadableBytes() const
 {
@@ -29,6 +75,7 @@ const char *Buffer::Peek() const
 // 读取len长度 移动读下标
 void Buffer::Retrieve(size_t len)
 {
+    BUFFER_THREAD_CHECK_SCOPE();
     assert(len <= ReadableBytes());
     readPos_ += len;
 }
@@ -40,10 +87,10 @@ void Buffer::RetrieveUntil(const char *end)
     Retrieve(end - Peek());
 }
 
-// 清空数据 下标还原
+// 清空数据 只还原下标 O(1)
 void Buffer::RetrieveAll()
 {
-    bzero(&buffer_[0], buffer_.size());
+    BUFFER_THREAD_CHECK_SCOPE();
     readPos_ = 0;
     writePos_ = 0;
 }
@@ -69,6 +116,7 @@ char *Buffer::BeginWrite()
 
 void Buffer::HasWritten(size_t len)
 {
+    BUFFER_THREAD_CHECK_SCOPE();
     writePos_ += len;
 }
 
@@ -86,6 +134,7 @@ void Buffer::Append(const void *data, size_t len)
 
 void Buffer::Append(const char *str, size_t len)
 {
+    BUFFER_THREAD_CHECK_SCOPE();
     assert(str);
     // 确保可写的长度
     EnsureWriteable(len);
@@ -113,19 +162,24 @@ void Buffer::EnsureWriteable(size_t len)
 // 将fd的内容读取到缓冲区
 ssize_t Buffer::ReadFd(int fd, int *saveErrno)
 {
-    char buff[65535];
+    BUFFER_THREAD_CHECK_SCOPE();
+    // 溢出部分先读到线程局部的临时空间 没有存储时全部读到临时空间
+    char *buff = BufferPool::Scratch();
     struct iovec iov[2];
     const size_t writable = WritableBytes();
     /* 分散读， 保证数据全部读完 */
     iov[0].iov_base = BeginPtr_() + writePos_;
     iov[0].iov_len = writable;
     iov[1].iov_base = buff;
-    iov[1].iov_len = sizeof(buff);
+    iov[1].iov_len = BufferPool::ScratchSize();
 
-    const ssize_t len = readv(fd, iov, 2);
+    const ssize_t len = writable ? readv(fd, iov, 2) : readv(fd, iov + 1, 1);
     if (len < 0)
     {
-        *saveErrno = errno;
+        if (saveErrno)
+        {
+            *saveErrno = errno;
+        }
     }
     else if (static_cast<size_t>(len) <= writable)
     {
@@ -142,6 +196,7 @@ ssize_t Buffer::ReadFd(int fd, int *saveErrno)
 // 将buffer中可读的区域写入fd中
 ssize_t Buffer::WriteFd(int fd, int *saveErrno)
 {
+    BUFFER_THREAD_CHECK_SCOPE();
     size_t readSize = ReadableBytes();
     ssize_t len = write(fd, Peek(), readSize);
     if (len < 0)
@@ -155,18 +210,23 @@ ssize_t Buffer::WriteFd(int fd, int *saveErrno)
 
 char *Buffer::BeginPtr_()
 {
-    return &*buffer_.begin();
+    return buffer_.data();
 }
 
 const char *Buffer::BeginPtr_() const
 {
-    return &*buffer_.begin();
+    return buffer_.data();
 }
 
 // 扩展空间
 void Buffer::MakeSpace_(size_t len)
 {
-    if (WritableBytes() + PrependableBytes() < len)
+    if (buffer_.empty())
+    {
+        // 没有存储 从内存池借用
+        buffer_ = BufferPool::Acquire(len);
+    }
+    else if (WritableBytes() + PrependableBytes() < len)
     {
         buffer_.resize(writePos_ + len + 1);
     }
@@ -6,9 +6,17 @@
 #include <unistd.h>
 #include <sys/uio.h>
 #include <vector>
-#include <atomic>
 #include <assert.h>
+#ifdef BUFFER_THREAD_CHECK
+#include <atomic>
+#include <thread>
+#endif
 
+/**
+ * 初始大小为0时不预先分配存储，首次写入时从本线程的BufferPool借用，Release()后归还。
+ * 每个Buffer只属于一个线程(连接的读写缓冲区/日志在锁内使用的缓冲区)，读写下标为普通变量。
+ * 定义BUFFER_THREAD_CHECK时开启调试检查，多个线程同时访问同一个Buffer会触发断言。
+ */
 class Buffer
 {
 public:
@@ -37,6 +45,10 @@ public:
     void Append(const void *data, size_t len);
     void Append(const Buffer &buff);
 
+    // 没有未读数据时把存储归还内存池
+    void Release();
+    size_t Capacity() const;
+
     // 读接口 fd socket中的文件描述符
     ssize_t ReadFd(int fd, int *Errno);
     // 写接口
@@ -52,9 +64,24 @@ private:
     // 存储实体
     std::vector<char> buffer_;
     // 读位置下标
-    std::atomic<std::size_t> readPos_;
+    std::size_t readPos_;
     // 写位置下标
-    std::atomic<std::size_t> writePos_;
+    std::size_t writePos_;
+
+#ifdef BUFFER_THREAD_CHECK
+    // 调试模式 记录当前正在访问的线程 同一线程可重入
+    class AccessGuard_
+    {
+    public:
+        explicit AccessGuard_(const Buffer *buff);
+        ~AccessGuard_();
+
+    private:
+        const Buffer *buff_;
+    };
+    mutable std::atomic<std::thread::id> accessThread_;
+    mutable int accessDepth_ = 0;
+#endif
 };
 
 #endif //BUFFER_H
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "bufferpool.h"
+
+#include <memory>
+
+namespace
+{
+struct LocalPool
+{
+    std::vector<std::vector<char>> blocks;
+    std::unique_ptr<char[]> scratch;
+};
+
+LocalPool &Local()
+{
+    static thread_local LocalPool pool;
+    return pool;
+}
+} // namespace
+
+std::vector<char> BufferPool::Acquire(size_t minSize)
+{
+    LocalPool &pool = Local();
+    if (minSize <= BLOCK_SIZE && !pool.blocks.empty())
+    {
+        std::vector<char> block = std::move(pool.blocks.back());
+        pool.blocks.pop_back();
+        return block;
+    }
+    return std::vector<char>(minSize <= BLOCK_SIZE ? BLOCK_SIZE : minSize);
+}
+
+void BufferPool::Release(std::vector<char> &&block)
+{
+    LocalPool &pool = Local();
+    // 只缓存标准大小的块 大块直接释放
+    if (block.size() == BLOCK_SIZE && block.capacity() == BLOCK_SIZE && pool.blocks.size() < MAX_CACHED_BLOCKS)
+    {
+        pool.blocks.push_back(std::move(block));
+    }
+    std::vector<char>().swap(block);
+}
+
+char *BufferPool::Scratch()
+{
+    LocalPool &pool = Local();
+    if (!pool.scratch)
+    {
+        pool.scratch.reset(new char[SCRATCH_SIZE]);
+    }
+    return pool.scratch.get();
+}
+
+size_t BufferPool::ScratchSize()
+{
+    return SCRATCH_SIZE;
+}
+
+size_t BufferPool::CachedBlocks()
+{
+    return Local().blocks.size();
+}
@@ -0,0 +1,32 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * 线程局部的缓冲区内存池
+ * 连接只在有未处理数据时向池借用存储，空闲时归还，大量空闲的长连接几乎不占用接收内存。
+ * 标准大小的内存块在本线程内复用；超过标准大小的块归还时直接释放，避免连接长期持有大缓冲区。
+ */
+class BufferPool
+{
+public:
+    // 借用至少minSize字节的存储 返回的vector的size()即可用大小
+    static std::vector<char> Acquire(size_t minSize);
+    // 归还存储
+    static void Release(std::vector<char> &&block);
+
+    // 本线程读取socket时使用的临时空间 代替每次调用在栈上分配64KB
+    static char *Scratch();
+    static size_t ScratchSize();
+
+    // 本线程池中缓存的块数
+    static size_t CachedBlocks();
+
+    static const size_t BLOCK_SIZE = 4096;      // 标准块大小
+    static const size_t MAX_CACHED_BLOCKS = 256; // 每个线程最多缓存的块数
+    static const size_t SCRATCH_SIZE = 65536;
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,209 @@
+#include "chainbuffer.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+ChainBuffer::ChainBuffer() : head_(0), tail_(0), offset_(0), readable_(0) {}
+
+size_t ChainBuffer::ReadableBytes() const
+{
+    return readable_;
+}
+
+size_t ChainBuffer::SegmentCount() const
+{
+    return tail_ - head_;
+}
+
+ChainBuffer::Segment &ChainBuffer::NewSegment_(SEGMENT_KIND kind)
+{
+    if (tail_ == segs_.size())
+    {
+        if (head_ > 0)
+        {
+            // 已发送的槽位移到末尾复用
+            std::rotate(segs_.begin(), segs_.begin() + head_, segs_.end());
+            tail_ -= head_;
+            head_ = 0;
+        }
+        else
+        {
+            segs_.emplace_back();
+        }
+    }
+    Segment &seg = segs_[tail_++];
+    seg.kind = kind;
+    seg.data = nullptr;
+    seg.len = 0;
+    return seg;
+}
+
+void ChainBuffer::ReleaseSegment_(Segment &seg)
+{
+    seg.owner.reset();
+    // 超大的自有段不保留
+    if (seg.owned.capacity() > OWNED_SEGMENT_SIZE)
+    {
+        std::string().swap(seg.owned);
+    }
+    else
+    {
+        seg.owned.clear();
+    }
+}
+
+void ChainBuffer::Append(std::string_view str)
+{
+    Append(str.data(), str.size());
+}
+
+void ChainBuffer::Append(const char *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    assert(data);
+    // 尾部是自有段且未超过上限时直接合并
+    if (head_ == tail_ || segs_[tail_ - 1].kind != OWNED || segs_[tail_ - 1].owned.size() + len > OWNED_SEGMENT_SIZE)
+    {
+        NewSegment_(OWNED).owned.reserve(len > OWNED_SEGMENT_SIZE ? len : 1024);
+    }
+    segs_[tail_ - 1].owned.append(data, len);
+    readable_ += len;
+}
+
+void ChainBuffer::AppendStatic(const char *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    assert(data);
+    Segment &seg = NewSegment_(STATIC);
+    seg.data = data;
+    seg.len = len;
+    readable_ += len;
+}
+
+void ChainBuffer::AppendShared(std::shared_ptr<const void> owner, const char *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    assert(data && owner);
+    Segment &seg = NewSegment_(SHARED);
+    seg.data = data;
+    seg.len = len;
+    seg.owner = std::move(owner);
+    readable_ += len;
+}
+
+bool ChainBuffer::AppendFile(int fd, off_t offset, size_t len)
+{
+    if (len == 0)
+    {
+        return true;
+    }
+    std::shared_ptr<const char> region = MapFile(fd, offset, len);
+    if (!region)
+    {
+        return false;
+    }
+    const char *data = region.get();
+    AppendShared(std::move(region), data, len);
+    return true;
+}
+
+std::shared_ptr<const char> ChainBuffer::MapFile(int fd, off_t offset, size_t len)
+{
+    if (len == 0)
+    {
+        return nullptr;
+    }
+    // mmap的偏移必须按页对齐
+    static const off_t PAGE_SIZE = sysconf(_SC_PAGESIZE);
+    off_t aligned = offset - offset % PAGE_SIZE;
+    size_t mapLen = len + (offset - aligned);
+    void *addr = mmap(nullptr, mapLen, PROT_READ, MAP_PRIVATE, fd, aligned);
+    if (addr == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    const char *data = static_cast<const char *>(addr) + (offset - aligned);
+    return std::shared_ptr<const char>(data, [addr, mapLen](const char *)
+                                       { munmap(addr, mapLen); });
+}
+
+void ChainBuffer::Retrieve(size_t len)
+{
+    assert(len <= readable_);
+    readable_ -= len;
+    while (len > 0)
+    {
+        size_t remain = segs_[head_].Len() - offset_;
+        if (len < remain)
+        {
+            offset_ += len;
+            return;
+        }
+        len -= remain;
+        ReleaseSegment_(segs_[head_++]);
+        offset_ = 0;
+    }
+    if (head_ == tail_)
+    {
+        head_ = tail_ = 0;
+    }
+}
+
+void ChainBuffer::RetrieveAll()
+{
+    for (size_t i = head_; i < tail_; i++)
+    {
+        ReleaseSegment_(segs_[i]);
+    }
+    head_ = tail_ = 0;
+    offset_ = 0;
+    readable_ = 0;
+}
+
+int ChainBuffer::PrepareIovec(struct iovec *iov, int maxCnt) const
+{
+    int cnt = 0;
+    size_t offset = offset_;
+    for (size_t i = head_; i < tail_ && cnt < maxCnt; i++)
+    {
+        iov[cnt].iov_base = const_cast<char *>(segs_[i].Data() + offset);
+        iov[cnt].iov_len = segs_[i].Len() - offset;
+        offset = 0;
+        cnt++;
+    }
+    return cnt;
+}
+
+ssize_t ChainBuffer::WriteFd(int fd, int *saveErrno)
+{
+    struct iovec iov[IOV_MAX];
+    int cnt = PrepareIovec(iov, IOV_MAX);
+    if (cnt == 0)
+    {
+        return 0;
+    }
+    ssize_t len = writev(fd, iov, cnt);
+    if (len < 0)
+    {
+        if (saveErrno)
+        {
+            *saveErrno = errno;
+        }
+        return len;
+    }
+    Retrieve(len);
+    return len;
+}
@@ -0,0 +1,88 @@
+#ifndef CHAIN_BUFFER_H
+#define CHAIN_BUFFER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/**
+ * 链式输出缓冲区
+ * 由若干段组成: 自有数据(拷贝) / 借用的静态数据 / 文件映射区域 / 共享的缓存数据
+ * 只有自有数据会发生拷贝，其余段只记录指针和长度，发送时一次writev聚合写出(最多IOV_MAX段)，
+ * 可以从任意字节偏移继续发送，多个响应可以依次追加到同一个缓冲区中。
+ */
+class ChainBuffer
+{
+public:
+    ChainBuffer();
+    ~ChainBuffer() = default;
+
+    size_t ReadableBytes() const;
+    size_t SegmentCount() const;
+
+    // 拷贝追加 小块数据合并到尾部的自有段中
+    void Append(std::string_view str);
+    void Append(const char *data, size_t len);
+
+    // 借用数据 调用方保证其在发送完成前有效 如字符串字面量
+    void AppendStatic(const char *data, size_t len);
+
+    // 共享数据 由owner维持生命周期 如小文件缓存快照
+    void AppendShared(std::shared_ptr<const void> owner, const char *data, size_t len);
+
+    // 文件区域 映射fd的[offset, offset+len) 发送完成后自动解除映射
+    bool AppendFile(int fd, off_t offset, size_t len);
+
+    // 只读映射文件区域 返回的指针释放时解除映射 失败返回空
+    static std::shared_ptr<const char> MapFile(int fd, off_t offset, size_t len);
+
+    // 丢弃已发送的len字节
+    void Retrieve(size_t len);
+    void RetrieveAll();
+
+    // 从当前偏移开始填充iovec 返回使用的个数
+    int PrepareIovec(struct iovec *iov, int maxCnt) const;
+
+    // 聚合写入fd
+    ssize_t WriteFd(int fd, int *saveErrno);
+
+private:
+    enum SEGMENT_KIND
+    {
+        OWNED,
+        STATIC,
+        SHARED,
+    };
+
+    struct Segment
+    {
+        SEGMENT_KIND kind;
+        const char *data;                  // 非自有段的数据
+        size_t len;                        // 非自有段的长度
+        std::string owned;                 // 自有段的数据
+        std::shared_ptr<const void> owner; // 共享段的持有者
+
+        const char *Data() const { return kind == OWNED ? owned.data() : data; }
+        size_t Len() const { return kind == OWNED ? owned.size() : len; }
+    };
+
+    // 取一个空闲的段槽位追加到末尾
+    Segment &NewSegment_(SEGMENT_KIND kind);
+    // 释放段引用的数据 自有段保留容量供下次复用
+    static void ReleaseSegment_(Segment &seg);
+
+    // 自有段合并的上限 超过后新开一段 避免大块拷贝时反复扩容
+    static const size_t OWNED_SEGMENT_SIZE = 16 * 1024;
+
+    // 段槽位复用 [head_, tail_)为未发送的段 发送完的槽位及其自有段的容量留给后续响应 稳定后不再分配内存
+    std::vector<Segment> segs_;
+    size_t head_;
+    size_t tail_;
+    size_t offset_;   // 首段中已发送的字节数
+    size_t readable_; // 未发送的总字节数
+};
+
+#endif // CHAIN_BUFFER_H
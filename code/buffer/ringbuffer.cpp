@@ -0,0 +1,301 @@
+#include "ringbuffer.h"
+#include "bufferpool.h"
+
+#include <algorithm>
+#include <new>
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <vector>
+
+namespace
+{
+// 本线程缓存的默认大小镜像区域 避免每个连接都创建memfd并映射两次
+struct RegionPool
+{
+    std::vector<char *> regions;
+
+    ~RegionPool()
+    {
+        for (char *base : regions)
+        {
+            munmap(base, 2 * RingBuffer::DEFAULT_SIZE);
+        }
+    }
+};
+
+RegionPool &LocalRegions()
+{
+    static thread_local RegionPool pool;
+    return pool;
+}
+
+const size_t MAX_CACHED_REGIONS = 64;
+
+size_t PageRound(size_t len)
+{
+    static const size_t PAGE_SIZE = sysconf(_SC_PAGESIZE);
+    return (len + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+} // namespace
+
+RingBuffer::RingBuffer(int initBuffSize) : base_(nullptr), capacity_(0), readPos_(0), size_(0)
+{
+    if (initBuffSize > 0)
+    {
+        Grow_(initBuffSize);
+    }
+}
+
+RingBuffer::~RingBuffer()
+{
+    if (base_)
+    {
+        size_ = 0;
+        Release();
+    }
+}
+
+size_t RingBuffer::WritableBytes() const
+{
+    return capacity_ - size_;
+}
+
+size_t RingBuffer::ReadableBytes() const
+{
+    return size_;
+}
+
+// 环形缓冲区没有预留空间
+size_t RingBuffer::PrependableBytes() const
+{
+    return 0;
+}
+
+const char *RingBuffer::Peek() const
+{
+    return base_ + readPos_;
+}
+
+void RingBuffer::EnsureWriteable(size_t len)
+{
+    if (WritableBytes() < len)
+    {
+        Grow_(len);
+    }
+    assert(WritableBytes() >= len);
+}
+
+void RingBuffer::HasWritten(size_t len)
+{
+    assert(len <= WritableBytes());
+    size_ += len;
+}
+
+void RingBuffer::Retrieve(size_t len)
+{
+    assert(len <= ReadableBytes());
+    size_ -= len;
+    readPos_ += len;
+    if (readPos_ >= capacity_)
+    {
+        readPos_ -= capacity_;
+    }
+    // 读空后回到起点 让后续数据从镜像的前半段开始
+    if (size_ == 0)
+    {
+        readPos_ = 0;
+    }
+}
+
+void RingBuffer::RetrieveUntil(const char *end)
+{
+    assert(Peek() <= end);
+    Retrieve(end - Peek());
+}
+
+void RingBuffer::RetrieveAll()
+{
+    readPos_ = 0;
+    size_ = 0;
+}
+
+std::string RingBuffer::RetrieveAllToStr()
+{
+    std::string str(Peek(), ReadableBytes());
+    RetrieveAll();
+    return str;
+}
+
+const char *RingBuffer::BeginWriteConst() const
+{
+    return base_ + readPos_ + size_;
+}
+
+char *RingBuffer::BeginWrite()
+{
+    return base_ + readPos_ + size_;
+}
+
+void RingBuffer::Append(const std::string &str)
+{
+    Append(str.data(), str.length());
+}
+
+void RingBuffer::Append(const void *data, size_t len)
+{
+    assert(data);
+    Append(static_cast<const char *>(data), len);
+}
+
+void RingBuffer::Append(const char *str, size_t len)
+{
+    assert(str);
+    EnsureWriteable(len);
+    std::copy(str, str + len, BeginWrite());
+    HasWritten(len);
+}
+
+void RingBuffer::Release()
+{
+    if (size_ > 0 || base_ == nullptr)
+    {
+        return;
+    }
+    RegionPool &pool = LocalRegions();
+    if (capacity_ == DEFAULT_SIZE && pool.regions.size() < MAX_CACHED_REGIONS)
+    {
+        pool.regions.push_back(base_);
+    }
+    else
+    {
+        Unmap_(base_, capacity_);
+    }
+    base_ = nullptr;
+    capacity_ = 0;
+    readPos_ = 0;
+}
+
+size_t RingBuffer::Capacity() const
+{
+    return capacity_;
+}
+
+ssize_t RingBuffer::ReadFd(int fd, int *saveErrno)
+{
+    // 镜像映射保证可写区域连续 溢出部分读到线程局部的临时空间
+    char *buff = BufferPool::Scratch();
+    struct iovec iov[2];
+    const size_t writable = WritableBytes();
+    iov[0].iov_base = BeginWrite();
+    iov[0].iov_len = writable;
+    iov[1].iov_base = buff;
+    iov[1].iov_len = BufferPool::ScratchSize();
+
+    const ssize_t len = writable ? readv(fd, iov, 2) : readv(fd, iov + 1, 1);
+    if (len < 0)
+    {
+        if (saveErrno)
+        {
+            *saveErrno = errno;
+        }
+    }
+    else if (static_cast<size_t>(len) <= writable)
+    {
+        size_ += len;
+    }
+    else
+    {
+        size_ = capacity_;
+        Append(buff, len - writable);
+    }
+    return len;
+}
+
+ssize_t RingBuffer::WriteFd(int fd, int *saveErrno)
+{
+    ssize_t len = write(fd, Peek(), ReadableBytes());
+    if (len < 0)
+    {
+        if (saveErrno)
+        {
+            *saveErrno = errno;
+        }
+        return len;
+    }
+    Retrieve(len);
+    return len;
+}
+
+char *RingBuffer::Map_(size_t cap)
+{
+    if (cap == DEFAULT_SIZE && !LocalRegions().regions.empty())
+    {
+        char *base = LocalRegions().regions.back();
+        LocalRegions().regions.pop_back();
+        return base;
+    }
+
+    int fd = memfd_create("ringbuffer", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    if (ftruncate(fd, cap) < 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+    // 先保留2倍容量的地址空间 再把同一个memfd固定映射到前后两半
+    void *addr = mmap(nullptr, 2 * cap, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+    {
+        close(fd);
+        return nullptr;
+    }
+    char *base = static_cast<char *>(addr);
+    if (mmap(base, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + cap, cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(base, 2 * cap);
+        close(fd);
+        return nullptr;
+    }
+    // 映射会保持对memfd的引用 fd可以直接关闭
+    close(fd);
+    return base;
+}
+
+void RingBuffer::Unmap_(char *base, size_t cap)
+{
+    munmap(base, 2 * cap);
+}
+
+void RingBuffer::Grow_(size_t len)
+{
+    size_t cap = capacity_ ? capacity_ : DEFAULT_SIZE;
+    while (cap - size_ < len)
+    {
+        cap *= 2;
+    }
+    cap = PageRound(cap);
+    char *base = Map_(cap);
+    // 无法映射时与std::vector分配失败的行为一致
+    if (base == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    if (base_)
+    {
+        std::copy(Peek(), Peek() + size_, base);
+        size_t size = size_;
+        size_ = 0;
+        Release();
+        size_ = size;
+    }
+    base_ = base;
+    capacity_ = cap;
+    readPos_ = 0;
+}
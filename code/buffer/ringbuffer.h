@@ -0,0 +1,66 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * 虚拟内存镜像的环形缓冲区
+ * 同一块memfd内存在虚拟地址空间中连续映射两次，环形缓冲区中任意位置开始的可读/可写区域在地址上都是连续的，
+ * 读写不需要处理回绕，也不需要像Buffer::MakeSpace_那样前移数据。接口与Buffer一致，可替换HttpConn的读缓冲区。
+ * 初始大小为0时不预先映射，首次写入时从本线程的映射池借用，Release()后归还。
+ */
+class RingBuffer
+{
+public:
+    RingBuffer(int initBuffSize = DEFAULT_SIZE);
+    ~RingBuffer();
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    size_t WritableBytes() const;
+    size_t ReadableBytes() const;
+    size_t PrependableBytes() const;
+
+    const char *Peek() const;
+    void EnsureWriteable(size_t len);
+    void HasWritten(size_t len);
+
+    void Retrieve(size_t len);
+    void RetrieveUntil(const char *end);
+
+    void RetrieveAll();
+    std::string RetrieveAllToStr();
+
+    const char *BeginWriteConst() const;
+    char *BeginWrite();
+
+    void Append(const std::string &str);
+    void Append(const char *str, size_t len);
+    void Append(const void *data, size_t len);
+
+    // 没有未读数据时把映射归还映射池
+    void Release();
+    size_t Capacity() const;
+
+    ssize_t ReadFd(int fd, int *Errno);
+    ssize_t WriteFd(int fd, int *Errno);
+
+    static const size_t DEFAULT_SIZE = 64 * 1024;
+
+private:
+    // 映射容量为cap的镜像区域 失败返回nullptr
+    static char *Map_(size_t cap);
+    static void Unmap_(char *base, size_t cap);
+    // 扩容到至少能再写入len字节
+    void Grow_(size_t len);
+
+    char *base_;    // 镜像区域起始地址 长度为 2 * capacity_
+    size_t capacity_;
+    size_t readPos_; // 读位置 [0, capacity_)
+    size_t size_;    // 未读字节数
+};
+
+#endif // RING_BUFFER_H
@@ -1,5 +1,10 @@
 #include "config.h"
 
+#include <sched.h>
+
+std::shared_ptr<const Config> Config::published_;
+std::atomic<uint64_t> Config::version_(0);
+
 Config::Config()
 {
     port = 3000;
@@ -9,9 +14,28 @@ Config::Config()
     openLog = true;
     logLevel = 1;
     logQueSize = 1024;
+    fileCacheMaxSize = 64 * 1024;
+    fileCacheCapacity = 32 * 1024 * 1024;
+    bodySpillSize = 1024 * 1024;
+    maxConnections = 10000;
+    maxQueue = 1024;
+    queueTargetMS = 5;
+    connRateLimit = 0;
+    connRateBurst = 50;
+    requestRateLimit = 0;
+    requestRateBurst = 200;
+    rateLimitClients = 1 << 20;
+    headerTimeoutMS = 10000;
+    bodyTimeoutMS = 10000;
+    bodyMinRate = 500;
+    maxHeaderSize = 16 * 1024;
+    shutdownTimeoutMS = 10000;
+    workerProcesses = 0;
+    incomingCpu = false;
     config_file = "./config.ini";
     resources_dir = "./resources";
     logs_dir = "./logs";
+    upload_dir = "";
 }
 
 Config::~Config()
@@ -20,6 +44,7 @@ Config::~Config()
 
 void Config::parse_cmd_arg(int argc, char *argv[])
 {
+    args_.assign(argv, argv + argc);
     // 第一步：先从命令行中提取 -c 或 --config 指定的配置文件路径
     for (int i = 1; i < argc; ++i)
     {
@@ -58,6 +83,105 @@ void Config::parse_cmd_arg(int argc, char *argv[])
     }
 }
 
+std::shared_ptr<Config> Config::reload() const
+{
+    auto next = std::make_shared<Config>();
+    next->config_file = config_file;
+    next->args_ = args_;
+    if (!next->load_from_ini())
+    {
+        return nullptr;
+    }
+
+    // getopt从optind开始 再次解析前复位
+    std::vector<char *> argv;
+    for (std::string &arg : next->args_)
+    {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+    optind = 1;
+    next->parse_cmd_args((int)next->args_.size(), argv.data());
+    if (!next->check_config())
+    {
+        return nullptr;
+    }
+    return next;
+}
+
+std::string Config::restart_fields(const Config &next) const
+{
+    std::string fields;
+    auto check = [&fields](bool changed, const char *name)
+    {
+        if (changed)
+        {
+            fields += (fields.empty() ? "" : ", ") + std::string(name);
+        }
+    };
+    check(port != next.port, "port");
+    check(connPoolNum != next.connPoolNum, "connPoolNum");
+    check(logQueSize != next.logQueSize, "logQueSize");
+    check(connRateLimit != next.connRateLimit || connRateBurst != next.connRateBurst, "connRateLimit");
+    check(requestRateLimit != next.requestRateLimit || requestRateBurst != next.requestRateBurst,
+          "requestRateLimit");
+    check(rateLimitClients != next.rateLimitClients, "rateLimitClients");
+    check(workerProcesses != next.workerProcesses, "workerProcesses");
+    check(reactorCpus != next.reactorCpus || threadPoolCpus != next.threadPoolCpus || logCpus != next.logCpus ||
+              workerCpus != next.workerCpus,
+          "cpu lists");
+    check(incomingCpu != next.incomingCpu, "incomingCpu");
+    check(resources_dir != next.resources_dir, "resources_dir");
+    check(logs_dir != next.logs_dir, "logs_dir");
+    return fields;
+}
+
+void Config::keep_restart_fields(const Config &running)
+{
+    port = running.port;
+    connPoolNum = running.connPoolNum;
+    logQueSize = running.logQueSize;
+    connRateLimit = running.connRateLimit;
+    connRateBurst = running.connRateBurst;
+    requestRateLimit = running.requestRateLimit;
+    requestRateBurst = running.requestRateBurst;
+    rateLimitClients = running.rateLimitClients;
+    workerProcesses = running.workerProcesses;
+    reactorCpus = running.reactorCpus;
+    threadPoolCpus = running.threadPoolCpus;
+    logCpus = running.logCpus;
+    workerCpus = running.workerCpus;
+    incomingCpu = running.incomingCpu;
+    resources_dir = running.resources_dir;
+    logs_dir = running.logs_dir;
+}
+
+void Config::publish(std::shared_ptr<const Config> config)
+{
+    std::atomic_store(&published_, std::move(config));
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+const Config &Config::current()
+{
+    // 版本号不变时直接用本线程缓存的快照 不碰共享的引用计数
+    thread_local uint64_t version = 0;
+    thread_local std::shared_ptr<const Config> cached;
+    uint64_t latest = version_.load(std::memory_order_acquire);
+    if (version != latest)
+    {
+        cached = std::atomic_load(&published_);
+        version = latest;
+    }
+    static const Config defaults;
+    return cached ? *cached : defaults;
+}
+
+std::shared_ptr<const Config> Config::snapshot()
+{
+    return std::atomic_load(&published_);
+}
+
 bool Config::check_config() const
 {
     bool valid = true;
@@ -110,6 +234,69 @@ bool Config::check_config() const
         valid = false;
     }
 
+    // 检查小文件缓存
+    if (fileCacheMaxSize < 0 || fileCacheCapacity < 0)
+    {
+        std::cerr << "[ERROR] Invalid fileCacheMaxSize/fileCacheCapacity: " << fileCacheMaxSize
+                  << "/" << fileCacheCapacity << ". Must be non-negative." << std::endl;
+        valid = false;
+    }
+
+    // 检查请求体转存阈值
+    if (bodySpillSize < 0)
+    {
+        std::cerr << "[ERROR] Invalid bodySpillSize: " << bodySpillSize
+                  << ". Must be non-negative." << std::endl;
+        valid = false;
+    }
+
+    // 检查准入控制
+    if (maxConnections <= 0 || maxQueue <= 0 || queueTargetMS <= 0)
+    {
+        std::cerr << "[ERROR] Invalid maxConnections/maxQueue/queueTargetMS: " << maxConnections << "/" << maxQueue
+                  << "/" << queueTargetMS << ". Must be positive." << std::endl;
+        valid = false;
+    }
+
+    // 检查限速
+    if (connRateLimit < 0 || requestRateLimit < 0 || connRateBurst <= 0 || requestRateBurst <= 0 ||
+        rateLimitClients <= 0)
+    {
+        std::cerr << "[ERROR] Invalid connRateLimit/connRateBurst/requestRateLimit/requestRateBurst/rateLimitClients: "
+                  << connRateLimit << "/" << connRateBurst << "/" << requestRateLimit << "/" << requestRateBurst << "/"
+                  << rateLimitClients << ". Rates must be non-negative, the rest positive." << std::endl;
+        valid = false;
+    }
+
+    // 检查慢速客户端的时限
+    if (headerTimeoutMS <= 0 || bodyTimeoutMS <= 0 || bodyMinRate <= 0 || maxHeaderSize <= 0)
+    {
+        std::cerr << "[ERROR] Invalid headerTimeoutMS/bodyTimeoutMS/bodyMinRate/maxHeaderSize: " << headerTimeoutMS
+                  << "/" << bodyTimeoutMS << "/" << bodyMinRate << "/" << maxHeaderSize << ". Must be positive."
+                  << std::endl;
+        valid = false;
+    }
+
+    if (shutdownTimeoutMS <= 0)
+    {
+        std::cerr << "[ERROR] Invalid shutdownTimeoutMS: " << shutdownTimeoutMS << ". Must be positive." << std::endl;
+        valid = false;
+    }
+
+    if (workerProcesses < -1)
+    {
+        std::cerr << "[ERROR] Invalid workerProcesses: " << workerProcesses << ". Must be -1, 0 or positive."
+                  << std::endl;
+        valid = false;
+    }
+
+    if (!invalid_cpus_.empty())
+    {
+        std::cerr << "[ERROR] Invalid CPU list: " << invalid_cpus_ << ". Must be like 0-3,8 with CPUs below "
+                  << CPU_SETSIZE << "." << std::endl;
+        valid = false;
+    }
+
     return valid;
 }
 
@@ -159,7 +346,8 @@ void Config::print_usage(const char *progName)
 
 bool Config::load_from_ini()
 {
-    auto config = parse_ini(config_file);
+    std::unordered_map<std::string, std::string> config;
+    bool ok = parse_ini(config_file, config);
 
     if (config.count("port"))
     {
@@ -191,6 +379,125 @@ bool Config::load_from_ini()
         logQueSize = std::atoi(value.c_str());
     }
 
+    if (config.count("fileCacheMaxSize"))
+    {
+        auto value = config.find("fileCacheMaxSize")->second;
+        fileCacheMaxSize = std::atoi(value.c_str());
+    }
+
+    if (config.count("fileCacheCapacity"))
+    {
+        auto value = config.find("fileCacheCapacity")->second;
+        fileCacheCapacity = std::atoi(value.c_str());
+    }
+
+    if (config.count("bodySpillSize"))
+    {
+        auto value = config.find("bodySpillSize")->second;
+        bodySpillSize = std::atoi(value.c_str());
+    }
+
+    if (config.count("maxConnections"))
+    {
+        auto value = config.find("maxConnections")->second;
+        maxConnections = std::atoi(value.c_str());
+    }
+
+    if (config.count("maxQueue"))
+    {
+        auto value = config.find("maxQueue")->second;
+        maxQueue = std::atoi(value.c_str());
+    }
+
+    if (config.count("queueTargetMS"))
+    {
+        auto value = config.find("queueTargetMS")->second;
+        queueTargetMS = std::atoi(value.c_str());
+    }
+
+    if (config.count("connRateLimit"))
+    {
+        auto value = config.find("connRateLimit")->second;
+        connRateLimit = std::atoi(value.c_str());
+    }
+
+    if (config.count("connRateBurst"))
+    {
+        auto value = config.find("connRateBurst")->second;
+        connRateBurst = std::atoi(value.c_str());
+    }
+
+    if (config.count("requestRateLimit"))
+    {
+        auto value = config.find("requestRateLimit")->second;
+        requestRateLimit = std::atoi(value.c_str());
+    }
+
+    if (config.count("requestRateBurst"))
+    {
+        auto value = config.find("requestRateBurst")->second;
+        requestRateBurst = std::atoi(value.c_str());
+    }
+
+    if (config.count("rateLimitClients"))
+    {
+        auto value = config.find("rateLimitClients")->second;
+        rateLimitClients = std::atoi(value.c_str());
+    }
+
+    if (config.count("headerTimeoutMS"))
+    {
+        auto value = config.find("headerTimeoutMS")->second;
+        headerTimeoutMS = std::atoi(value.c_str());
+    }
+
+    if (config.count("bodyTimeoutMS"))
+    {
+        auto value = config.find("bodyTimeoutMS")->second;
+        bodyTimeoutMS = std::atoi(value.c_str());
+    }
+
+    if (config.count("bodyMinRate"))
+    {
+        auto value = config.find("bodyMinRate")->second;
+        bodyMinRate = std::atoi(value.c_str());
+    }
+
+    if (config.count("maxHeaderSize"))
+    {
+        auto value = config.find("maxHeaderSize")->second;
+        maxHeaderSize = std::atoi(value.c_str());
+    }
+
+    if (config.count("shutdownTimeoutMS"))
+    {
+        auto value = config.find("shutdownTimeoutMS")->second;
+        shutdownTimeoutMS = std::atoi(value.c_str());
+    }
+
+    if (config.count("workerProcesses"))
+    {
+        auto value = config.find("workerProcesses")->second;
+        workerProcesses = std::atoi(value.c_str());
+    }
+
+    const std::pair<const char *, std::vector<int> *> cpuLists[] = {
+        {"reactorCpus", &reactorCpus}, {"threadPoolCpus", &threadPoolCpus},
+        {"logCpus", &logCpus}, {"workerCpus", &workerCpus}};
+    for (const auto &list : cpuLists)
+    {
+        if (config.count(list.first) && !parse_cpu_list(config.find(list.first)->second, *list.second))
+        {
+            invalid_cpus_ = std::string(list.first) + "=" + config.find(list.first)->second;
+        }
+    }
+
+    if (config.count("incomingCpu"))
+    {
+        auto value = config.find("incomingCpu")->second;
+        incomingCpu = std::atoi(value.c_str()) != 0;
+    }
+
     if (config.count("resources_dir"))
     {
         resources_dir = config.find("resources_dir")->second;
@@ -201,11 +508,53 @@ bool Config::load_from_ini()
         logs_dir = config.find("logs_dir")->second;
     }
 
+    if (config.count("upload_dir"))
+    {
+        upload_dir = config.find("upload_dir")->second;
+    }
+
     // for (const auto& [key, value] : config) {
     //     std::cout << key << " = " << value << std::endl;
     // }
 
-    return false;
+    return ok;
+}
+
+bool Config::parse_cpu_list(const std::string &value, std::vector<int> &cpus)
+{
+    cpus.clear();
+    size_t pos = 0;
+    while (pos <= value.size())
+    {
+        size_t end = value.find(',', pos);
+        std::string item = value.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        size_t dash = item.find('-');
+        char *rest = nullptr;
+        long first = std::strtol(item.c_str(), &rest, 10);
+        long last = first;
+        if (dash != std::string::npos)
+        {
+            if (rest != item.c_str() + dash)
+            {
+                return false;
+            }
+            last = std::strtol(item.c_str() + dash + 1, &rest, 10);
+        }
+        if (item.empty() || *rest != '\0' || first < 0 || last < first || last >= CPU_SETSIZE)
+        {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back((int)cpu);
+        }
+        if (end == std::string::npos)
+        {
+            break;
+        }
+        pos = end + 1;
+    }
+    return true;
 }
 
 std::string trim(const std::string &str)
@@ -217,22 +566,21 @@ std::string trim(const std::string &str)
     return str.substr(start, end - start + 1);
 }
 
-std::unordered_map<std::string, std::string> Config::parse_ini(const std::string &filename)
+bool Config::parse_ini(const std::string &filename, std::unordered_map<std::string, std::string> &config)
 {
     std::ifstream infile(filename);
-    std::unordered_map<std::string, std::string> config;
     std::string line;
 
     if (!infile.is_open())
     {
         std::cerr << "Error: Failed to open Config file." << std::endl;
-        return config;
+        return false;
     }
 
     if (!std::getline(infile, line))
     {
         std::cerr << "Error: File is empty." << std::endl;
-        return config;
+        return false;
     }
 
     // 检查第一行是否为 [server]
@@ -240,7 +588,7 @@ std::unordered_map<std::string, std::string> Config::parse_ini(const std::string
     if (trimmed_line != "[server]")
     {
         std::cerr << "Error: First line must be '[server]', found: '" << trimmed_line << "'" << std::endl;
-        return config;
+        return false;
     }
 
     while (std::getline(infile, line))
@@ -265,5 +613,5 @@ std::unordered_map<std::string, std::string> Config::parse_ini(const std::string
         }
     }
 
-    return config;
+    return true;
 }
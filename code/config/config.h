@@ -5,8 +5,17 @@
 #include <cstdlib>
 #include <iostream>
 #include <unordered_map>
+#include <vector>
 #include <fstream>
+#include <memory>
+#include <atomic>
 
+/**
+ * 配置 启动时由命令行与ini文件生成
+ * 运行中收到SIGHUP时重新读取ini文件(命令行参数仍然覆盖)，校验通过后发布为新的不可变快照。
+ * 读取快照不加锁：每个线程缓存一个shared_ptr，只在版本号变化时重新获取，
+ * 旧快照在所有线程都换到新版本后才释放(RCU)。
+ */
 class Config
 {
 public:
@@ -16,9 +25,23 @@ public:
     // 解析命令行参数
     void parse_cmd_arg(int argc, char *argv[]);
 
+    // 用启动时的命令行参数重新读取配置文件 文件无法读取或配置非法时返回nullptr(不退出)
+    std::shared_ptr<Config> reload() const;
+    // 与next相比有变化、但需要重启才能生效的配置项 逗号分隔 没有时为空
+    std::string restart_fields(const Config &next) const;
+    // 需要重启才能生效的配置项取running的值 发布后之后重启的worker与其他worker一致
+    void keep_restart_fields(const Config &running);
+
+    // 发布新的快照 之后读取的线程看到新配置
+    static void publish(std::shared_ptr<const Config> config);
+    // 当前快照 未发布时为默认配置 不要跨可能读取配置的调用持有返回的引用(期间可能换成新快照)
+    static const Config &current();
+    // 当前快照的所有权 需要长期持有时使用 比current()慢
+    static std::shared_ptr<const Config> snapshot();
+
     // 端口
     int port;
-    // 超时时间
+    // keep-alive空闲超时 发送响应时无进展的超时
     int timeoutMS;
     // 连接池数量
     int connPoolNum;
@@ -30,6 +53,45 @@ public:
     int logLevel;
     // 日志异步队列容量
     int logQueSize;
+    // 小文件缓存 单个文件大小上限(字节) 0表示只缓存错误页
+    int fileCacheMaxSize;
+    // 小文件缓存 总容量(字节)
+    int fileCacheCapacity;
+    // 请求体在内存中的上限(字节) 超过后转存到临时文件
+    int bodySpillSize;
+    // 准入控制 同时存在的连接数上限
+    int maxConnections;
+    // 准入控制 等待工作线程的连接数上限
+    int maxQueue;
+    // 准入控制 过载时连接允许排队的时间(毫秒)
+    int queueTargetMS;
+    // 按客户端地址限速 每秒新连接数与桶容量 速率为0不限制
+    int connRateLimit;
+    int connRateBurst;
+    // 按客户端地址限速 每秒请求数与桶容量 速率为0不限制
+    int requestRateLimit;
+    int requestRateBurst;
+    // 限速记录的客户端数 超过后替换最久未活动的
+    int rateLimitClients;
+    // 从请求的第一批数据到请求头收完的时限 也是新连接发送第一个请求的时限
+    int headerTimeoutMS;
+    // 接收请求体的初始时限与最低速率(字节/秒) 每收到bodyMinRate字节时限延长1秒
+    int bodyTimeoutMS;
+    int bodyMinRate;
+    // 请求行与请求头的总长度上限 超过时返回431
+    int maxHeaderSize;
+    // 收到SIGTERM后等待处理中的请求完成、日志写完的时限 超过后强制关闭
+    int shutdownTimeoutMS;
+    // 多进程模式的worker进程数 0为单进程 -1为每个CPU一个
+    int workerProcesses;
+    // 线程绑定的CPU 为空不绑定 reactor与日志写线程绑定到整个列表 工作线程依次各绑定一个
+    std::vector<int> reactorCpus;
+    std::vector<int> threadPoolCpus;
+    std::vector<int> logCpus;
+    // 多进程模式worker依次绑定的CPU 为空时用允许使用的所有CPU
+    std::vector<int> workerCpus;
+    // 多进程模式每个worker一个SO_REUSEPORT监听socket 新连接交给处理其网卡中断的CPU上的worker
+    bool incomingCpu;
 
     // 配置文件（可以从命令行参数指定）
     std::string config_file;
@@ -40,8 +102,11 @@ public:
     // 日志目录
     std::string logs_dir;
 
+    // multipart上传文件的保存目录 为空不保存
+    std::string upload_dir;
+
 private:
-    // 从ini配置文件读取配置
+    // 从ini配置文件读取配置 文件无法读取或格式错误时返回false
     bool load_from_ini();
     // 检查参数配置
     bool check_config() const;
@@ -50,7 +115,17 @@ private:
 
     void print_usage(const char* progName);
 
-    std::unordered_map<std::string, std::string> parse_ini(const std::string& filename);
+    bool parse_ini(const std::string &filename, std::unordered_map<std::string, std::string> &config);
+
+    // 解析"0-3,8"形式的CPU列表 非法时返回false
+    static bool parse_cpu_list(const std::string &value, std::vector<int> &cpus);
+    // 配置文件中非法的CPU列表
+    std::string invalid_cpus_;
+    // 启动时的命令行参数 重新加载时再次覆盖配置文件
+    std::vector<std::string> args_;
+
+    static std::shared_ptr<const Config> published_; // 通过std::atomic_load/atomic_store访问
+    static std::atomic<uint64_t> version_;           // 每次发布加一
 };
 
 #endif // CONFIG_H
\ No newline at end of file
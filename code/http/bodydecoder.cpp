@@ -0,0 +1,158 @@
+#include "bodydecoder.h"
+
+#include <algorithm>
+
+BodyDecoder::BodyDecoder() : state_(DONE), remain_(0), decoded_(0) {}
+
+void BodyDecoder::InitLength(size_t len)
+{
+    state_ = len ? LENGTH : DONE;
+    remain_ = len;
+    decoded_ = 0;
+}
+
+void BodyDecoder::InitChunked()
+{
+    state_ = CHUNK_SIZE;
+    remain_ = 0;
+    decoded_ = 0;
+}
+
+bool BodyDecoder::IsDone() const
+{
+    return state_ == DONE;
+}
+
+bool BodyDecoder::IsError() const
+{
+    return state_ == ERROR;
+}
+
+size_t BodyDecoder::Decoded() const
+{
+    return decoded_;
+}
+
+size_t BodyDecoder::Decode(const char *data, size_t len, const SliceHandler &handler)
+{
+    const char CRLF[] = "\r\n";
+    const char *p = data;
+    const char *end = data + len;
+    while (p < end && state_ != DONE && state_ != ERROR)
+    {
+        switch (state_)
+        {
+        case LENGTH:
+        case CHUNK_DATA:
+        {
+            size_t n = std::min(remain_, static_cast<size_t>(end - p));
+            if (!handler(p, n))
+            {
+                state_ = ERROR;
+                return p - data;
+            }
+            p += n;
+            remain_ -= n;
+            decoded_ += n;
+            if (remain_ == 0)
+            {
+                state_ = state_ == LENGTH ? DONE : CHUNK_CRLF;
+            }
+            break;
+        }
+        case CHUNK_CRLF:
+            if (end - p < 2)
+            {
+                return p - data;
+            }
+            if (p[0] != '\r' || p[1] != '\n')
+            {
+                state_ = ERROR;
+                return p - data;
+            }
+            p += 2;
+            state_ = CHUNK_SIZE;
+            break;
+        case CHUNK_SIZE:
+        case TRAILER:
+        {
+            const char *eol = std::search(p, end, CRLF, CRLF + 2);
+            if (eol == end)
+            {
+                // 行不完整 超过上限视为错误 否则等待更多数据
+                if (static_cast<size_t>(end - p) > MAX_LINE)
+                {
+                    state_ = ERROR;
+                }
+                return p - data;
+            }
+            if (static_cast<size_t>(eol - p) > MAX_LINE)
+            {
+                state_ = ERROR;
+                return p - data;
+            }
+            if (state_ == CHUNK_SIZE)
+            {
+                if (!ParseChunkSize_(p, eol))
+                {
+                    state_ = ERROR;
+                    return p - data;
+                }
+            }
+            else if (eol == p)
+            {
+                // trailer以空行结束 trailer字段本身忽略
+                state_ = DONE;
+            }
+            p = eol + 2;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return p - data;
+}
+
+bool BodyDecoder::ParseChunkSize_(const char *begin, const char *end)
+{
+    size_t size = 0;
+    int digits = 0;
+    const char *p = begin;
+    for (; p < end; p++)
+    {
+        int v;
+        if (*p >= '0' && *p <= '9')
+            v = *p - '0';
+        else if (*p >= 'a' && *p <= 'f')
+            v = *p - 'a' + 10;
+        else if (*p >= 'A' && *p <= 'F')
+            v = *p - 'A' + 10;
+        else
+            break;
+        // 防止溢出
+        if (++digits > 15)
+        {
+            return false;
+        }
+        size = size * 16 + v;
+    }
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        p++;
+    }
+    if (digits == 0 || (p < end && *p != ';'))
+    {
+        return false;
+    }
+    if (size == 0)
+    {
+        state_ = TRAILER;
+    }
+    else
+    {
+        remain_ = size;
+        state_ = CHUNK_DATA;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef BODY_DECODER_H
+#define BODY_DECODER_H
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * 请求体解码器
+ * 按Content-Length读取定长正文，或增量解码Transfer-Encoding: chunked。
+ * 每次只处理当前缓冲区中已有的字节，返回消耗的字节数，不完整的分块头留在缓冲区等待下次数据，
+ * 解码出的正文片段交给处理函数，不在内存中拼接完整的请求体。
+ */
+class BodyDecoder
+{
+public:
+    // 正文片段处理函数 返回false中止解码
+    typedef std::function<bool(const char *data, size_t len)> SliceHandler;
+
+    BodyDecoder();
+
+    // 定长正文 长度为0时直接完成
+    void InitLength(size_t len);
+    // 分块编码正文
+    void InitChunked();
+
+    // 解码[data, data + len) 返回消耗的字节数
+    size_t Decode(const char *data, size_t len, const SliceHandler &handler);
+
+    bool IsDone() const;
+    bool IsError() const;
+    // 已解码的正文字节数
+    size_t Decoded() const;
+
+    // 分块大小行与trailer行的长度上限
+    static const size_t MAX_LINE = 1024;
+
+private:
+    enum STATE
+    {
+        LENGTH,     // 定长正文
+        CHUNK_SIZE, // 分块大小行
+        CHUNK_DATA, // 分块数据
+        CHUNK_CRLF, // 分块数据后的回车换行
+        TRAILER,    // 最后一个分块后的trailer 以空行结束
+        DONE,
+        ERROR,
+    };
+
+    // 解析分块大小行 忽略分块扩展
+    bool ParseChunkSize_(const char *begin, const char *end);
+
+    STATE state_;
+    size_t remain_;  // 当前定长正文或分块剩余的字节数
+    size_t decoded_;
+};
+
+#endif // BODY_DECODER_H
@@ -0,0 +1,391 @@
+#include "filecache.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <set>
+#include <vector>
+
+#include "../buffer/buffer.h"
+#include "../log/log.h"
+#include "httpresponse.h"
+
+using namespace std;
+
+namespace
+{
+// 待缓存的文件
+struct Pending
+{
+    string path;     // 请求路径 如 /index.html
+    int code;        // 错误页为对应错误码 普通文件为0
+    string body;     // 文件内容
+    string header[2]; // close / keep-alive 两种响应头
+};
+
+// 读取整个文件 文件在读取期间被修改导致大小不一致时视为失败
+bool ReadWholeFile(const string &file, size_t size, string &out)
+{
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    out.resize(size);
+    size_t done = 0;
+    while (done < size)
+    {
+        ssize_t n = read(fd, &out[done], size - done);
+        if (n <= 0)
+        {
+            break;
+        }
+        done += n;
+    }
+    close(fd);
+    return done == size;
+}
+
+// 递归收集目录下的普通文件 path为相对资源目录的请求路径
+// 跟随符号链接 visited记录走过的目录(dev, ino) 指向上级目录的链接不会无限递归
+void CollectFiles(const string &root, const string &path, vector<pair<string, struct stat>> &files,
+                  set<pair<dev_t, ino_t>> &visited)
+{
+    struct stat self;
+    if (stat((root + path).c_str(), &self) < 0 || !visited.insert({self.st_dev, self.st_ino}).second)
+    {
+        return;
+    }
+    DIR *dir = opendir((root + path).c_str());
+    if (dir == nullptr)
+    {
+        return;
+    }
+    while (struct dirent *ent = readdir(dir))
+    {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+        {
+            continue;
+        }
+        string sub = path + "/" + ent->d_name;
+        struct stat st;
+        if (stat((root + sub).c_str(), &st) < 0)
+        {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode))
+        {
+            CollectFiles(root, sub, files, visited);
+        }
+        else if (S_ISREG(st.st_mode))
+        {
+            files.emplace_back(sub, st);
+        }
+    }
+    closedir(dir);
+}
+} // namespace
+
+FileCache::Snapshot::~Snapshot()
+{
+    if (arena_)
+    {
+        munmap(arena_, arenaSize_);
+    }
+}
+
+const FileCache::Entry *FileCache::Snapshot::Find(string_view path) const
+{
+    auto it = files_.find(path);
+    return it == files_.end() ? nullptr : &it->second;
+}
+
+const FileCache::Entry *FileCache::Snapshot::FindError(int code) const
+{
+    auto it = errors_.find(code);
+    return it == errors_.end() ? nullptr : &it->second;
+}
+
+FileCache::FileCache()
+{
+    maxFileSize_ = 0;
+    capacity_ = 0;
+    inotifyFd_ = -1;
+    wakeupFd_[0] = wakeupFd_[1] = -1;
+}
+
+FileCache::~FileCache()
+{
+    Close();
+}
+
+FileCache *FileCache::Instance()
+{
+    static FileCache inst;
+    return &inst;
+}
+
+void FileCache::Init(const string &srcDir, size_t maxFileSize, size_t capacity)
+{
+    Close();
+    srcDir_ = srcDir;
+    maxFileSize_ = maxFileSize;
+    capacity_ = capacity;
+    Rebuild_();
+
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0 || pipe2(wakeupFd_, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        LOG_WARN("FileCache: inotify unavailable, cache will not refresh on change");
+        return;
+    }
+    AddWatches_(srcDir_);
+    watchThread_.reset(new thread(&FileCache::WatchThread_, this));
+}
+
+void FileCache::Close()
+{
+    if (watchThread_ && watchThread_->joinable())
+    {
+        char ch = 0;
+        ::write(wakeupFd_[1], &ch, 1);
+        watchThread_->join();
+    }
+    watchThread_.reset();
+    if (inotifyFd_ >= 0)
+    {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+    }
+    for (int &fd : wakeupFd_)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    watches_.clear();
+}
+
+void FileCache::SetLimits(size_t maxFileSize, size_t capacity)
+{
+    {
+        lock_guard<mutex> locker(mtx_);
+        maxFileSize_ = maxFileSize;
+        capacity_ = capacity;
+    }
+    Rebuild_();
+}
+
+shared_ptr<const FileCache::Snapshot> FileCache::Current() const
+{
+    return atomic_load(&snapshot_);
+}
+
+void FileCache::Rebuild_()
+{
+    lock_guard<mutex> locker(mtx_);
+
+    vector<Pending> pending;
+    size_t total = 0;
+
+    // 错误页不受单文件大小限制 总是优先加载
+    for (const auto &item : HttpResponse::ErrorPages())
+    {
+        struct stat st;
+        string file = srcDir_ + item.second;
+        Pending p;
+        if (stat(file.c_str(), &st) < 0 || !S_ISREG(st.st_mode) ||
+            !ReadWholeFile(file, st.st_size, p.body))
+        {
+            LOG_WARN("FileCache: error page %s missing", file.c_str());
+            continue;
+        }
+        p.path = item.second;
+        p.code = item.first;
+        pending.push_back(move(p));
+    }
+
+    if (maxFileSize_ > 0)
+    {
+        vector<pair<string, struct stat>> files;
+        set<pair<dev_t, ino_t>> visited;
+        CollectFiles(srcDir_, "", files, visited);
+        for (auto &file : files)
+        {
+            const struct stat &st = file.second;
+            // 与HttpResponse一致 其他用户不可读的文件返回403 不缓存
+            if (static_cast<size_t>(st.st_size) > maxFileSize_ || !(st.st_mode & S_IROTH))
+            {
+                continue;
+            }
+            if (total + st.st_size > capacity_)
+            {
+                LOG_WARN("FileCache: capacity %zu reached, %s not cached", capacity_, file.first.c_str());
+                continue;
+            }
+            Pending p;
+            if (!ReadWholeFile(srcDir_ + file.first, st.st_size, p.body))
+            {
+                continue;
+            }
+            total += st.st_size;
+            p.path = move(file.first);
+            p.code = 0;
+            pending.push_back(move(p));
+        }
+    }
+
+    // 预生成响应头 计算连续内存的总大小
+    size_t arenaSize = 0;
+    for (Pending &p : pending)
+    {
+        for (int keepAlive = 0; keepAlive < 2; keepAlive++)
+        {
+            Buffer buff(256);
+            HttpResponse::MakeHeader(buff, p.code ? p.code : 200, keepAlive, p.path, p.body.size());
+            p.header[keepAlive] = buff.RetrieveAllToStr();
+            arenaSize += p.header[keepAlive].size() + p.body.size();
+        }
+        // 普通文件的请求路径也放入连续内存 作为查找的key
+        arenaSize += p.code ? 0 : p.path.size();
+    }
+
+    shared_ptr<Snapshot> snap = make_shared<Snapshot>();
+    if (arenaSize > 0)
+    {
+        void *mem = mmap(nullptr, arenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+        {
+            LOG_ERROR("FileCache: mmap %zu bytes failed", arenaSize);
+            return;
+        }
+        snap->arena_ = static_cast<char *>(mem);
+        snap->arenaSize_ = arenaSize;
+
+        char *pos = snap->arena_;
+        for (const Pending &p : pending)
+        {
+            Entry entry;
+            for (int keepAlive = 0; keepAlive < 2; keepAlive++)
+            {
+                char *begin = pos;
+                pos = copy(p.header[keepAlive].begin(), p.header[keepAlive].end(), pos);
+                pos = copy(p.body.begin(), p.body.end(), pos);
+                entry.response[keepAlive] = string_view(begin, pos - begin);
+            }
+            if (p.code)
+            {
+                snap->errors_[p.code] = entry;
+            }
+            else
+            {
+                char *key = pos;
+                pos = copy(p.path.begin(), p.path.end(), pos);
+                snap->files_[string_view(key, p.path.size())] = entry;
+            }
+        }
+        assert(pos == snap->arena_ + arenaSize);
+        // 构建完成后设为只读
+        if (mprotect(snap->arena_, arenaSize, PROT_READ) < 0)
+        {
+            LOG_ERROR("FileCache: mprotect %zu bytes failed", arenaSize);
+        }
+    }
+
+    LOG_INFO("FileCache: %zu files, %zu error pages, %zu bytes", snap->FileCount(), snap->errors_.size(), arenaSize);
+    atomic_store(&snapshot_, shared_ptr<const Snapshot>(move(snap)));
+}
+
+void FileCache::AddWatches_(const string &dir)
+{
+    const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB;
+    int wd = inotify_add_watch(inotifyFd_, dir.c_str(), mask);
+    if (wd < 0)
+    {
+        LOG_WARN("FileCache: watch %s failed", dir.c_str());
+        return;
+    }
+    // 同一目录返回同一wd 已经监听的目录(符号链接形成的环)不再递归
+    if (!watches_.emplace(wd, dir).second)
+    {
+        return;
+    }
+
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr)
+    {
+        return;
+    }
+    while (struct dirent *ent = readdir(d))
+    {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+        {
+            continue;
+        }
+        string sub = dir + "/" + ent->d_name;
+        struct stat st;
+        if (stat(sub.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+        {
+            AddWatches_(sub);
+        }
+    }
+    closedir(d);
+}
+
+// 监听线程 目录有变化时等待变化平息后重建快照
+void FileCache::WatchThread_()
+{
+    const int QUIET_MS = 100;
+    alignas(struct inotify_event) char buf[4096];
+    bool dirty = false;
+
+    while (true)
+    {
+        struct pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {wakeupFd_[0], POLLIN, 0}};
+        int ret = poll(fds, 2, dirty ? QUIET_MS : -1);
+        if (ret < 0 && errno != EINTR)
+        {
+            break;
+        }
+        if (fds[1].revents)
+        {
+            break;
+        }
+        if (ret == 0 && dirty)
+        {
+            dirty = false;
+            Rebuild_();
+            continue;
+        }
+        if (!(fds[0].revents & POLLIN))
+        {
+            continue;
+        }
+
+        ssize_t len;
+        while ((len = read(inotifyFd_, buf, sizeof(buf))) > 0)
+        {
+            for (char *p = buf; p < buf + len;)
+            {
+                struct inotify_event *ev = reinterpret_cast<struct inotify_event *>(p);
+                // 新建的子目录也需要监听
+                if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO)) && watches_.count(ev->wd))
+                {
+                    AddWatches_(watches_[ev->wd] + "/" + ev->name);
+                }
+                if (ev->mask & IN_IGNORED)
+                {
+                    watches_.erase(ev->wd);
+                }
+                p += sizeof(struct inotify_event) + ev->len;
+            }
+        }
+        dirty = true;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+/**
+ * 小文件缓存
+ * 启动时把资源目录下不超过阈值的小文件读入一块连续的只读内存，
+ * 并预先生成完整的响应报文(响应头+文件内容)，命中时一次write即可发出，不再stat/open/mmap。
+ * 错误页(400/403/404)总是加载，错误响应不访问文件系统。
+ * 后台线程通过inotify监听目录变化，重建新的快照后原子替换，旧快照在最后一个引用释放时回收。
+ */
+class FileCache
+{
+public:
+    // 一个缓存项 分别对应 Connection: close 与 keep-alive 两种预生成响应
+    struct Entry
+    {
+        std::string_view response[2];
+
+        std::string_view Response(bool isKeepAlive) const { return response[isKeepAlive ? 1 : 0]; }
+    };
+
+    // 不可变快照 持有shared_ptr期间其内存始终有效
+    class Snapshot
+    {
+    public:
+        ~Snapshot();
+
+        // 按请求路径查找 如 "/index.html"
+        const Entry *Find(std::string_view path) const;
+        // 按错误码查找错误页响应
+        const Entry *FindError(int code) const;
+
+        size_t FileCount() const { return files_.size(); }
+        size_t ArenaSize() const { return arenaSize_; }
+
+    private:
+        friend class FileCache;
+
+        char *arena_ = nullptr;
+        size_t arenaSize_ = 0;
+        std::unordered_map<std::string_view, Entry> files_;
+        std::unordered_map<int, Entry> errors_;
+    };
+
+    static FileCache *Instance();
+
+    // 资源目录 单个文件大小上限(0为只缓存错误页) 缓存总容量
+    void Init(const std::string &srcDir, size_t maxFileSize, size_t capacity);
+    void Close();
+    // 修改大小限制并重新扫描 进行中的请求继续使用旧快照
+    void SetLimits(size_t maxFileSize, size_t capacity);
+
+    // 获取当前快照 未初始化时返回空
+    std::shared_ptr<const Snapshot> Current() const;
+
+private:
+    FileCache();
+    ~FileCache();
+
+    // 重新扫描目录 生成新快照并替换
+    void Rebuild_();
+    void WatchThread_();
+    void AddWatches_(const std::string &dir);
+
+    std::string srcDir_;
+    size_t maxFileSize_;
+    size_t capacity_;
+
+    std::shared_ptr<const Snapshot> snapshot_; // 通过std::atomic_load/atomic_store访问
+
+    int inotifyFd_;
+    int wakeupFd_[2]; // 用于唤醒并结束监听线程
+    std::unordered_map<int, std::string> watches_;
+    std::unique_ptr<std::thread> watchThread_;
+    std::mutex mtx_;
+};
+
+#endif // FILE_CACHE_H
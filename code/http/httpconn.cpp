@@ -1,15 +1,27 @@
 #include "httpconn.h"
+#include "../config/config.h"
 using namespace std;
 
 const char *HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
+RateLimiter *HttpConn::limiter;
+std::atomic<bool> HttpConn::draining;
 bool HttpConn::isET;
+const char HttpConn::CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+const char HttpConn::CGI_TYPE[] = "application/json; charset=utf-8";
+const char HttpConn::LIMITED[] = "{\"status\": \"429\",\"msg\": \"too many requests\"}";
+const char HttpConn::TOO_LARGE[] = "{\"status\": \"431\",\"msg\": \"request header fields too large\"}";
 
-HttpConn::HttpConn()
+HttpConn::HttpConn() : readBuff_(0)
 {
     fd_ = -1;
     addr_ = {0};
+    clientKey_ = 0;
     isClose_ = true;
+    closing_ = false;
+    bodyStart_ = bodyBytes_ = 0;
+    active_ = false;
+    requestStart_ = parseNs_ = respondAt_ = 0;
 };
 
 HttpConn::~HttpConn()
@@ -22,20 +34,38 @@ void HttpConn::init(int fd, const sockaddr_in &addr)
     assert(fd > 0);
     userCount++;
     addr_ = addr;
+    clientKey_ = RateLimiter::Key((const sockaddr *)&addr);
     fd_ = fd;
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll();
+    request_.Init();
     isClose_ = false;
+    closing_ = false;
+    bodyStart_ = bodyBytes_ = 0;
+    active_ = false;
+    requestStart_ = parseNs_ = respondAt_ = 0;
+    Metrics::ConnOpened();
+    WEBSERVER_PROBE1(conn_init, fd_);
     LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
 }
 
 void HttpConn::Close()
 {
-    response_.UnmapFile();
+    // 释放未发送完的文件映射和缓存引用 结束未完成的流式响应
+    writeBuff_.RetrieveAll();
+    stream_.Abort();
     if (isClose_ == false)
     {
         isClose_ = true;
         userCount--;
+        if (respondAt_)
+        {
+            // 响应未写完 记录到关闭为止
+            FinishWrite_(Metrics::NowNs());
+        }
+        Metrics::ConnClosed(active_);
+        WEBSERVER_PROBE2(conn_close, fd_, active_);
+        active_ = false;
         close(fd_);
         LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
     }
@@ -71,77 +101,217 @@ ssize_t HttpConn::read(int *saveErrno)
         {
             break;
         }
+        Metrics::AddBytesIn(len);
+        if (bodyStart_)
+        {
+            bodyBytes_ += len;
+        }
     } while (isET);
     return len;
 }
 
-// 主要采用writev连续写函数
+uint64_t HttpConn::BodyDeadline() const
+{
+    const Config &config = Config::current();
+    return bodyStart_ + (uint64_t)config.bodyTimeoutMS * 1000000 + bodyBytes_ * 1000000000 / config.bodyMinRate;
+}
+
+// 链式缓冲区一次writev聚合写出所有段
 ssize_t HttpConn::write(int *saveErrno)
 {
     ssize_t len = -1;
     do
     {
-        len = writev(fd_, iov_, iovCnt_);
+        len = writeBuff_.WriteFd(fd_, saveErrno);
         if (len <= 0)
         {
-            *saveErrno = errno;
             break;
         }
-        if (iov_[0].iov_len + iov_[1].iov_len == 0)
+        Metrics::AddBytesOut(len);
+        if (writeBuff_.ReadableBytes() == 0)
         {
-            break;
-        } /* 传输结束 */
-        else if (static_cast<size_t>(len) > iov_[0].iov_len)
-        {
-            iov_[1].iov_base = (uint8_t *)iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if (iov_[0].iov_len)
+            // 已生成的响应全部写出 流式响应还有后续数据 连接仍在处理中
+            if (respondAt_ && !stream_.IsOpen())
             {
-                writeBuff_.RetrieveAll();
-                iov_[0].iov_len = 0;
+                uint64_t now = Metrics::NowNs();
+                Metrics::Observe(Metrics::STAGE_WRITE, now - respondAt_);
+                FinishWrite_(now);
+                SetActive_(false);
+                WEBSERVER_PROBE1(write_done, fd_);
             }
-        }
-        else
-        {
-            iov_[0].iov_base = (uint8_t *)iov_[0].iov_base + len;
-            iov_[0].iov_len -= len;
-            writeBuff_.Retrieve(len);
-        }
+            break;
+        } /* 传输结束 */
     } while (isET || ToWriteBytes() > 10240);
     return len;
 }
 
 bool HttpConn::process()
 {
-    request_.Init();
+    // 上一个请求已经响应 开始解析下一个请求
+    if (request_.IsFinish())
+    {
+        request_.Init();
+    }
     if (readBuff_.ReadableBytes() <= 0)
     {
         return false;
     }
-    else if (request_.parse(readBuff_)) // 解析成功
+
+    uint64_t parseStart = Metrics::NowNs();
+    if (requestStart_ == 0)
+    {
+        // 新请求的第一批数据
+        requestStart_ = parseStart;
+        SetActive_(true);
+        trace_ = FlightRecorder::Record();
+        trace_.start = parseStart;
+        WEBSERVER_PROBE1(request_begin, fd_);
+    }
+    HttpRequest::HTTP_CODE ret = request_.parse(readBuff_);
+    uint64_t parseEnd = Metrics::NowNs();
+    parseNs_ += parseEnd - parseStart;
+    if (ret != HttpRequest::NO_REQUEST)
+    {
+        Metrics::Observe(Metrics::STAGE_READ, parseEnd - requestStart_);
+        Metrics::Observe(Metrics::STAGE_PARSE, parseNs_);
+        trace_.spans[FlightRecorder::SPAN_READ][0] = requestStart_;
+        trace_.spans[FlightRecorder::SPAN_READ][1] = trace_.spans[FlightRecorder::SPAN_PARSE][0] = parseEnd - parseNs_;
+        trace_.spans[FlightRecorder::SPAN_PARSE][1] = parseEnd;
+        trace_.SetRequest(request_.method(), request_.path());
+        WEBSERVER_PROBE4(request_parsed, fd_, (int)ret, trace_.method, trace_.path);
+        requestStart_ = parseNs_ = 0;
+        bodyStart_ = 0;
+    }
+    else if (request_.IsReadingBody() && bodyStart_ == 0)
+    {
+        // 请求头刚收完 开始按最低速率计算请求体的时限
+        bodyStart_ = parseEnd;
+        bodyBytes_ = 0;
+    }
+
+    if (ret == HttpRequest::NO_REQUEST)
+    {
+        // 请求不完整 已解析的部分已从读缓冲区取走 请求体片段已交给请求体存储
+        if (request_.TakeExpectContinue())
+        {
+            writeBuff_.AppendStatic(CONTINUE, sizeof(CONTINUE) - 1);
+        }
+        readBuff_.Release();
+        return false;
+    }
+    else if (ret == HttpRequest::HEADER_TOO_LARGE)
+    {
+        // 剩余的请求头不再读取 返回431并关闭连接
+        response_.Init(srcDir, request_.path(), TOO_LARGE, false, 431);
+    }
+    else if (limiter && !limiter->Allow(clientKey_, parseEnd))
     {
-        LOG_DEBUG("%s", request_.path().c_str());
-        response_.Init(srcDir, request_.path(), request_.retjson(), request_.IsKeepAlive(), 200);
+        // 超过该客户端的请求速率 返回429并关闭连接 重新连接时受连接速率限制
+        Metrics::RateLimited(Metrics::LIMIT_REQUEST);
+        response_.Init(srcDir, request_.path(), LIMITED, false, 429);
+    }
+    else if (ret == HttpRequest::GET_REQUEST) // 解析成功
+    {
+        bool keepAlive = request_.IsKeepAlive() && !draining.load(memory_order_relaxed);
+        LOG_DEBUG("%.*s", (int)request_.path().size(), request_.path().data());
+        const Router::Match &route = request_.route();
+        if (route.route && route.route->localOnly && (ntohl(addr_.sin_addr.s_addr) >> 24) != IN_LOOPBACKNET)
+        {
+            // 只对本机开放的路由 不向其他客户端透露其存在
+            response_.Init(srcDir, request_.path(), "", keepAlive, 404);
+        }
+        else if (route.route && route.route->kind == Router::HANDLER)
+        {
+            // 进程内处理函数生成响应体
+            request_.retjson().clear();
+            route.route->handler(request_, route, request_.retjson());
+            trace_.spans[FlightRecorder::SPAN_HANDLE][0] = parseEnd;
+            trace_.spans[FlightRecorder::SPAN_HANDLE][1] = Metrics::NowNs();
+            response_.Init(srcDir, request_.path(), request_.retjson(), keepAlive, 200);
+            response_.SetBodyType(route.route->contentType);
+        }
+        else
+        {
+            response_.Init(srcDir, request_.path(), request_.retjson(), keepAlive, 200);
+        }
+        // 动态请求 先发送响应头 CGI的输出由pump()边读边发 HTTP/1.0不支持分块
+        bool chunked = request_.version() == "1.1";
+        if (!request_.cgi().empty() && stream_.Open(request_.cgi(), chunked))
+        {
+            trace_.spans[FlightRecorder::SPAN_HANDLE][0] = parseEnd;
+            trace_.spans[FlightRecorder::SPAN_HANDLE][1] = Metrics::NowNs();
+            readBuff_.Release();
+            response_.MakeStreamHeader(writeBuff_, CGI_TYPE, chunked);
+            Respond_(parseEnd);
+            return true;
+        }
     }
     else
     {
         response_.Init(srcDir, request_.path(), "",false, 400);
     }
 
-    // 生成响应报文放入writeBuff_中
+    // 请求数据已处理完 读缓冲区的存储归还内存池 空闲连接不占用接收内存
+    readBuff_.Release();
+
+    // 生成响应报文追加到writeBuff_中 文件和缓存内容只引用不拷贝
     response_.MakeResponse(writeBuff_);
-    /* 响应头 */
-    iov_[0].iov_base = const_cast<char *>(writeBuff_.Peek());
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
-    iovCnt_ = 1;
+    Respond_(parseEnd);
+    LOG_DEBUG("filesize:%d, %d segments to %d", response_.FileLen(), writeBuff_.SegmentCount(), ToWriteBytes());
+    return true;
+}
 
-    /* 文件 */
-    if (response_.FileLen() > 0 && response_.File())
+void HttpConn::Respond_(uint64_t buildStart)
+{
+    uint64_t now = Metrics::NowNs();
+    Metrics::Observe(Metrics::STAGE_BUILD, now - buildStart);
+    const Router::Match &route = request_.route();
+    Metrics::CountRequest(route.route ? route.route->id + 1 : 0, response_.Code());
+
+    uint64_t handleEnd = trace_.spans[FlightRecorder::SPAN_HANDLE][1];
+    trace_.spans[FlightRecorder::SPAN_BUILD][0] = handleEnd ? handleEnd : buildStart;
+    trace_.spans[FlightRecorder::SPAN_BUILD][1] = now;
+    trace_.code = response_.Code();
+    closing_ = closing_ || !response_.IsKeepAlive();
+    WEBSERVER_PROBE3(response_ready, fd_, trace_.code, writeBuff_.ReadableBytes());
+    if (respondAt_ == 0)
     {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ = 2;
+        respondAt_ = now;
+        writeTrace_ = trace_;
     }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen(), iovCnt_, ToWriteBytes());
-    return true;
-}
\ No newline at end of file
+    else
+    {
+        FlightRecorder::Commit(trace_);
+    }
+}
+
+void HttpConn::FinishWrite_(uint64_t now)
+{
+    writeTrace_.spans[FlightRecorder::SPAN_WRITE][0] = respondAt_;
+    writeTrace_.spans[FlightRecorder::SPAN_WRITE][1] = now;
+    FlightRecorder::Commit(writeTrace_);
+    respondAt_ = 0;
+}
+
+void HttpConn::SetActive_(bool active)
+{
+    if (active_ != active)
+    {
+        active_ = active;
+        Metrics::ConnActive(active);
+    }
+}
+
+bool HttpConn::pump()
+{
+    if (!stream_.IsOpen())
+    {
+        return false;
+    }
+    // 背压 待发送的数据超过高水位时不再读取生产者 等socket发送后再继续
+    if (writeBuff_.ReadableBytes() < STREAM_HIGH_WATER)
+    {
+        stream_.Pump(writeBuff_);
+    }
+    return stream_.IsOpen();
+}
@@ -9,8 +9,15 @@
 
 #include "../log/log.h"
 #include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
+#include "../buffer/ringbuffer.h"
 #include "httprequest.h"
 #include "httpresponse.h"
+#include "responsestream.h"
+#include "../metrics/metrics.h"
+#include "../metrics/flightrecorder.h"
+#include "../metrics/probes.h"
+#include "../server/ratelimiter.h"
 
 // Http连接 调用HttpRequest来解析数据 并调用HttpResponse来生成响应
 class HttpConn
@@ -36,36 +43,101 @@ public:
 
     sockaddr_in GetAddr() const;
 
+    // 解析读缓冲区中的一个请求 生成响应时返回true 请求不完整或没有数据时返回false
     bool process();
 
-    int ToWriteBytes()
+    // 流式响应 写缓冲区低于高水位时从生产者读取一块数据 返回false表示流已结束
+    bool pump();
+
+    bool IsStreaming() const
+    {
+        return stream_.IsOpen();
+    }
+
+    int ToWriteBytes() const
+    {
+        return writeBuff_.ReadableBytes();
+    }
+
+    // 请求头已完整 正在接收请求体
+    bool IsReadingBody() const
+    {
+        return request_.IsReadingBody();
+    }
+
+    // 未完成的请求收到第一批数据的时间 0表示没有未完成的请求
+    uint64_t RequestStart() const
     {
-        return iov_[0].iov_len + iov_[1].iov_len;
+        return requestStart_;
     }
 
     bool IsKeepAlive() const
     {
-        return request_.IsKeepAlive();
+        return response_.IsKeepAlive() && !stream_.IsBroken();
     }
 
+    // 已生成不保持连接的响应(或流式响应中断) 写完后关闭 之后的流水线请求不再处理
+    bool IsClosing() const
+    {
+        return closing_ || stream_.IsBroken();
+    }
+
+    // 接收请求体的截止时间(单调时钟纳秒) 初始时限之后每收到bodyMinRate字节延长1秒
+    uint64_t BodyDeadline() const;
+
     static bool isET;
     static const char *srcDir;
     static std::atomic<int> userCount;
+    static RateLimiter *limiter; // 按客户端地址限制请求速率 为空不限制
+    static std::atomic<bool> draining; // 正在关闭服务器 之后的响应都带Connection: close
 
 private:
+#ifdef HTTPCONN_RING_BUFFER
+    typedef RingBuffer ReadBuffer; // 镜像环形缓冲区 读写始终连续 不需要前移数据
+#else
+    typedef Buffer ReadBuffer;
+#endif
+
+    static const char CONTINUE[]; // 客户端发送请求体前等待的中间响应
+    static const char CGI_TYPE[];
+    static const char LIMITED[];   // 超过请求速率时的响应体
+    static const char TOO_LARGE[]; // 请求头超过上限时的响应体
+    static const size_t STREAM_HIGH_WATER = 64 * 1024; // 流式响应待发送数据的上限
+
+    // 生成响应 记录请求计数与阶段耗时
+    void Respond_(uint64_t buildStart);
+    void SetActive_(bool active);
+    // 响应全部写出或连接关闭 结束最早未写完的请求的追踪记录
+    void FinishWrite_(uint64_t now);
+
     int fd_;
     struct sockaddr_in addr_;
+    uint64_t clientKey_; // 限速的键
 
     bool isClose_;
 
-    int iovCnt_;
-    struct iovec iov_[2];
-
-    Buffer readBuff_;  // 读缓冲区
-    Buffer writeBuff_; // 写缓冲区
+    ReadBuffer readBuff_;   // 读缓冲区 有数据时才从内存池借用存储
+    ChainBuffer writeBuff_; // 写缓冲区 链式 可容纳多个响应
 
     HttpRequest request_;
     HttpResponse response_;
+    ResponseStream stream_;
+
+    bool closing_;
+
+    // 请求体的接收进度 开始接收的时间与之后读到的字节数 连接交回reactor期间保留
+    uint64_t bodyStart_;
+    uint64_t bodyBytes_;
+
+    // 指标 连接是否在处理请求 当前请求收到第一批数据的时间 累计解析耗时 最早未写完响应的生成时间
+    bool active_;
+    uint64_t requestStart_;
+    uint64_t parseNs_;
+    uint64_t respondAt_;
+
+    // 追踪 正在处理的请求 与等待写出的请求(流水线时为最早的一个 其后的请求不记录写出阶段)
+    FlightRecorder::Record trace_;
+    FlightRecorder::Record writeTrace_;
 };
 
 #endif //HTTP_CONN_H
\ No newline at end of file
@@ -1,187 +1,437 @@
 #include "httprequest.h"
+#include "../buffer/ringbuffer.h"
+#include "../config/config.h"
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 using namespace std;
 
-const unordered_map<string, string> HttpRequest::DEFAULT_POST_TAG{
-    {"/api/register", "1"},
-    {"/api/login", "2"},
-};
+namespace
+{
+bool EqualNoCase(string_view a, string_view b)
+{
+    return a.size() == b.size() && strncasecmp(a.data(), b.data(), a.size()) == 0;
+}
 
-const unordered_set<string> HttpRequest::DEFAULT_HTML{
-    "/index",
-    "/register",
-    "/login",
-    "/welcome",
-    "/video",
-    "/picture",
-};
+string_view Trim(string_view s)
+{
+    size_t start = s.find_first_not_of(" \t");
+    if (start == string_view::npos)
+    {
+        return string_view();
+    }
+    return s.substr(start, s.find_last_not_of(" \t") - start + 1);
+}
+
+// RFC 9110 token 请求头名称只能由这些字符组成
+bool IsToken(string_view s)
+{
+    for (unsigned char ch : s)
+    {
+        if (!isalnum(ch) && strchr("!#$%&'*+-.^_`|~", ch) == nullptr)
+        {
+            return false;
+        }
+    }
+    return !s.empty();
+}
+} // namespace
 
 const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG{
     {"/register.html", 0},
     {"/login.html", 1},
 };
 
+
+HttpRequest::HttpRequest() : header_(&arena_), post_(&arena_), queryArgs_(&arena_), uploadFd_(-1)
+{
+    using namespace std::placeholders;
+    multipart_.SetHandler(std::bind(&HttpRequest::OnPartBegin_, this, _1),
+                          std::bind(&HttpRequest::OnPartData_, this, _1, _2, _3),
+                          std::bind(&HttpRequest::OnPartEnd_, this, _1));
+    Init();
+}
+
+HttpRequest::~HttpRequest()
+{
+    CloseUpload_(true);
+}
+
 void HttpRequest::Init()
 {
-    method_ = path_ = version_ = body_ = "";
+    method_ = path_ = query_ = version_ = string_view();
+    route_.route = nullptr;
+    route_.paramCount = 0;
+    retjson_.clear();
+    cgi_.clear();
     state_ = REQUEST_LINE;
-    header_.clear();
-    post_.clear();
+    headerBytes_ = 0;
+    // 容器的存储在arena上 先丢弃容器再重置arena
+    Arena::ResetContainer(header_);
+    Arena::ResetContainer(post_);
+    Arena::ResetContainer(queryArgs_);
+    arena_.Reset();
+    header_.reserve(16);
+    decoder_.InitLength(0);
+    body_.Clear();
+    expectContinue_ = false;
+    isMultipart_ = false;
+    partValue_.clear();
+    // 未完成的上传文件删除
+    CloseUpload_(true);
 }
 
 bool HttpRequest::IsKeepAlive() const
 {
-    if (header_.count("Connection") == 1)
-    {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
-    }
-    return false;
+    const string_view *conn = FindHeader_("Connection");
+    return conn && EqualNoCase(*conn, "keep-alive") && version_ == "1.1";
+}
+
+bool HttpRequest::TakeExpectContinue()
+{
+    bool expect = expectContinue_;
+    expectContinue_ = false;
+    return expect;
 }
 
 // 解析处理
-bool HttpRequest::parse(Buffer &buff)
+template <class Buff>
+HttpRequest::HTTP_CODE HttpRequest::parse(Buff &buff)
 {
     const char CRLF[] = "\r\n"; // 行结束符标志
-    if (buff.ReadableBytes() <= 0)
-    { // 没有可读的字节
-        return false;
-    }
-    // 复用连接要清除上次的json数据
-    retjson_ = "";
-    // 读取数据
-    while (buff.ReadableBytes() && state_ != FINISH)
+    // 有限状态机 每个状态只消耗完整的数据 不完整的行留在缓冲区中
+    while (state_ != FINISH)
     {
+        if (state_ == BODY)
+        {
+            size_t used = decoder_.Decode(buff.Peek(), buff.ReadableBytes(), [this](const char *data, size_t len)
+                                          { return isMultipart_ ? multipart_.Feed(data, len) : body_.Append(data, len); });
+            buff.Retrieve(used);
+            if (decoder_.IsError())
+            {
+                LOG_ERROR("Body Error, decoded:%d", (int)decoder_.Decoded());
+                return BAD_REQUEST;
+            }
+            if (!decoder_.IsDone())
+            {
+                return NO_REQUEST;
+            }
+            if (isMultipart_ && !multipart_.IsDone())
+            {
+                LOG_ERROR("Multipart body incomplete");
+                return BAD_REQUEST;
+            }
+            state_ = FINISH;
+            LOG_DEBUG("Body len:%d, in file:%d", (int)decoder_.Decoded(), body_.InFile());
+            ParsePost_();
+            break;
+        }
+
         const char *lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
-        std::string line(buff.Peek(), lineEnd);
+        if (lineEnd == buff.BeginWriteConst())
+        {
+            // 行不完整 等待更多数据 已超过上限时不再等待
+            return headerBytes_ + buff.ReadableBytes() > (size_t)Config::current().maxHeaderSize ? HEADER_TOO_LARGE
+                                                                                                  : NO_REQUEST;
+        }
+        headerBytes_ += lineEnd + 2 - buff.Peek();
+        if (headerBytes_ > (size_t)Config::current().maxHeaderSize)
+        {
+            return HEADER_TOO_LARGE;
+        }
+        // 读缓冲区的存储可能被归还 请求行与请求头拷贝到请求级分配器中
+        string_view line = arena_.Copy(string_view(buff.Peek(), lineEnd - buff.Peek()));
+        buff.RetrieveUntil(lineEnd + 2); // 跳过回车换行
 
-        // 有限状态机
         switch (state_)
         {
         case REQUEST_LINE:
+            // 忽略请求行之前的空行
+            if (line.empty())
+            {
+                break;
+            }
             if (!ParseRequestLine_(line))
             {
-                return false;
+                return BAD_REQUEST;
             }
             ParsePath_();
             break;
         case HEADERS:
-            ParseHeader_(line);
-            if (buff.ReadableBytes() <= 2)
+            if (line.empty() ? !BeginBody_() : !ParseHeader_(line))
             {
-                state_ = FINISH;
+                return BAD_REQUEST;
             }
             break;
-        case BODY:
-            ParseBody_(line);
-            break;
         default:
             break;
         }
-        if (lineEnd == buff.BeginWrite())
-        {
-            break;
-        }
-        buff.RetrieveUntil(lineEnd + 2); // 跳过回车换行
     }
-    /**
-     * 因为HttpBody没有回车换行符，所以上述方法无法正确移动读指针。
-     * 正确的操作应该是读取Content-Length数据来判断HttpBody的数据长度。
-     * 这里直接解析Http完成之后清空缓冲区，但是可能有粘包的问题。
-     * 但是有时候能正常，可能是因为作为新的连接新建了缓冲区。
-     */
-    buff.RetrieveAll();
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
-    return true;
+    LOG_DEBUG("[%.*s], [%.*s], [%.*s]", (int)method_.size(), method_.data(), (int)path_.size(), path_.data(),
+              (int)version_.size(), version_.data());
+    return GET_REQUEST;
 }
 
-// 解析路径
+template HttpRequest::HTTP_CODE HttpRequest::parse<Buffer>(Buffer &buff);
+template HttpRequest::HTTP_CODE HttpRequest::parse<RingBuffer>(RingBuffer &buff);
+
+// 匹配路由 没有注册的路径按静态文件处理
 void HttpRequest::ParsePath_()
 {
-    if (path_ == "/")
+    if (!Router::Instance()->Find(method_, path_, route_))
     {
-        path_ = "/index.html";
+        return;
     }
-    else
+    const Router::Route &route = *route_.route;
+    if (route.kind == Router::ALIAS)
+    {
+        path_ = route.target;
+    }
+    else if (route.kind == Router::STATIC && !route.target.empty())
+    {
+        // 目标前缀 + 通配段匹配的剩余路径
+        char *path = static_cast<char *>(arena_.Allocate(route.target.size() + route_.rest.size(), 1));
+        memcpy(path, route.target.data(), route.target.size());
+        memcpy(path + route.target.size(), route_.rest.data(), route_.rest.size());
+        path_ = string_view(path, route.target.size() + route_.rest.size());
+    }
+}
+
+// 解析请求行 METHOD SP PATH SP HTTP/VERSION
+bool HttpRequest::ParseRequestLine_(string_view line)
+{
+    size_t sp1 = line.find(' ');
+    size_t sp2 = sp1 == string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+    if (sp1 == 0 || sp2 == string_view::npos || sp2 == sp1 + 1 ||
+        line.compare(sp2 + 1, 5, "HTTP/") != 0 || line.find(' ', sp2 + 1) != string_view::npos)
+    {
+        LOG_ERROR("RequestLine Error");
+        return false;
+    }
+    method_ = line.substr(0, sp1);
+    path_ = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    version_ = line.substr(sp2 + 6);
+    state_ = HEADERS; // 状态转换为下一个状态
+
+    // 查询字符串与路径分开 拷贝一份原地解码
+    size_t pos = path_.find('?');
+    if (pos != string_view::npos)
+    {
+        query_ = path_.substr(pos + 1);
+        path_ = path_.substr(0, pos);
+        UrlEncoded::Parse(arena_.CopyMutable(query_), query_.size(), queryArgs_);
+    }
+    return true;
+}
+
+// 解析请求头 KEY: VALUE
+bool HttpRequest::ParseHeader_(string_view line)
+{
+    size_t colon = line.find(':');
+    // 名称与冒号之间有空白或名称含非token字符时拒绝(RFC 9112 5.1) 前端可能按另一种方式理解这个请求头
+    if (colon == string_view::npos || !IsToken(line.substr(0, colon)))
+    {
+        LOG_ERROR("Header Error");
+        return false;
+    }
+    header_.emplace_back(line.substr(0, colon), Trim(line.substr(colon + 1)));
+    return true;
+}
+
+const string_view *HttpRequest::FindHeader_(string_view key) const
+{
+    for (const auto &item : header_)
     {
-        for (auto &item : DEFAULT_HTML)
+        if (EqualNoCase(item.first, key))
         {
-            if (item == path_)
-            {
-                path_ += ".html";
-                break;
-            }
+            return &item.second;
         }
     }
+    return nullptr;
 }
 
-// 解析请求行
-bool HttpRequest::ParseRequestLine_(const string &line)
+// 请求头结束 确定请求体的长度与编码
+bool HttpRequest::BeginBody_()
 {
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch subMatch;
-    if (regex_match(line, subMatch, patten))
+    // 检查所有同名的请求头 前端与本服务器取了不同的一个时 对请求体的划分不同 造成请求走私
+    // 重复的Transfer-Encoding与不一致的Content-Length都拒绝
+    const string_view *encoding = nullptr;
+    const string_view *length = nullptr;
+    for (const auto &item : header_)
+    {
+        if (EqualNoCase(item.first, "Transfer-Encoding"))
+        {
+            if (encoding)
+            {
+                LOG_ERROR("Repeated Transfer-Encoding");
+                return false;
+            }
+            encoding = &item.second;
+        }
+        else if (EqualNoCase(item.first, "Content-Length"))
+        {
+            if (length && *length != item.second)
+            {
+                LOG_ERROR("Conflicting Content-Length:%.*s, %.*s", (int)length->size(), length->data(),
+                          (int)item.second.size(), item.second.data());
+                return false;
+            }
+            length = &item.second;
+        }
+    }
+    if (encoding)
+    {
+        // 只支持chunked 与Content-Length同时出现时拒绝
+        if (length || !EqualNoCase(*encoding, "chunked"))
+        {
+            LOG_ERROR("Unsupported Transfer-Encoding:%.*s", (int)encoding->size(), encoding->data());
+            return false;
+        }
+        decoder_.InitChunked();
+    }
+    else if (length)
     {
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        state_ = HEADERS; // 状态转换为下一个状态
+        if (length->empty() || length->size() > 18 ||
+            length->find_first_not_of("0123456789") != string_view::npos)
+        {
+            LOG_ERROR("Invalid Content-Length:%.*s", (int)length->size(), length->data());
+            return false;
+        }
+        size_t len = 0;
+        for (char ch : *length)
+        {
+            len = len * 10 + (ch - '0');
+        }
+        decoder_.InitLength(len);
+    }
+    else
+    {
+        decoder_.InitLength(0);
+    }
+    state_ = BODY;
 
-        // size_t pos = path_.find('?');
-        // if (pos != std::string::npos)
-        // {
-        //     path_ = path_.substr(0, pos);   // 路径部分
-        //     query_ = path_.substr(pos + 1); // 查询字符串（去掉 ?）
-        // }
-        // else
-        // {
-        //     path_ = path_;
-        //     query_ = ""; // 没有查询字符串
-        // }
+    // multipart/form-data 边接收边解析 不保存完整的请求体
+    const string_view *type = FindHeader_("Content-Type");
+    string_view boundary = type ? MultipartParser::Boundary(*type) : string_view();
+    if (method_ == "POST" && !boundary.empty())
+    {
+        if (!multipart_.Init(boundary))
+        {
+            LOG_ERROR("Invalid multipart boundary");
+            return false;
+        }
+        isMultipart_ = true;
+    }
+
+    const string_view *expect = FindHeader_("Expect");
+    expectContinue_ = !decoder_.IsDone() && version_ == "1.1" && expect && EqualNoCase(*expect, "100-continue");
+    return true;
+}
 
+bool HttpRequest::OnPartBegin_(const MultipartParser::Part &part)
+{
+    partValue_.clear();
+    // 上传目录为空时丢弃上传的文件内容 拷贝一份 处理期间配置可能重新加载
+    string uploadDir = Config::current().upload_dir;
+    if (part.filename.empty() || uploadDir.empty())
+    {
+        return true;
+    }
+    // 只取文件名部分 防止写到上传目录之外
+    string name = part.filename.substr(part.filename.find_last_of("/\\") + 1);
+    if (name.empty() || name == "." || name == "..")
+    {
+        LOG_WARN("Upload filename invalid:%s", part.filename.c_str());
         return true;
     }
-    LOG_ERROR("RequestLine Error");
-    return false;
+    // 同名文件存在时追加序号 不覆盖已有文件
+    for (int i = 0; i < 100 && uploadFd_ < 0; i++)
+    {
+        uploadPath_ = uploadDir + "/" + name + (i ? "." + to_string(i) : "");
+        uploadFd_ = open(uploadPath_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (uploadFd_ < 0 && errno != EEXIST)
+        {
+            break;
+        }
+    }
+    if (uploadFd_ < 0)
+    {
+        LOG_ERROR("Create upload file %s error:%d", uploadPath_.c_str(), errno);
+        return false;
+    }
+    return true;
 }
 
-// 解析请求头
-void HttpRequest::ParseHeader_(const string &line)
+bool HttpRequest::OnPartData_(const MultipartParser::Part &part, const char *data, size_t len)
 {
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
-    if (regex_match(line, subMatch, patten))
+    if (part.filename.empty())
     {
-        header_[subMatch[1]] = subMatch[2];
+        if (partValue_.size() + len > MAX_FIELD_SIZE)
+        {
+            LOG_ERROR("Multipart field %s too large", part.name.c_str());
+            return false;
+        }
+        partValue_.append(data, len);
+        return true;
     }
-    else
+    while (uploadFd_ >= 0 && len > 0)
     {
-        state_ = BODY; // 状态转换为下一个状态
+        ssize_t n = write(uploadFd_, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOG_ERROR("Write upload file %s error:%d", uploadPath_.c_str(), errno);
+            return false;
+        }
+        data += n;
+        len -= n;
     }
+    return true;
 }
 
-// 解析请求体
-void HttpRequest::ParseBody_(const string &line)
+bool HttpRequest::OnPartEnd_(const MultipartParser::Part &part)
 {
-    body_ = line;
-    ParsePost_();
-    state_ = FINISH;
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
+    if (part.filename.empty())
+    {
+        post_.emplace_back(arena_.Copy(part.name), arena_.Copy(partValue_));
+        LOG_DEBUG("%s = %s", part.name.c_str(), partValue_.c_str());
+        partValue_.clear();
+    }
+    else if (uploadFd_ >= 0)
+    {
+        // 文件字段的值为保存的路径
+        post_.emplace_back(arena_.Copy(part.name), arena_.Copy(uploadPath_));
+        LOG_INFO("Upload %s saved to %s", part.filename.c_str(), uploadPath_.c_str());
+        CloseUpload_(false);
+    }
+    return true;
 }
 
-// 16进制转换为10进制
-int HttpRequest::ConverHex(char ch)
+void HttpRequest::CloseUpload_(bool remove)
 {
-    if (ch >= 'A' && ch <= 'F')
-        return ch - 'A' + 10;
-    if (ch >= 'a' && ch <= 'f')
-        return ch - 'a' + 10;
-    return ch;
+    if (uploadFd_ < 0)
+    {
+        return;
+    }
+    close(uploadFd_);
+    uploadFd_ = -1;
+    if (remove)
+    {
+        unlink(uploadPath_.c_str());
+    }
 }
 
 // 处理Post请求
 void HttpRequest::ParsePost_()
 {
-    if (method_ == "POST" &&
-        (header_["Content-Type"] == "application/x-www-form-urlencoded" || header_["Content-Type"] == "application/x-www-form-urlencoded; charset=UTF-8"))
+    const string_view *type = FindHeader_("Content-Type");
+    if (method_ == "POST" && type &&
+        (*type == "application/x-www-form-urlencoded" || *type == "application/x-www-form-urlencoded; charset=UTF-8"))
     {
         ParseFromUrlencoded_();
 
@@ -210,130 +460,37 @@ void HttpRequest::ParsePost_()
     }
 }
 
+// 准备CGI命令 由HttpConn启动子进程并以流式响应发送其输出
 void HttpRequest::ProcessCGI_()
 {
-    int pipefd[2];
-    if (pipe(pipefd) == -1)
-    {
-        LOG_ERROR("pipe() error:%d", 4);
-    }
-
-    // 创建子进程
-    pid_t pid = fork();
-
-    /**
-     * 创建子进程后，父进程继续执行，子进程会从下面的语句开始执行。两个程序都从fork的下一行开始执行
-     * 如果pid为0，标识子进程，通常用execl函数执行一个新的程序替换到子进程
-     * 新的程序如果成功执行就不会执行子进程接下来的语句了，如果执行失败，继续执行下面的语句，然后通常子进程通过exit退出自身
-     */
-
-    if (pid == 0) // 子进程
+    if (!route_.route || route_.route->kind != Router::CGI)
     {
-
-        close(pipefd[0]); // 关闭读端
-        // 将标准输出重定向到管道写端
-        dup2(pipefd[1], STDOUT_FILENO);
-        close(pipefd[1]); // dup2 后可以关闭原 fd
-
-        /**
-         * 子进程通过管道和父进程通信，定义了一个管道，
-         * 父子进程各有一个副本，子进程关闭读管道并将标准输出重定向到管道写端，父进程关闭写管道并通过read监听
-         * 子进程如果一直持有管道写端的引用，并且不显式关闭，父进程将一直阻塞在read方法，但可以使用超时机制
-         */
-
-        string authtype = DEFAULT_POST_TAG.find(path_)->second;
-
-        execl("./resources_cgi/auth.cgi", "auth", post_["username"].c_str(), post_["password"].c_str(), authtype.c_str(), NULL);
-
-        std::cout << R"({"status": "409","msg": "cgi run error"})" << std::endl;
-        
-        // exit(1); // 如果execl失败
-        _exit(1); // execl会执行进程的清理工作 _exit直接系统调用关闭进程
-    }
-    else if (pid > 0) // 父进程
-    {
-        close(pipefd[1]); // 关闭写端
-
-        char buffer[1024];
-        std::string output;
-        ssize_t bytesRead;
-
-        // 从管道读取子进程的 stdout
-        while ((bytesRead = read(pipefd[0], buffer, sizeof(buffer) - 1)) > 0)
-        {
-            buffer[bytesRead] = '\0'; // 添加字符串结束符
-            output += buffer;
-        }
-
-        close(pipefd[0]); // 关闭读端
-
-        // 等待子进程结束
-        int status;
-        waitpid(pid, &status, 0);
-
-        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
-        {
-            LOG_DEBUG("CGI programe execute success:%s", output);
-        }
-        else
-        {
-            LOG_ERROR("CGI programe execute error:%d", WEXITSTATUS(status));
-        }
-
-        retjson_ = output;
+        return;
     }
-    else
+    const Router::Route &route = *route_.route;
+    cgi_.clear();
+    cgi_.push_back(route.target);
+    for (const string &arg : route.args)
     {
-        LOG_ERROR("fork() error:%d", 3);
+        // "$name"替换为同名的表单字段
+        cgi_.emplace_back(arg.size() > 1 && arg[0] == '$' ? string(GetPost(string_view(arg).substr(1))) : arg);
     }
 }
 
 // 从Url中解析编码
 void HttpRequest::ParseFromUrlencoded_()
 {
-    if (body_.size() == 0)
+    // 表单只在内存中解析 转存到文件的请求体不解析
+    if (body_.InFile())
     {
+        LOG_WARN("Urlencoded body too large:%d", (int)body_.Size());
         return;
     }
-
-    string key, value;
-    int num = 0;
-    int n = body_.size();
-    int i = 0, j = 0;
-
-    for (; i < n; i++)
+    string &body = body_.Data();
+    UrlEncoded::Parse(&body[0], body.size(), post_);
+    for (const UrlEncoded::Field &field : post_)
     {
-        char ch = body_[i];
-        switch (ch)
-        {
-        case '=':
-            key = body_.substr(j, i - j);
-            j = i + 1;
-            break;
-        case '+':
-            body_[i] = ' ';
-            break;
-        case '%':
-            num = ConverHex(body_[i + 1]) * 16 + ConverHex(body_[i + 2]);
-            body_[i + 2] = num % 10 + '0';
-            body_[i + 1] = num / 10 + '0';
-            i += 2;
-            break;
-        case '&':
-            value = body_.substr(j, i - j);
-            j = i + 1;
-            post_[key] = value;
-            LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
-            break;
-        default:
-            break;
-        }
-    }
-    assert(j <= i);
-    if (post_.count(key) == 0 && j < i)
-    {
-        value = body_.substr(j, i - j);
-        post_[key] = value;
+        LOG_DEBUG("%.*s = %.*s", (int)field.first.size(), field.first.data(), (int)field.second.size(), field.second.data());
     }
 }
 
@@ -398,46 +555,41 @@ void HttpRequest::ParseFromUrlencoded_()
 //     return flag;
 // }
 
-std::string &HttpRequest::retjson()
+const std::vector<std::string> &HttpRequest::cgi() const
 {
-    return retjson_;
+    return cgi_;
 }
 
-std::string HttpRequest::path() const
+std::string &HttpRequest::retjson()
 {
-    return path_;
+    return retjson_;
 }
 
-std::string &HttpRequest::path()
+std::string_view HttpRequest::path() const
 {
     return path_;
 }
-std::string HttpRequest::method() const
+
+std::string_view HttpRequest::method() const
 {
     return method_;
 }
 
-std::string HttpRequest::version() const
+std::string_view HttpRequest::version() const
 {
     return version_;
 }
 
-std::string HttpRequest::GetPost(const std::string &key) const
+std::string_view HttpRequest::GetPost(std::string_view key) const
 {
-    assert(key != "");
-    if (post_.count(key) == 1)
-    {
-        return post_.find(key)->second;
-    }
-    return "";
+    string_view value;
+    UrlEncoded::Find(post_, key, value);
+    return value;
 }
 
-std::string HttpRequest::GetPost(const char *key) const
+std::string_view HttpRequest::GetQuery(std::string_view key) const
 {
-    assert(key != nullptr);
-    if (post_.count(key) == 1)
-    {
-        return post_.find(key)->second;
-    }
-    return "";
+    string_view value;
+    UrlEncoded::Find(queryArgs_, key, value);
+    return value;
 }
\ No newline at end of file
@@ -2,15 +2,20 @@
 #define HTTP_REQUEST_H
 
 #include <unordered_map>
-#include <unordered_set>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <memory_resource>
+#include <vector>
 #include <errno.h>
 
-#include <sys/wait.h>
-
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "bodydecoder.h"
+#include "requestbody.h"
+#include "multipartparser.h"
+#include "urlencoded.h"
+#include "router.h"
+#include "../buffer/arena.h"
 
 class HttpRequest
 {
@@ -33,55 +38,94 @@ public:
         FILE_REQUEST,
         INTERNAL_ERROR,
         CLOSED_CONNECTION,
+        HEADER_TOO_LARGE, // 请求行与请求头超过maxHeaderSize
     };
 
-    HttpRequest() { Init(); }
-    ~HttpRequest() = default;
+    HttpRequest();
+    ~HttpRequest();
 
     void Init();
-    bool parse(Buffer &buff);
-
-    std::string path() const;
-    std::string &path();
-    std::string method() const;
-    std::string version() const;
-    std::string GetPost(const std::string &key) const;
-    std::string GetPost(const char *key) const;
+    // 增量解析 只取走已解析的字节 支持Buffer与RingBuffer两种读缓冲区
+    // 返回NO_REQUEST表示请求不完整 需要继续读取; GET_REQUEST表示请求完整; BAD_REQUEST表示请求有误
+    template <class Buff>
+    HTTP_CODE parse(Buff &buff);
+    bool IsFinish() const { return state_ == FINISH; }
+    // 请求头已完整 正在接收请求体
+    bool IsReadingBody() const { return state_ == BODY; }
+
+    // 请求行中的字段 视图指向请求级分配器 在下一个请求开始前有效
+    std::string_view path() const;
+    std::string_view method() const;
+    std::string_view version() const;
+    // 表单字段与查询参数 返回的视图在下一个请求开始前有效 找不到返回空
+    std::string_view GetPost(std::string_view key) const;
+    std::string_view GetQuery(std::string_view key) const;
+
+    // 匹配到的路由 route为空表示按请求路径访问静态文件
+    const Router::Match &route() const { return route_; }
 
     std::string &retjson();
+    // 需要执行的CGI命令 第一个元素为程序路径 其余为argv 为空表示静态请求
+    const std::vector<std::string> &cgi() const;
 
     bool IsKeepAlive() const;
+    // 客户端等待100 Continue后才发送请求体 每个请求只返回一次true
+    bool TakeExpectContinue();
+
+    const RequestBody &body() const { return body_; }
 
     /*
     todo
-    void HttpConn::ParseFormData() {}
     void HttpConn::ParseJson() {}
     */
 
 private:
-    bool ParseRequestLine_(const std::string &line); // 处理请求行
-    void ParseHeader_(const std::string &line); // 处理请求头
-    void ParseBody_(const std::string &line); // 处理请求体
-
-    void ParsePath_(); // 处理请求路径
+    bool ParseRequestLine_(std::string_view line); // 处理请求行
+    bool ParseHeader_(std::string_view line); // 处理请求头
+    bool BeginBody_(); // 请求头结束 根据Content-Length或Transfer-Encoding准备读取请求体
+    const std::string_view *FindHeader_(std::string_view key) const; // 忽略大小写查找请求头
+
+    // multipart/form-data 普通字段存入post_ 文件直接写入uploadDir
+    bool OnPartBegin_(const MultipartParser::Part &part);
+    bool OnPartData_(const MultipartParser::Part &part, const char *data, size_t len);
+    bool OnPartEnd_(const MultipartParser::Part &part);
+    void CloseUpload_(bool remove);
+
+    void ParsePath_(); // 匹配路由 确定请求的资源
     void ParsePost_(); // 处理Post事件
     void ParseFromUrlencoded_(); // 从url中解析编码
 
-    void ProcessCGI_(); // 执行CGI程序
+    void ProcessCGI_(); // 准备CGI命令
 
     // static bool UserVerify(const std::string &name, const std::string &pwd, bool isLogin);
 
     std::string retjson_;
+    std::vector<std::string> cgi_;
+
+    // 请求级分配器 请求行、请求头、查询参数与表单字段都分配在其上 Init时O(1)重置
+    Arena arena_;
 
     PARSE_STATE state_;
-    std::string method_, path_, query_,version_, body_;
-    std::unordered_map<std::string, std::string> header_;
-    std::unordered_map<std::string, std::string> post_;
+    size_t headerBytes_; // 已解析的请求行与请求头的长度
+    std::string_view method_, path_, query_, version_;
+    Router::Match route_;
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> header_;
+    UrlEncoded::FieldList post_;
+    UrlEncoded::FieldList queryArgs_;
+
+    BodyDecoder decoder_;
+    RequestBody body_;
+    bool expectContinue_;
+
+    bool isMultipart_;
+    MultipartParser multipart_;
+    std::string partValue_; // 正在解析的普通字段的值
+    int uploadFd_;          // 正在写入的上传文件
+    std::string uploadPath_;
+
+    static const size_t MAX_FIELD_SIZE = 64 * 1024; // multipart普通字段的长度上限
 
-    static const std::unordered_set<std::string> DEFAULT_HTML;
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
-    static const std::unordered_map<std::string, std::string> DEFAULT_POST_TAG;
-    static int ConverHex(char ch); // 16进制转换为10进制
 };
 
 #endif //HTTP_REQUEST_H
\ No newline at end of file
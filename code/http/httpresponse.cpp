@@ -1,36 +1,20 @@
 #include "httpresponse.h"
+#include <stdio.h>
 
 using namespace std;
 
-const unordered_map<string, string> HttpResponse::SUFFIX_TYPE = {
-    {".html", "text/html"},
-    {".xml", "text/xml"},
-    {".xhtml", "application/xhtml+xml"},
-    {".txt", "text/plain"},
-    {".rtf", "application/rtf"},
-    {".pdf", "application/pdf"},
-    {".word", "application/nsword"},
-    {".png", "image/png"},
-    {".gif", "image/gif"},
-    {".jpg", "image/jpeg"},
-    {".jpeg", "image/jpeg"},
-    {".au", "audio/basic"},
-    {".mpeg", "video/mpeg"},
-    {".mpg", "video/mpeg"},
-    {".avi", "video/x-msvideo"},
-    {".gz", "application/x-gzip"},
-    {".tar", "application/x-tar"},
-    {".css", "text/css "},
-    {".js", "text/javascript "},
-};
-
 const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     {200, "OK"},
     {400, "Bad Request"},
     {403, "Forbidden"},
     {404, "Not Found"},
+    {408, "Request Timeout"},
+    {429, "Too Many Requests"},
+    {431, "Request Header Fields Too Large"},
 };
 
+const char HttpResponse::JSON_TYPE[] = "application/json; charset=utf-8";
+
 const unordered_map<int, string> HttpResponse::CODE_PATH = {
     {400, "/400.html"},
     {403, "/403.html"},
@@ -42,13 +26,11 @@ HttpResponse::HttpResponse()
     code_ = -1;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
-    mmFile_ = nullptr;
     mmFileStat_ = {0};
 };
 
 HttpResponse::~HttpResponse()
 {
-    UnmapFile();
 }
 
 // void HttpResponse::Init(const string &srcDir, string &path, bool isKeepAlive, int code)
@@ -66,57 +48,114 @@ HttpResponse::~HttpResponse()
 //     mmFileStat_ = {0};
 // }
 
-void HttpResponse::Init(const string &srcDir, string &path, const std::string &retjson, bool isKeepAlive, int code)
+void HttpResponse::Init(string_view srcDir, string_view path, string_view retjson, bool isKeepAlive, int code)
 {
-    assert(srcDir != "");
-    if (mmFile_)
-    {
-        UnmapFile();
-    }
+    assert(!srcDir.empty());
     code_ = code;
     isKeepAlive_ = isKeepAlive;
-    path_ = path;
-    srcDir_ = srcDir;
-    mmFile_ = nullptr;
+    path_.assign(path.data(), path.size());
+    srcDir_.assign(srcDir.data(), srcDir.size());
     mmFileStat_ = {0};
 
-    retJson_ = retjson;
+    retJson_.assign(retjson.data(), retjson.size());
+    bodyType_ = retJson_.empty() ? string_view() : JSON_TYPE;
 }
 
-void HttpResponse::MakeResponse(Buffer &buff)
+void HttpResponse::MakeResponse(ChainBuffer &buff)
 {
+    shared_ptr<const FileCache::Snapshot> snap = FileCache::Instance()->Current();
 
-    /* 判断请求的资源文件 */
-    if (stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode))
+    /* 小文件缓存命中 直接使用预生成的完整响应 */
+    if (code_ == 200 && bodyType_.empty() && snap && UseCached_(buff, snap, snap->Find(path_)))
     {
-        code_ = 404;
+        return;
     }
-    else if (!(mmFileStat_.st_mode & S_IROTH))
+
+    /* 内存中生成的响应体 不访问文件 */
+    if (!bodyType_.empty() && CODE_PATH.count(code_) == 0)
     {
-        code_ = 403;
+        AddStateLine_(buff);
+        AppendHeader_(buff, isKeepAlive_, bodyType_);
+        AddContentLength_(buff, retJson_.size());
+        buff.Append(retJson_);
+        return;
     }
-    else if (code_ == -1)
+
+    /* 判断请求的资源文件 已经确定是错误响应的不再访问文件 */
+    if (CODE_PATH.count(code_) == 0)
     {
-        code_ = 200;
+        if (stat(FilePath_(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode))
+        {
+            code_ = 404;
+        }
+        else if (!(mmFileStat_.st_mode & S_IROTH))
+        {
+            code_ = 403;
+        }
+        else if (code_ == -1)
+        {
+            code_ = 200;
+        }
     }
-    ErrorHtml_();
-    AddStateLine_(buff);
-    AddHeader_(buff);
-    
-    if(!retJson_.empty()){
-        buff.Append("Content-Type: application/json; charset=utf-8\r\n");
-        buff.Append("Content-length: " + to_string(retJson_.size()) + "\r\n");
-        buff.Append("\r\n");  
-        buff.Append(retJson_);
+
+    /* 错误响应不访问文件系统 优先使用缓存的错误页 否则生成简单的错误页面 */
+    if (CODE_PATH.count(code_) == 1)
+    {
+        if (snap && UseCached_(buff, snap, snap->FindError(code_)))
+        {
+            return;
+        }
+        ErrorHtml_();
+        AddStateLine_(buff);
+        AddHeader_(buff);
+        ErrorContent(buff, CODE_STATUS.find(code_)->second);
         return;
     }
 
+    AddStateLine_(buff);
+    AddHeader_(buff);
+
     AddContent_(buff);
 }
 
-char *HttpResponse::File()
+void HttpResponse::MakeStreamHeader(ChainBuffer &buff, string_view type, bool chunked)
+{
+    if (!chunked)
+    {
+        isKeepAlive_ = false;
+    }
+    AddStateLine_(buff);
+    AppendHeader_(buff, isKeepAlive_, type);
+    if (chunked)
+    {
+        buff.Append("Transfer-Encoding: chunked\r\n");
+    }
+    buff.Append("\r\n");
+}
+
+void HttpResponse::MakeHeader(Buffer &buff, int code, bool isKeepAlive, string_view path, size_t contentLen)
 {
-    return mmFile_;
+    assert(CODE_STATUS.count(code) == 1);
+    buff.Append("HTTP/1.1 " + to_string(code) + " " + CODE_STATUS.find(code)->second + "\r\n");
+    AppendHeader_(buff, isKeepAlive, MimeType::Lookup(path));
+    buff.Append("Content-length: " + to_string(contentLen) + "\r\n\r\n");
+}
+
+const unordered_map<int, string> &HttpResponse::ErrorPages()
+{
+    return CODE_PATH;
+}
+
+bool HttpResponse::UseCached_(ChainBuffer &buff, const shared_ptr<const FileCache::Snapshot> &snap, const FileCache::Entry *entry)
+{
+    if (entry == nullptr)
+    {
+        return false;
+    }
+    // 引用缓存快照中的完整响应 快照由缓冲区持有直到发送完成
+    string_view response = entry->Response(isKeepAlive_);
+    buff.AppendShared(snap, response.data(), response.size());
+    return true;
 }
 
 size_t HttpResponse::FileLen() const
@@ -129,29 +168,35 @@ void HttpResponse::ErrorHtml_()
     if (CODE_PATH.count(code_) == 1)
     {
         path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(), &mmFileStat_);
     }
 }
 
-void HttpResponse::AddStateLine_(Buffer &buff)
+void HttpResponse::AddStateLine_(ChainBuffer &buff)
 {
-    string status;
-    if (CODE_STATUS.count(code_) == 1)
-    {
-        status = CODE_STATUS.find(code_)->second;
-    }
-    else
+    auto status = CODE_STATUS.find(code_);
+    if (status == CODE_STATUS.end())
     {
         code_ = 400;
-        status = CODE_STATUS.find(400)->second;
+        status = CODE_STATUS.find(400);
     }
-    buff.Append("HTTP/1.1 " + to_string(code_) + " " + status + "\r\n");
+    // 分段追加 不拼接临时字符串
+    char line[32];
+    int len = snprintf(line, sizeof(line), "HTTP/1.1 %d ", code_);
+    buff.Append(line, len);
+    buff.Append(status->second);
+    buff.Append("\r\n");
+}
+
+void HttpResponse::AddHeader_(ChainBuffer &buff)
+{
+    AppendHeader_(buff, isKeepAlive_, GetFileType_());
 }
 
-void HttpResponse::AddHeader_(Buffer &buff)
+template <class Buff>
+void HttpResponse::AppendHeader_(Buff &buff, bool isKeepAlive, string_view type)
 {
     buff.Append("Connection: ");
-    if (isKeepAlive_)
+    if (isKeepAlive)
     {
         buff.Append("keep-alive\r\n");
         buff.Append("keep-alive: max=6, timeout=120\r\n");
@@ -160,58 +205,57 @@ void HttpResponse::AddHeader_(Buffer &buff)
     {
         buff.Append("close\r\n");
     }
-    buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    buff.Append("Content-type: ");
+    buff.Append(type.data(), type.size());
+    buff.Append("\r\n");
 }
 
-void HttpResponse::AddContent_(Buffer &buff)
+void HttpResponse::AddContent_(ChainBuffer &buff)
 {
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
+    int srcFd = open(FilePath_(), O_RDONLY);
     if (srcFd < 0)
     {
         ErrorContent(buff, "File NotFound!");
         return;
     }
 
-    /* 将文件映射到内存提高文件的访问速度
-        MAP_PRIVATE 建立一个写入时拷贝的私有映射*/
-    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
-    int *mmRet = (int *)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if (*mmRet == -1)
+    /* 将文件映射到内存提高文件的访问速度 映射区域交给缓冲区 发送完成后解除映射 */
+    LOG_DEBUG("file path %s", filePath_.c_str());
+    shared_ptr<const char> file = ChainBuffer::MapFile(srcFd, 0, mmFileStat_.st_size);
+    close(srcFd);
+    if (!file && mmFileStat_.st_size > 0)
     {
         ErrorContent(buff, "File NotFound!");
         return;
     }
-    mmFile_ = (char *)mmRet;
-    close(srcFd);
-    buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    AddContentLength_(buff, mmFileStat_.st_size);
+    if (file)
+    {
+        const char *data = file.get();
+        buff.AppendShared(move(file), data, mmFileStat_.st_size);
+    }
 }
 
-void HttpResponse::UnmapFile()
+void HttpResponse::AddContentLength_(ChainBuffer &buff, size_t len)
 {
-    if (mmFile_)
-    {
-        munmap(mmFile_, mmFileStat_.st_size);
-        mmFile_ = nullptr;
-    }
+    char line[48];
+    int n = snprintf(line, sizeof(line), "Content-length: %zu\r\n\r\n", len);
+    buff.Append(line, n);
 }
 
-string HttpResponse::GetFileType_()
+const char *HttpResponse::FilePath_()
 {
-    /* 判断文件类型 */
-    string::size_type idx = path_.find_last_of('.');
-    if (idx == string::npos)
-    {
-        return "text/plain";
-    }
-    string suffix = path_.substr(idx);
-    if (SUFFIX_TYPE.count(suffix) == 1)
-    {
-        return SUFFIX_TYPE.find(suffix)->second;
-    }
-    return "text/plain";
+    filePath_.assign(srcDir_).append(path_);
+    return filePath_.c_str();
+}
+
+string_view HttpResponse::GetFileType_() const
+{
+    /* 判断文件类型 编译期完美哈希查表 */
+    return MimeType::Lookup(path_);
 }
 
-void HttpResponse::ErrorContent(Buffer &buff, string message)
+void HttpResponse::ErrorContent(ChainBuffer &buff, string message)
 {
     string body;
     string status;
@@ -229,6 +273,6 @@ void HttpResponse::ErrorContent(Buffer &buff, string message)
     body += "<p>" + message + "</p>";
     body += "<hr><em>TinyWebServer</em></body></html>";
 
-    buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
+    AddContentLength_(buff, body.size());
     buff.Append(body);
 }
\ No newline at end of file
@@ -2,13 +2,16 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
+#include <string_view>
 #include <fcntl.h>    // open
 #include <unistd.h>   // close
 #include <sys/stat.h> // stat
-#include <sys/mman.h> // mmap, munmap
 
 #include "../buffer/buffer.h"
+#include "../buffer/chainbuffer.h"
 #include "../log/log.h"
+#include "mimetype.h"
+#include "filecache.h"
 
 class HttpResponse
 {
@@ -17,36 +20,53 @@ public:
     ~HttpResponse();
 
     // void Init(const std::string &srcDir, std::string &path, bool isKeepAlive = false, int code = -1);
-    void Init(const std::string &srcDir, std::string &path, const std::string &retjson, bool isKeepAlive = false, int code = -1);
-    void MakeResponse(Buffer &buff);
-    void UnmapFile();
-    char *File();
+    void Init(std::string_view srcDir, std::string_view path, std::string_view retjson, bool isKeepAlive = false, int code = -1);
+    // 响应报文追加到链式缓冲区 文件与缓存内容以引用的方式追加 不拷贝
+    void MakeResponse(ChainBuffer &buff);
+    // 以Init传入的retjson为响应体 指定其类型 默认为JSON
+    void SetBodyType(std::string_view type) { bodyType_ = type; }
     size_t FileLen() const;
-    void ErrorContent(Buffer &buff, std::string message);
+    void ErrorContent(ChainBuffer &buff, std::string message);
+    // 流式响应只生成状态行与响应头 不分块时以关闭连接表示响应结束
+    void MakeStreamHeader(ChainBuffer &buff, std::string_view type, bool chunked);
     int Code() const { return code_; }
+    bool IsKeepAlive() const { return isKeepAlive_; }
+
+    // 生成状态行与响应头 供小文件缓存预生成完整响应
+    static void MakeHeader(Buffer &buff, int code, bool isKeepAlive, std::string_view path, size_t contentLen);
+    // 错误码 -> 错误页路径
+    static const std::unordered_map<int, std::string> &ErrorPages();
 
 private:
-    void AddStateLine_(Buffer &buff);
-    void AddHeader_(Buffer &buff);
-    void AddContent_(Buffer &buff);
+    void AddStateLine_(ChainBuffer &buff);
+    void AddHeader_(ChainBuffer &buff);
+    void AddContent_(ChainBuffer &buff);
+    void AddContentLength_(ChainBuffer &buff, size_t len);
+    // 资源的完整路径 复用同一块存储
+    const char *FilePath_();
+    template <class Buff>
+    static void AppendHeader_(Buff &buff, bool isKeepAlive, std::string_view type);
+    bool UseCached_(ChainBuffer &buff, const std::shared_ptr<const FileCache::Snapshot> &snap, const FileCache::Entry *entry);
 
     void ErrorHtml_();
-    std::string GetFileType_();
+    std::string_view GetFileType_() const;
 
     int code_;
     bool isKeepAlive_;
 
+    // 跨请求复用容量 Init赋值不产生内存分配
     std::string path_;
     std::string srcDir_;
+    std::string filePath_;
 
     std::string retJson_;
+    std::string_view bodyType_; // 为空时响应资源文件
 
-    char *mmFile_;
     struct stat mmFileStat_;
 
-    static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
     static const std::unordered_map<int, std::string> CODE_STATUS;
     static const std::unordered_map<int, std::string> CODE_PATH;
+    static const char JSON_TYPE[];
 };
 
 #endif //HTTP_RESPONSE_H
\ No newline at end of file
@@ -0,0 +1,187 @@
+#ifndef MIME_TYPE_H
+#define MIME_TYPE_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// 查表实现细节 仅供MimeType使用
+namespace mime_detail
+{
+struct Entry
+{
+    std::string_view suffix;
+    std::string_view type;
+};
+
+constexpr Entry TABLE[] = {
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"xml", "text/xml"},
+    {"xhtml", "application/xhtml+xml"},
+    {"txt", "text/plain"},
+    {"css", "text/css"},
+    {"js", "text/javascript"},
+    {"mjs", "text/javascript"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"wasm", "application/wasm"},
+    {"rtf", "application/rtf"},
+    {"pdf", "application/pdf"},
+    {"word", "application/msword"},
+    {"doc", "application/msword"},
+    {"png", "image/png"},
+    {"gif", "image/gif"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"svg", "image/svg+xml"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"au", "audio/basic"},
+    {"mp3", "audio/mpeg"},
+    {"ogg", "audio/ogg"},
+    {"wav", "audio/wav"},
+    {"mpeg", "video/mpeg"},
+    {"mpg", "video/mpeg"},
+    {"mp4", "video/mp4"},
+    {"webm", "video/webm"},
+    {"avi", "video/x-msvideo"},
+    {"gz", "application/x-gzip"},
+    {"tar", "application/x-tar"},
+    {"zip", "application/zip"},
+};
+
+constexpr size_t ENTRY_NUM = sizeof(TABLE) / sizeof(TABLE[0]);
+// 槽位数为2的幂 装载因子约0.3 编译期几百次尝试内即可找到无冲突的种子
+constexpr size_t SLOT_NUM = 128;
+constexpr size_t MAX_SUFFIX_LEN = 8;
+static_assert(ENTRY_NUM < SLOT_NUM, "MIME table is larger than slot count");
+
+constexpr char Lower(char ch)
+{
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+}
+
+constexpr bool EqualNoCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (Lower(a[i]) != Lower(b[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 带种子的FNV-1a 统一转小写
+constexpr uint32_t Hash(std::string_view s, uint32_t seed)
+{
+    uint32_t h = 2166136261u ^ seed;
+    for (char ch : s)
+    {
+        h ^= static_cast<uint8_t>(Lower(ch));
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+// 取最后一个路径段中的后缀(不含点号)
+constexpr std::string_view Suffix(std::string_view path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string_view::npos)
+    {
+        return {};
+    }
+    size_t slash = path.find_last_of('/');
+    if (slash != std::string_view::npos && slash > dot)
+    {
+        return {};
+    }
+    return path.substr(dot + 1);
+}
+
+// 编译期搜索使全表无冲突的种子
+constexpr uint32_t FindSeed()
+{
+    for (uint32_t seed = 0; seed < 20000; seed++)
+    {
+        bool used[SLOT_NUM] = {};
+        bool ok = true;
+        for (size_t i = 0; i < ENTRY_NUM && ok; i++)
+        {
+            size_t slot = Hash(TABLE[i].suffix, seed) & (SLOT_NUM - 1);
+            ok = !used[slot];
+            used[slot] = true;
+        }
+        if (ok)
+        {
+            return seed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+constexpr uint32_t SEED = FindSeed();
+static_assert(SEED != UINT32_MAX, "no perfect hash seed for MIME table");
+
+// 槽位 -> 表下标 空槽为-1
+constexpr std::array<int8_t, SLOT_NUM> BuildSlots()
+{
+    std::array<int8_t, SLOT_NUM> slots{};
+    for (size_t i = 0; i < SLOT_NUM; i++)
+    {
+        slots[i] = -1;
+    }
+    for (size_t i = 0; i < ENTRY_NUM; i++)
+    {
+        slots[Hash(TABLE[i].suffix, SEED) & (SLOT_NUM - 1)] = static_cast<int8_t>(i);
+    }
+    return slots;
+}
+
+constexpr std::array<int8_t, SLOT_NUM> SLOTS = BuildSlots();
+} // namespace mime_detail
+
+/**
+ * 文件后缀 -> MIME类型 查表
+ * 编译期为后缀表生成完美哈希(无冲突)，运行时一次哈希一次比较，返回string_view不分配内存
+ * 后缀不区分大小写，不带点号
+ */
+class MimeType
+{
+public:
+    // 根据路径的后缀返回MIME类型，未知后缀返回 text/plain
+    static constexpr std::string_view Lookup(std::string_view path)
+    {
+        using namespace mime_detail;
+        std::string_view suffix = Suffix(path);
+        if (suffix.empty() || suffix.size() > MAX_SUFFIX_LEN)
+        {
+            return DEFAULT_TYPE;
+        }
+        int idx = SLOTS[Hash(suffix, SEED) & (SLOT_NUM - 1)];
+        if (idx >= 0 && EqualNoCase(TABLE[idx].suffix, suffix))
+        {
+            return TABLE[idx].type;
+        }
+        return DEFAULT_TYPE;
+    }
+
+    static constexpr std::string_view DEFAULT_TYPE = "text/plain";
+};
+
+static_assert(MimeType::Lookup("/index.html") == "text/html", "MIME lookup broken");
+static_assert(MimeType::Lookup("/video/xxx.MP4") == "video/mp4", "MIME lookup broken");
+static_assert(MimeType::Lookup("/a.b/noext") == MimeType::DEFAULT_TYPE, "MIME lookup broken");
+
+#endif // MIME_TYPE_H
@@ -0,0 +1,300 @@
+#include "multipartparser.h"
+
+#include <algorithm>
+#include <string.h>
+#include <strings.h>
+
+namespace
+{
+std::string_view Trim(std::string_view s)
+{
+    size_t start = s.find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+    {
+        return std::string_view();
+    }
+    size_t end = s.find_last_not_of(" \t");
+    return s.substr(start, end - start + 1);
+}
+
+bool StartsWithNoCase(std::string_view s, std::string_view prefix)
+{
+    return s.size() >= prefix.size() && strncasecmp(s.data(), prefix.data(), prefix.size()) == 0;
+}
+
+// 取出形如 key=value 或 key="value" 的参数值 找不到返回false
+bool FindParam(std::string_view header, std::string_view key, std::string_view &value)
+{
+    size_t pos = 0;
+    while (pos < header.size())
+    {
+        size_t end = header.find(';', pos);
+        if (end == std::string_view::npos)
+        {
+            end = header.size();
+        }
+        std::string_view item = Trim(header.substr(pos, end - pos));
+        size_t eq = item.find('=');
+        if (eq != std::string_view::npos && Trim(item.substr(0, eq)).size() == key.size() &&
+            StartsWithNoCase(Trim(item.substr(0, eq)), key))
+        {
+            value = Trim(item.substr(eq + 1));
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+            {
+                value = value.substr(1, value.size() - 2);
+            }
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+} // namespace
+
+MultipartParser::MultipartParser() : state_(ERROR) {}
+
+std::string_view MultipartParser::Boundary(std::string_view contentType)
+{
+    std::string_view boundary;
+    if (!StartsWithNoCase(Trim(contentType), "multipart/form-data") ||
+        !FindParam(contentType, "boundary", boundary))
+    {
+        return std::string_view();
+    }
+    return boundary;
+}
+
+bool MultipartParser::Init(std::string_view boundary)
+{
+    // 分隔符中只允许第一个字节是'\r' 片段末尾的前缀判断依赖这一点
+    if (boundary.empty() || boundary.size() > MAX_BOUNDARY ||
+        boundary.find_first_of("\r\n") != std::string_view::npos)
+    {
+        state_ = ERROR;
+        return false;
+    }
+    delim_ = "\r\n--";
+    delim_.append(boundary.data(), boundary.size());
+    searcher_.emplace(delim_.cbegin(), delim_.cend());
+    // 第一个分隔符前面没有回车换行 预先放入暂存区统一处理
+    carry_ = "\r\n";
+    head_.clear();
+    part_ = Part();
+    state_ = PREAMBLE;
+    return true;
+}
+
+void MultipartParser::SetHandler(PartHandler onBegin, DataHandler onData, PartHandler onEnd)
+{
+    onBegin_ = std::move(onBegin);
+    onData_ = std::move(onData);
+    onEnd_ = std::move(onEnd);
+}
+
+bool MultipartParser::IsDone() const
+{
+    return state_ == DONE;
+}
+
+bool MultipartParser::IsError() const
+{
+    return state_ == ERROR;
+}
+
+bool MultipartParser::Feed(const char *data, size_t len)
+{
+    while (len > 0 && state_ != DONE && state_ != ERROR)
+    {
+        size_t used = 0;
+        switch (state_)
+        {
+        case PREAMBLE:
+        case DATA:
+            used = ScanDelim_(data, len);
+            break;
+        case AFTER_DELIM:
+            used = ParseAfterDelim_(data, len);
+            break;
+        case HEADERS:
+            used = ParseHeaders_(data, len);
+            break;
+        default:
+            break;
+        }
+        data += used;
+        len -= used;
+    }
+    return state_ != ERROR;
+}
+
+size_t MultipartParser::ScanDelim_(const char *data, size_t len)
+{
+    const char *end = data + len;
+    if (!carry_.empty())
+    {
+        size_t need = delim_.size() - carry_.size();
+        size_t n = std::min(need, len);
+        if (memcmp(data, delim_.data() + carry_.size(), n) != 0)
+        {
+            // 暂存的字节不是分隔符 属于数据 分隔符不会从暂存区中间开始
+            std::string carry;
+            carry.swap(carry_);
+            Emit_(carry.data(), carry.size());
+            return 0;
+        }
+        if (n < need)
+        {
+            carry_.append(data, n);
+            return n;
+        }
+        carry_.clear();
+        if (state_ == DATA && onEnd_ && !onEnd_(part_))
+        {
+            Fail_();
+            return len;
+        }
+        state_ = AFTER_DELIM;
+        return n;
+    }
+
+    const char *pos = std::search(data, end, *searcher_);
+    if (pos != end)
+    {
+        if (!Emit_(data, pos - data))
+        {
+            return len;
+        }
+        if (state_ == DATA && onEnd_ && !onEnd_(part_))
+        {
+            Fail_();
+            return len;
+        }
+        state_ = AFTER_DELIM;
+        return pos - data + delim_.size();
+    }
+
+    // 没有完整的分隔符 末尾可能是分隔符的前缀 暂存到下一个片段
+    const char *tail = std::find(end - std::min(len, delim_.size() - 1), end, '\r');
+    while (tail != end && memcmp(tail, delim_.data(), end - tail) != 0)
+    {
+        tail = std::find(tail + 1, end, '\r');
+    }
+    if (Emit_(data, tail - data))
+    {
+        carry_.assign(tail, end);
+    }
+    return len;
+}
+
+size_t MultipartParser::ParseAfterDelim_(const char *data, size_t len)
+{
+    size_t n = std::min(2 - head_.size(), len);
+    head_.append(data, n);
+    if (head_.size() < 2)
+    {
+        return n;
+    }
+    if (head_ == "--")
+    {
+        state_ = DONE;
+    }
+    else if (head_ == "\r\n")
+    {
+        // 保留回车换行 没有头部的部分也能用"\r\n\r\n"找到头部结尾
+        state_ = HEADERS;
+    }
+    else
+    {
+        Fail_();
+    }
+    return n;
+}
+
+size_t MultipartParser::ParseHeaders_(const char *data, size_t len)
+{
+    size_t old = head_.size();
+    size_t n = std::min(len, MAX_HEADER + 4 - old);
+    head_.append(data, n);
+    size_t pos = head_.find("\r\n\r\n", old >= 3 ? old - 3 : 0);
+    if (pos == std::string::npos)
+    {
+        if (head_.size() >= MAX_HEADER + 4)
+        {
+            Fail_();
+        }
+        return n;
+    }
+    part_ = Part();
+    if (!ParsePartHeader_(std::string_view(head_).substr(2, pos)))
+    {
+        Fail_();
+        return n;
+    }
+    head_.clear();
+    state_ = DATA;
+    if (onBegin_ && !onBegin_(part_))
+    {
+        Fail_();
+        return n;
+    }
+    return pos + 4 - old;
+}
+
+bool MultipartParser::ParsePartHeader_(std::string_view block)
+{
+    while (!block.empty())
+    {
+        size_t eol = block.find("\r\n");
+        std::string_view line = block.substr(0, eol);
+        block = eol == std::string_view::npos ? std::string_view() : block.substr(eol + 2);
+
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+        {
+            return false;
+        }
+        std::string_view key = Trim(line.substr(0, colon));
+        std::string_view value = Trim(line.substr(colon + 1));
+        part_.header[std::string(key)] = std::string(value);
+
+        std::string_view param;
+        if (key.size() == 19 && StartsWithNoCase(key, "Content-Disposition"))
+        {
+            if (FindParam(value, "name", param))
+            {
+                part_.name = std::string(param);
+            }
+            if (FindParam(value, "filename", param))
+            {
+                part_.filename = std::string(param);
+            }
+        }
+        else if (key.size() == 12 && StartsWithNoCase(key, "Content-Type"))
+        {
+            part_.contentType = std::string(value);
+        }
+    }
+    return true;
+}
+
+bool MultipartParser::Emit_(const char *data, size_t len)
+{
+    // 第一个分隔符之前的内容丢弃
+    if (state_ != DATA || len == 0 || !onData_)
+    {
+        return true;
+    }
+    if (!onData_(part_, data, len))
+    {
+        Fail_();
+        return false;
+    }
+    return true;
+}
+
+void MultipartParser::Fail_()
+{
+    state_ = ERROR;
+    carry_.clear();
+    head_.clear();
+}
@@ -0,0 +1,88 @@
+#ifndef MULTIPART_PARSER_H
+#define MULTIPART_PARSER_H
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * 增量的multipart/form-data解析器
+ * 请求体以任意大小的片段输入，用Boyer-Moore-Horspool查找分隔符"\r\n--boundary"，
+ * 分隔符之间的数据直接以输入片段中的指针交给回调，不拷贝不缓存；
+ * 只有片段末尾可能是分隔符前缀的几个字节和每个部分的头部(上限MAX_HEADER)会被暂存。
+ */
+class MultipartParser
+{
+public:
+    struct Part
+    {
+        std::string name;        // Content-Disposition中的name
+        std::string filename;    // Content-Disposition中的filename 为空表示普通字段
+        std::string contentType; // 部分的Content-Type
+        std::unordered_map<std::string, std::string> header;
+    };
+
+    // 回调返回false中止解析
+    typedef std::function<bool(const Part &part)> PartHandler;
+    typedef std::function<bool(const Part &part, const char *data, size_t len)> DataHandler;
+
+    MultipartParser();
+
+    // 查找器引用delim_的迭代器 不可拷贝
+    MultipartParser(const MultipartParser &) = delete;
+    MultipartParser &operator=(const MultipartParser &) = delete;
+
+    // 从Content-Type中取出boundary 失败返回空
+    static std::string_view Boundary(std::string_view contentType);
+
+    // 开始解析新的请求体
+    bool Init(std::string_view boundary);
+    void SetHandler(PartHandler onBegin, DataHandler onData, PartHandler onEnd);
+
+    // 输入请求体片段 出错返回false
+    bool Feed(const char *data, size_t len);
+
+    bool IsDone() const;
+    bool IsError() const;
+
+    static const size_t MAX_BOUNDARY = 70;     // RFC 2046
+    static const size_t MAX_HEADER = 8 * 1024; // 每个部分的头部上限
+
+private:
+    enum STATE
+    {
+        PREAMBLE,    // 第一个分隔符之前 丢弃
+        AFTER_DELIM, // 分隔符之后 "\r\n"开始新部分 "--"表示结束
+        HEADERS,     // 部分的头部
+        DATA,        // 部分的数据
+        DONE,        // 结束分隔符之后 丢弃
+        ERROR,
+    };
+
+    typedef std::boyer_moore_horspool_searcher<std::string::const_iterator> Searcher;
+
+    // 在数据中查找分隔符 返回消耗的字节数
+    size_t ScanDelim_(const char *data, size_t len);
+    size_t ParseAfterDelim_(const char *data, size_t len);
+    size_t ParseHeaders_(const char *data, size_t len);
+    bool ParsePartHeader_(std::string_view block);
+
+    bool Emit_(const char *data, size_t len);
+    void Fail_();
+
+    STATE state_;
+    std::string delim_;              // "\r\n--" + boundary
+    std::optional<Searcher> searcher_;
+    std::string carry_;              // 上一片段末尾 可能是分隔符前缀的字节
+    std::string head_;               // 未解析完的分隔符后缀或部分头部
+    Part part_;
+
+    PartHandler onBegin_;
+    DataHandler onData_;
+    PartHandler onEnd_;
+};
+
+#endif // MULTIPART_PARSER_H
@@ -0,0 +1,115 @@
+#include "requestbody.h"
+#include "../log/log.h"
+#include "../config/config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+std::string RequestBody::tempDir = "/tmp";
+
+// 内存中保留的容量上限 超过后清空时释放 避免长连接一直持有大块内存
+static const size_t MAX_RETAINED = 64 * 1024;
+
+RequestBody::RequestBody() : fd_(-1), size_(0) {}
+
+RequestBody::~RequestBody()
+{
+    Clear();
+}
+
+void RequestBody::Clear()
+{
+    if (data_.capacity() > MAX_RETAINED)
+    {
+        std::string().swap(data_);
+    }
+    else
+    {
+        data_.clear();
+    }
+    if (fd_ >= 0)
+    {
+        close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
+
+bool RequestBody::Append(const char *data, size_t len)
+{
+    // 内存中保存的上限为配置的bodySpillSize 0表示总是转存
+    if (fd_ < 0 && data_.size() + len > (size_t)Config::current().bodySpillSize && !Spill_())
+    {
+        return false;
+    }
+    size_ += len;
+    if (fd_ < 0)
+    {
+        data_.append(data, len);
+        return true;
+    }
+    return WriteAll_(data, len);
+}
+
+size_t RequestBody::Size() const
+{
+    return size_;
+}
+
+bool RequestBody::InFile() const
+{
+    return fd_ >= 0;
+}
+
+std::string &RequestBody::Data()
+{
+    return data_;
+}
+
+int RequestBody::Fd() const
+{
+    return fd_;
+}
+
+bool RequestBody::Spill_()
+{
+    std::string path = tempDir + "/webserver-body-XXXXXX";
+    fd_ = mkostemp(&path[0], O_CLOEXEC);
+    if (fd_ < 0)
+    {
+        LOG_ERROR("Create body temp file in %s error:%d", tempDir.c_str(), errno);
+        return false;
+    }
+    // 立即删除文件名 关闭描述符后由内核回收
+    unlink(path.c_str());
+    LOG_DEBUG("Body spill to temp file, size:%d", (int)size_);
+    if (!WriteAll_(data_.data(), data_.size()))
+    {
+        return false;
+    }
+    std::string().swap(data_);
+    return true;
+}
+
+bool RequestBody::WriteAll_(const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd_, data, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOG_ERROR("Write body temp file error:%d", errno);
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef REQUEST_BODY_H
+#define REQUEST_BODY_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * 请求体存储
+ * 小的请求体保存在内存中；累计超过配置的bodySpillSize后转存到匿名临时文件(创建后立即unlink)，
+ * 之后的片段直接追加写入文件，大文件上传时内存占用保持不变。
+ */
+class RequestBody
+{
+public:
+    RequestBody();
+    ~RequestBody();
+
+    RequestBody(const RequestBody &) = delete;
+    RequestBody &operator=(const RequestBody &) = delete;
+
+    // 清空内容 关闭临时文件
+    void Clear();
+
+    // 追加正文片段 写临时文件失败返回false
+    bool Append(const char *data, size_t len);
+
+    size_t Size() const;
+    // 是否已转存到临时文件
+    bool InFile() const;
+
+    // 内存中的内容 转存到文件后为空
+    std::string &Data();
+    // 临时文件描述符 未转存时为-1
+    int Fd() const;
+
+    // 临时文件目录
+    static std::string tempDir;
+
+private:
+    bool Spill_();
+    bool WriteAll_(const char *data, size_t len);
+
+    std::string data_;
+    int fd_;
+    size_t size_;
+};
+
+#endif // REQUEST_BODY_H
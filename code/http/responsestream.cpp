@@ -0,0 +1,167 @@
+#include "responsestream.h"
+#include "../buffer/bufferpool.h"
+#include "../log/log.h"
+#include "../metrics/probes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+ResponseStream::ResponseStream() : fd_(-1), pid_(-1), chunked_(false), broken_(false) {}
+
+ResponseStream::~ResponseStream()
+{
+    Abort();
+}
+
+bool ResponseStream::IsOpen() const
+{
+    return fd_ >= 0;
+}
+
+bool ResponseStream::IsBroken() const
+{
+    return broken_;
+}
+
+bool ResponseStream::Open(const std::vector<std::string> &cmd, bool chunked)
+{
+    Abort();
+    broken_ = false;
+    chunked_ = chunked;
+    if (cmd.size() < 2)
+    {
+        return false;
+    }
+
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) == -1)
+    {
+        LOG_ERROR("pipe() error:%d", errno);
+        return false;
+    }
+
+    // argv在fork之前准备好 子进程中只调用exec
+    std::vector<char *> argv;
+    for (size_t i = 1; i < cmd.size(); i++)
+    {
+        argv.push_back(const_cast<char *>(cmd[i].c_str()));
+    }
+    argv.push_back(nullptr);
+
+    // 创建子进程
+    pid_t pid = fork();
+
+    /**
+     * 创建子进程后，父进程继续执行，子进程会从下面的语句开始执行。两个程序都从fork的下一行开始执行
+     * 如果pid为0，标识子进程，通常用execv函数执行一个新的程序替换到子进程
+     * 新的程序如果成功执行就不会执行子进程接下来的语句了，如果执行失败，继续执行下面的语句，然后通常子进程通过exit退出自身
+     */
+    if (pid == 0) // 子进程
+    {
+        // 将标准输出重定向到管道写端 dup2后的描述符不带O_CLOEXEC
+        dup2(pipefd[1], STDOUT_FILENO);
+        // 服务器忽略了SIGPIPE 子进程恢复默认行为 客户端断开后写管道时直接退出
+        signal(SIGPIPE, SIG_DFL);
+
+        execv(cmd[0].c_str(), argv.data());
+
+        static const char ERR[] = "{\"status\": \"409\",\"msg\": \"cgi run error\"}\n";
+        ssize_t ret = write(STDOUT_FILENO, ERR, sizeof(ERR) - 1);
+        (void)ret;
+        _exit(1); // execv会执行进程的清理工作 _exit直接系统调用关闭进程
+    }
+    close(pipefd[1]); // 关闭写端 子进程结束后读端才能读到EOF
+    if (pid < 0)
+    {
+        LOG_ERROR("fork() error:%d", errno);
+        close(pipefd[0]);
+        return false;
+    }
+    WEBSERVER_PROBE2(cgi_spawn, pid, cmd[0].c_str());
+    fd_ = pipefd[0];
+    pid_ = pid;
+    return true;
+}
+
+ssize_t ResponseStream::Pump(ChainBuffer &buff)
+{
+    if (fd_ < 0)
+    {
+        return 0;
+    }
+    // 读到线程局部的临时空间 只在本次调用内使用
+    char *data = BufferPool::Scratch();
+    ssize_t len;
+    do
+    {
+        len = read(fd_, data, BufferPool::ScratchSize());
+    } while (len < 0 && errno == EINTR);
+
+    if (len < 0)
+    {
+        LOG_ERROR("CGI pipe read error:%d", errno);
+        broken_ = true;
+        Close_(true);
+        return -1;
+    }
+    if (len == 0)
+    {
+        // 生产者结束 发送结束块
+        if (chunked_)
+        {
+            buff.AppendStatic("0\r\n\r\n", 5);
+        }
+        Close_(false);
+        return 0;
+    }
+    if (chunked_)
+    {
+        char head[32];
+        int n = snprintf(head, sizeof(head), "%zx\r\n", static_cast<size_t>(len));
+        buff.Append(head, n);
+        buff.Append(data, len);
+        buff.AppendStatic("\r\n", 2);
+    }
+    else
+    {
+        buff.Append(data, len);
+    }
+    return len;
+}
+
+void ResponseStream::Abort()
+{
+    if (fd_ >= 0)
+    {
+        broken_ = true;
+        Close_(true);
+    }
+}
+
+void ResponseStream::Close_(bool kill)
+{
+    close(fd_);
+    fd_ = -1;
+    if (kill)
+    {
+        ::kill(pid_, SIGKILL);
+    }
+
+    // 等待子进程结束
+    int status;
+    waitpid(pid_, &status, 0);
+    WEBSERVER_PROBE2(cgi_exit, pid_, status);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+    {
+        LOG_DEBUG("CGI programe execute success");
+    }
+    else
+    {
+        LOG_ERROR("CGI programe execute error:%d", WEXITSTATUS(status));
+    }
+    pid_ = -1;
+}
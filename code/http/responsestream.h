@@ -0,0 +1,49 @@
+#ifndef RESPONSE_STREAM_H
+#define RESPONSE_STREAM_H
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "../buffer/chainbuffer.h"
+
+/**
+ * 流式响应的生产者
+ * 以子进程(CGI)的标准输出作为数据来源，不等待生产者结束就开始发送。
+ * 每次Pump()读取生产者已经写出的数据，编码为Transfer-Encoding: chunked的分块追加到写缓冲区；
+ * HTTP/1.0的客户端不支持分块，直接追加原始数据，由关闭连接表示响应结束。
+ */
+class ResponseStream
+{
+public:
+    ResponseStream();
+    ~ResponseStream();
+
+    ResponseStream(const ResponseStream &) = delete;
+    ResponseStream &operator=(const ResponseStream &) = delete;
+
+    // 启动子进程 cmd[0]为程序路径 其余为argv
+    bool Open(const std::vector<std::string> &cmd, bool chunked);
+
+    // 读取一次生产者的输出追加到buff 返回读取的字节数
+    // 生产者结束时追加结束块并回收子进程 返回0; 出错返回-1 响应被截断 连接不能复用
+    ssize_t Pump(ChainBuffer &buff);
+
+    // 终止生产者 用于客户端断开等情况
+    void Abort();
+
+    bool IsOpen() const;
+    // 响应是否被截断
+    bool IsBroken() const;
+
+private:
+    // 关闭管道并回收子进程 kill为true时先结束子进程
+    void Close_(bool kill);
+
+    int fd_;     // 子进程标准输出的管道读端
+    pid_t pid_;
+    bool chunked_;
+    bool broken_;
+};
+
+#endif // RESPONSE_STREAM_H
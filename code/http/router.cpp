@@ -0,0 +1,244 @@
+#include "router.h"
+#include "../log/log.h"
+
+using namespace std;
+
+string_view Router::Match::Param(string_view key) const
+{
+    for (size_t i = 0; i < paramCount; i++)
+    {
+        if (params[i][0] == key)
+        {
+            return params[i][1];
+        }
+    }
+    return string_view();
+}
+
+Router::Router() : root_(new Node())
+{
+}
+
+Router::~Router()
+{
+}
+
+Router *Router::Instance()
+{
+    static Router router;
+    return &router;
+}
+
+int Router::MethodIndex_(string_view method)
+{
+    static const string_view METHODS[METHOD_COUNT] = {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS", "*"};
+    for (int i = 0; i < METHOD_COUNT; i++)
+    {
+        if (METHODS[i] == method)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool Router::Add(string_view method, string_view pattern, Route route)
+{
+    int m = MethodIndex_(method);
+    if (m < 0 || pattern.empty() || pattern[0] != '/')
+    {
+        LOG_ERROR("Route %.*s %.*s invalid", (int)method.size(), method.data(), (int)pattern.size(), pattern.data());
+        return false;
+    }
+
+    // 依次插入静态文本、参数段与通配段
+    Node *node = root_.get();
+    size_t params = 0;
+    string_view rest = pattern;
+    while (!rest.empty())
+    {
+        if (rest[0] != ':' && rest[0] != '*')
+        {
+            size_t end = rest.find_first_of(":*");
+            string_view text = rest.substr(0, end);
+            if (end != string_view::npos && text.back() != '/')
+            {
+                LOG_ERROR("Route %.*s: parameter must start a segment", (int)pattern.size(), pattern.data());
+                return false;
+            }
+            node = InsertStatic_(node, text);
+            rest.remove_prefix(text.size());
+            continue;
+        }
+
+        bool wild = rest[0] == '*';
+        size_t end = rest.find('/');
+        string_view name = rest.substr(1, end == string_view::npos ? end : end - 1);
+        if (name.empty() || name.find_first_of(":*") != string_view::npos || (wild && end != string_view::npos) ||
+            ++params > MAX_PARAMS)
+        {
+            LOG_ERROR("Route %.*s: invalid parameter", (int)pattern.size(), pattern.data());
+            return false;
+        }
+        unique_ptr<Node> &child = wild ? node->wildChild : node->paramChild;
+        if (!child)
+        {
+            child.reset(new Node());
+            child->name.assign(name.data(), name.size());
+        }
+        else if (child->name != name)
+        {
+            // 同一位置的参数名必须一致 否则无法确定参数名
+            LOG_ERROR("Route %.*s: conflicts with parameter %s", (int)pattern.size(), pattern.data(), child->name.c_str());
+            return false;
+        }
+        node = child.get();
+        rest.remove_prefix(name.size() + 1);
+    }
+
+    if (node->routes[m])
+    {
+        LOG_ERROR("Route %.*s %.*s duplicated", (int)method.size(), method.data(), (int)pattern.size(), pattern.data());
+        return false;
+    }
+    route.method.assign(method.data(), method.size());
+    route.pattern.assign(pattern.data(), pattern.size());
+    route.id = routes_.size();
+    routes_.emplace_back(new Route(move(route)));
+    node->routes[m] = routes_.back().get();
+    return true;
+}
+
+bool Router::AddStatic(string_view pattern, string_view target)
+{
+    return Add("GET", pattern, Route{STATIC, string(target), {}, {}, nullptr});
+}
+
+bool Router::AddAlias(string_view pattern, string_view file)
+{
+    return Add("*", pattern, Route{ALIAS, string(file), {}, {}, nullptr});
+}
+
+bool Router::AddCgi(string_view method, string_view pattern, string_view program, vector<string> args)
+{
+    return Add(method, pattern, Route{CGI, string(program), move(args), {}, nullptr});
+}
+
+bool Router::AddHandler(string_view method, string_view pattern, string_view contentType, Handler handler,
+                        bool localOnly)
+{
+    return Add(method, pattern, Route{HANDLER, {}, {}, string(contentType), move(handler), localOnly});
+}
+
+// 在node下插入静态文本 与已有子节点共享前缀时拆分子节点 返回文本末尾对应的节点
+Router::Node *Router::InsertStatic_(Node *node, string_view text)
+{
+    while (!text.empty())
+    {
+        size_t i = node->indices.find(text[0]);
+        if (i == string::npos)
+        {
+            node->indices.push_back(text[0]);
+            node->children.emplace_back(new Node());
+            node->children.back()->label.assign(text.data(), text.size());
+            return node->children.back().get();
+        }
+
+        unique_ptr<Node> &child = node->children[i];
+        size_t common = 0;
+        while (common < text.size() && common < child->label.size() && text[common] == child->label[common])
+        {
+            common++;
+        }
+        if (common < child->label.size())
+        {
+            // 拆分 公共前缀成为新的中间节点
+            unique_ptr<Node> split(new Node());
+            split->label = child->label.substr(0, common);
+            child->label.erase(0, common);
+            split->indices.push_back(child->label[0]);
+            split->children.push_back(move(child));
+            child = move(split);
+        }
+        node = child.get();
+        text.remove_prefix(common);
+    }
+    return node;
+}
+
+bool Router::Find(string_view method, string_view path, Match &match) const
+{
+    match.route = nullptr;
+    match.paramCount = 0;
+    match.rest = string_view();
+    int m = MethodIndex_(method);
+    if (m < 0 || path.empty())
+    {
+        return false;
+    }
+    return Match_(root_.get(), path, m, match);
+}
+
+bool Router::SetRoute_(const Node *node, int method, Match &match)
+{
+    match.route = node->routes[method] ? node->routes[method] : node->routes[ANY];
+    return match.route != nullptr;
+}
+
+// path为node之后尚未匹配的部分 静态 > 参数 > 通配 失败时回溯
+bool Router::Match_(const Node *node, string_view path, int method, Match &match) const
+{
+    if (path.empty())
+    {
+        if (SetRoute_(node, method, match))
+        {
+            return true;
+        }
+    }
+    else
+    {
+        size_t i = node->indices.find(path[0]);
+        if (i != string::npos)
+        {
+            const Node *child = node->children[i].get();
+            if (path.compare(0, child->label.size(), child->label) == 0 &&
+                Match_(child, path.substr(child->label.size()), method, match))
+            {
+                return true;
+            }
+        }
+
+        if (node->paramChild)
+        {
+            string_view value = path.substr(0, path.find('/'));
+            if (!value.empty())
+            {
+                size_t count = match.paramCount;
+                match.params[count][0] = node->paramChild->name;
+                match.params[count][1] = value;
+                match.paramCount = count + 1;
+                if (Match_(node->paramChild.get(), path.substr(value.size()), method, match))
+                {
+                    return true;
+                }
+                match.paramCount = count;
+            }
+        }
+    }
+
+    if (node->wildChild && SetRoute_(node->wildChild.get(), method, match))
+    {
+        match.params[match.paramCount][0] = node->wildChild->name;
+        match.params[match.paramCount][1] = path;
+        match.paramCount++;
+        match.rest = path;
+        return true;
+    }
+    return false;
+}
+
+void Router::Clear()
+{
+    root_.reset(new Node());
+    routes_.clear();
+}
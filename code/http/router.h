@@ -0,0 +1,123 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class HttpRequest;
+
+/**
+ * 压缩前缀树(radix tree)路由
+ * 启动时注册 方法+路径模式 -> 路由目标，之后只读，多个线程并发匹配不需要加锁。
+ * 路径模式由静态文本、参数段(":name"，匹配一个非空的路径段)和通配段("*name"，匹配剩余的路径，只能在末尾)组成，
+ * 如 "/user/:id/avatar"，或在 "/assets/" 之后接通配段 "*file"；同一位置的优先级为 静态 > 参数 > 通配。
+ * 匹配只沿路径前进，耗时与路径长度成正比，参数是指向请求路径的视图，不产生内存分配。
+ */
+class Router
+{
+public:
+    enum Kind
+    {
+        STATIC,  // 资源目录下的文件 target为路径前缀 通配段的值拼接在其后 target为空时使用请求路径
+        ALIAS,   // 固定的资源文件 target为文件路径
+        CGI,     // 启动CGI程序 target为程序路径
+        HANDLER, // 进程内的处理函数
+    };
+
+    struct Match;
+    // 处理函数把响应体写入body 响应类型为路由的contentType
+    typedef std::function<void(const HttpRequest &req, const Match &match, std::string &body)> Handler;
+
+    struct Route
+    {
+        Kind kind;
+        std::string target;
+        std::vector<std::string> args; // CGI的argv 以'$'开头的元素替换为同名的表单字段
+        std::string contentType;       // HANDLER的响应类型
+        Handler handler;
+        bool localOnly = false; // 只响应本机(回环地址)的请求 其他客户端与不存在的路径一样得到404
+
+        // 由Add填写 用于统计
+        std::string method;
+        std::string pattern;
+        size_t id;
+    };
+
+    static const size_t MAX_PARAMS = 8;
+
+    // 匹配结果 视图指向请求路径 在请求结束前有效
+    struct Match
+    {
+        const Route *route = nullptr;
+        std::string_view params[MAX_PARAMS][2]; // 参数名 参数值
+        size_t paramCount = 0;
+        std::string_view rest; // 通配段匹配的剩余路径
+
+        // 按参数名查找 找不到返回空
+        std::string_view Param(std::string_view key) const;
+    };
+
+    Router();
+    ~Router();
+
+    Router(const Router &) = delete;
+    Router &operator=(const Router &) = delete;
+
+    // 服务器使用的路由表 启动时注册
+    static Router *Instance();
+
+    // 注册路由 method为"*"时匹配任意方法 模式非法或与已有路由冲突时返回false
+    bool Add(std::string_view method, std::string_view pattern, Route route);
+    bool AddStatic(std::string_view pattern, std::string_view target = std::string_view());
+    bool AddAlias(std::string_view pattern, std::string_view file);
+    bool AddCgi(std::string_view method, std::string_view pattern, std::string_view program, std::vector<std::string> args);
+    bool AddHandler(std::string_view method, std::string_view pattern, std::string_view contentType, Handler handler,
+                    bool localOnly = false);
+
+    // 匹配请求 没有对应的路由返回false
+    bool Find(std::string_view method, std::string_view path, Match &match) const;
+
+    void Clear();
+    size_t Size() const { return routes_.size(); }
+    // 按注册顺序编号 id为Add时分配的序号
+    const Route &RouteAt(size_t id) const { return *routes_[id]; }
+
+private:
+    enum METHOD
+    {
+        GET,
+        HEAD,
+        POST,
+        PUT,
+        DELETE,
+        PATCH,
+        OPTIONS,
+        ANY,
+        METHOD_COUNT,
+    };
+
+    struct Node
+    {
+        std::string label;                           // 压缩的静态文本
+        std::string indices;                         // 静态子节点label的首字符 与children一一对应
+        std::vector<std::unique_ptr<Node>> children; // 静态子节点
+        std::unique_ptr<Node> paramChild;            // ":name"
+        std::unique_ptr<Node> wildChild;             // "*name"
+        std::string name;                            // 参数段与通配段的参数名
+        const Route *routes[METHOD_COUNT] = {};
+    };
+
+    static int MethodIndex_(std::string_view method);
+    static Node *InsertStatic_(Node *node, std::string_view text);
+    bool Match_(const Node *node, std::string_view path, int method, Match &match) const;
+    static bool SetRoute_(const Node *node, int method, Match &match);
+
+    std::unique_ptr<Node> root_;
+    std::vector<std::unique_ptr<Route>> routes_;
+};
+
+#endif // ROUTER_H
@@ -0,0 +1,77 @@
+#include "urlencoded.h"
+
+#include <string.h>
+
+namespace
+{
+// 16进制字符转换为数值 非法字符返回-1
+int HexValue(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    return -1;
+}
+} // namespace
+
+size_t UrlEncoded::Decode(char *data, size_t len)
+{
+    // 解码结果不会比原文长 读写指针在同一块内存上前进
+    size_t w = 0;
+    for (size_t r = 0; r < len; r++)
+    {
+        char ch = data[r];
+        if (ch == '+')
+        {
+            ch = ' ';
+        }
+        else if (ch == '%' && r + 2 < len)
+        {
+            int hi = HexValue(data[r + 1]);
+            int lo = HexValue(data[r + 2]);
+            if (hi >= 0 && lo >= 0)
+            {
+                ch = static_cast<char>(hi * 16 + lo);
+                r += 2;
+            }
+        }
+        data[w++] = ch;
+    }
+    return w;
+}
+
+void UrlEncoded::Parse(char *data, size_t len, FieldList &fields)
+{
+    char *end = data + len;
+    char *p = data;
+    while (p < end)
+    {
+        char *amp = static_cast<char *>(memchr(p, '&', end - p));
+        char *segEnd = amp ? amp : end;
+        if (segEnd > p)
+        {
+            char *eq = static_cast<char *>(memchr(p, '=', segEnd - p));
+            char *keyEnd = eq ? eq : segEnd;
+            size_t keyLen = Decode(p, keyEnd - p);
+            size_t valueLen = eq ? Decode(eq + 1, segEnd - eq - 1) : 0;
+            fields.emplace_back(std::string_view(p, keyLen), std::string_view(eq ? eq + 1 : segEnd, valueLen));
+        }
+        p = segEnd + 1;
+    }
+}
+
+bool UrlEncoded::Find(const FieldList &fields, std::string_view key, std::string_view &value)
+{
+    for (const Field &field : fields)
+    {
+        if (field.first == key)
+        {
+            value = field.second;
+            return true;
+        }
+    }
+    return false;
+}
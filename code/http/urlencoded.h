@@ -0,0 +1,31 @@
+#ifndef URL_ENCODED_H
+#define URL_ENCODED_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * application/x-www-form-urlencoded 与查询字符串的解码
+ * 在调用方提供的可写内存上原地解码，'+'还原为空格，%XX还原为对应字节，非法的转义原样保留；
+ * 解析结果是指向这块内存的string_view键值对，不产生字符串拷贝。
+ */
+class UrlEncoded
+{
+public:
+    typedef std::pair<std::string_view, std::string_view> Field;
+    typedef std::pmr::vector<Field> FieldList;
+
+    // 原地解码 返回解码后的长度
+    static size_t Decode(char *data, size_t len);
+
+    // 按'&'与'='切分并解码 结果追加到fields 空的片段忽略 没有'='时值为空
+    static void Parse(char *data, size_t len, FieldList &fields);
+
+    // 查找第一个同名字段 找不到返回false
+    static bool Find(const FieldList &fields, std::string_view key, std::string_view &value);
+};
+
+#endif // URL_ENCODED_H
@@ -4,6 +4,7 @@
 #include <mutex>
 #include <deque>
 #include <condition_variable>
+#include <chrono>
 #include <sys/time.h>
 
 template <class T>
@@ -40,6 +41,9 @@ public:
 
     void flush();
 
+    // 等待消费者取空队列 超时返回false
+    bool WaitEmpty(int timeoutMS);
+
 private:
     // 底层数据结构 双端队列
     std::deque<T> deq_;
@@ -162,17 +166,29 @@ bool BlockDeque<T>::full()
     return deq_.size() >= capacity_;
 }
 
+template <class T>
+bool BlockDeque<T>::WaitEmpty(int timeoutMS)
+{
+    // 消费者每取出一个都会通知生产者
+    std::unique_lock<std::mutex> locker(mtx_);
+    return condProducer_.wait_for(locker, std::chrono::milliseconds(timeoutMS),
+                                  [this]
+                                  { return deq_.empty() || isClose_; }) &&
+           deq_.empty();
+}
+
 template <class T>
 bool BlockDeque<T>::pop(T &item)
 {
     std::unique_lock<std::mutex> locker(mtx_);
     while (deq_.empty())
     {
-        condConsumer_.wait(locker);
+        // 先检查再等待 Close发生在消费者等待之前时不会永久阻塞
         if (isClose_)
         {
             return false;
         }
+        condConsumer_.wait(locker);
     }
     item = deq_.front();
     deq_.pop_front();
@@ -1,4 +1,5 @@
 #include "log.h"
+#include "../metrics/probes.h"
 
 using namespace std;
 
@@ -10,27 +11,47 @@ Log::Log()
     deque_ = nullptr;
     toDay_ = 0;
     fp_ = nullptr;
+    isOpen_ = false;
 }
 
 Log::~Log()
 {
+    Close(CLOSE_TIMEOUT_MS);
+}
+
+bool Log::Close(int timeoutMS)
+{
+    size_t dropped = 0;
     if (writeThread_ && writeThread_->joinable())
     {
-        while (!deque_->empty())
+        // 写线程每写一条都会通知 不需要轮询
+        if (!deque_->WaitEmpty(timeoutMS))
         {
-            // 唤醒消费者 处理掉剩下的任务
-            deque_->flush();
-        };
+            dropped = deque_->size();
+        }
         deque_->Close();
         // 等待当前线程执行完毕
         writeThread_->join();
     }
+    lock_guard<mutex> locker(mtx_);
+    isOpen_ = false;
+    isAsync_ = false;
     if (fp_)
     {
-        lock_guard<mutex> locker(mtx_);
-        flush();
+        if (dropped)
+        {
+            fprintf(fp_, "%zu log lines dropped at shutdown\n", dropped);
+        }
+        fflush(fp_);
         fclose(fp_);
+        fp_ = nullptr;
     }
+    return dropped == 0;
+}
+
+size_t Log::QueueSize()
+{
+    return deque_ ? deque_->size() : 0;
 }
 
 int Log::GetLevel()
@@ -48,7 +69,6 @@ void Log::SetLevel(int level)
 void Log::init(int level = 1, const char *path, const char *suffix,
                int maxQueueSize)
 {
-    isOpen_ = true;
     level_ = level;
     if (maxQueueSize > 0)
     {
@@ -84,18 +104,20 @@ void Log::init(int level = 1, const char *path, const char *suffix,
         buff_.RetrieveAll();
         if (fp_)
         {
-            flush();
+            Flush_();
             fclose(fp_);
         }
 
-        fp_ = fopen(fileName, "a");
+        // e: O_CLOEXEC 不泄漏给CGI子进程与热升级的新进程
+        fp_ = fopen(fileName, "ae");
         if (fp_ == nullptr)
         {
             mkdir(path_, 0777);
-            fp_ = fopen(fileName, "a");
+            fp_ = fopen(fileName, "ae");
         }
         assert(fp_ != nullptr);
     }
+    isOpen_ = true;
 }
 
 void Log::write(int level, const char *format, ...)
@@ -103,16 +125,20 @@ void Log::write(int level, const char *format, ...)
     struct timeval now = {0, 0};
     gettimeofday(&now, nullptr);
     time_t tSec = now.tv_sec;
-    struct tm *sysTime = localtime(&tSec);
-    struct tm t = *sysTime;
+    struct tm t;
+    localtime_r(&tSec, &t);
     va_list vaList;
 
+    unique_lock<mutex> locker(mtx_);
+    if (!fp_)
+    {
+        // 已经Close 丢弃
+        return;
+    }
+
     /* 日志日期 日志行数 */
     if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_ % MAX_LINES == 0)))
     {
-        unique_lock<mutex> locker(mtx_);
-        locker.unlock();
-
         char newFile[LOG_NAME_LEN];
         char tail[36] = {0};
         snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
@@ -129,16 +155,14 @@ void Log::write(int level, const char *format, ...)
             snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_ / MAX_LINES), suffix_);
         }
 
-        locker.lock();
-        flush();
+        Flush_();
         fclose(fp_);
-        fp_ = fopen(newFile, "a");
+        fp_ = fopen(newFile, "ae");
         assert(fp_ != nullptr);
     }
 
     // 在buffer内生成一条对应的日志信息
     {
-        unique_lock<mutex> locker(mtx_);
         lineCount_++;
         int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
                          t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
@@ -157,6 +181,7 @@ void Log::write(int level, const char *format, ...)
         if (isAsync_ && deque_ && !deque_->full())
         {
             // 异步方式 加入阻塞队列中 等待写线程读取日志信息
+            WEBSERVER_PROBE2(log_enqueue, level, buff_.ReadableBytes());
             deque_->push_back(buff_.RetrieveAllToStr());
         }
         else
@@ -193,6 +218,16 @@ void Log::AppendLogLevelTitle_(int level)
 
 void Log::flush()
 {
+    lock_guard<mutex> locker(mtx_);
+    Flush_();
+}
+
+void Log::Flush_()
+{
+    if (!fp_)
+    {
+        return;
+    }
     if (isAsync_)
     {
         deque_->flush();
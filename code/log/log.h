@@ -1,6 +1,7 @@
 #ifndef LOG_H
 #define LOG_H
 
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -27,10 +28,17 @@ public:
     // 将输出内容按照标准格式整理
     void write(int level, const char *format, ...);
     void flush();
+    // 等待异步队列写完(最多timeoutMS) 结束写线程并关闭文件 之后的日志被丢弃 返回是否写完
+    bool Close(int timeoutMS);
+
+    // 异步日志队列中等待写入的条数
+    size_t QueueSize();
 
     int GetLevel();
     void SetLevel(int level);
     bool IsOpen() { return isOpen_; }
+    // 异步日志的写线程 同步时为nullptr
+    std::thread *WriteThread() { return writeThread_.get(); }
 
 private:
     Log();
@@ -38,11 +46,14 @@ private:
     virtual ~Log();
     // 异步写日志方法
     void AsyncWrite_();
+    // 持有mtx_时调用 文件已关闭时什么都不做
+    void Flush_();
 
 private:
     static const int LOG_PATH_LEN = 256; // 日志文件最长文件名
     static const int LOG_NAME_LEN = 256; // 日志最长名字
     static const int MAX_LINES = 50000;  // 日志文件内的最长日志条数
+    static const int CLOSE_TIMEOUT_MS = 1000; // 进程退出时等待异步队列写完的时间
 
     const char *path_;   // 路径名
     const char *suffix_; // 后缀名
@@ -52,7 +63,8 @@ private:
     int lineCount_; // 日志行数记录
     int toDay_;     // 按当天日期区分文件
 
-    bool isOpen_;
+    // LOG_BASE在锁外读取 关闭后仍在运行的线程(如文件缓存的监视线程)可能同时写日志 写入前在锁内再检查fp_
+    std::atomic<bool> isOpen_;
 
     Buffer buff_;  // 输出的内容 缓冲区
     int level_;    // 日志等级
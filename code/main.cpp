@@ -1,8 +1,10 @@
 #include "./server/webserver.h"
+#include "./server/master.h"
 #include "./config/config.h"
 
 int main(int argc, char *argv[])
 {
+    Process::Init();
     Config config;
     config.parse_cmd_arg(argc, argv);
 
@@ -15,6 +17,7 @@ int main(int argc, char *argv[])
         std::cout << "Config threadNum is: " << config.threadNum << std::endl;
         std::cout << "Config logLevel is: " << config.logLevel << std::endl;
         std::cout << "Config logQueSize is: " << config.logQueSize << std::endl;
+        std::cout << "Config fileCacheMaxSize is: " << config.fileCacheMaxSize << std::endl;
         std::cout << "work dictionary in \"" << current_path << "\"" << std::endl;
         std::cout << "Resources dictionary in \"" << config.resources_dir << "\"" << std::endl;
         std::cout << "Logs dictionary in \"" << config.logs_dir << "\"" << std::endl;
@@ -23,11 +26,37 @@ int main(int argc, char *argv[])
         return 1;
     }
     
-    WebServer server(config.port, config.timeoutMS, config.connPoolNum,
-                     config.threadNum, config.openLog, config.logLevel, config.logQueSize,
-                     config.resources_dir.c_str(),
-                     config.logs_dir.c_str());
-    server.Start();
+    // 时限等可重新加载的配置由各处从快照读取 收到SIGHUP后替换
+    Config::publish(std::make_shared<const Config>(config));
+
+    auto run = []()
+    {
+        // master重新加载过配置时 之后重启的worker使用新配置中可重新加载的部分 其余仍是master启动时的值
+        // 服务器运行期间持有启动时的快照
+        std::shared_ptr<const Config> config = Config::snapshot();
+        WebServer server(config->port, config->connPoolNum,
+                         config->threadNum, config->openLog, config->logLevel, config->logQueSize,
+                         config->resources_dir.c_str(),
+                         config->logs_dir.c_str(),
+                         config->fileCacheMaxSize, config->fileCacheCapacity,
+                         config->maxConnections, config->maxQueue, config->queueTargetMS,
+                         config->connRateLimit, config->connRateBurst,
+                         config->requestRateLimit, config->requestRateBurst, config->rateLimitClients,
+                         config->reactorCpus, config->threadPoolCpus, config->logCpus);
+        server.Start();
+    };
+
+    if (config.workerProcesses != 0)
+    {
+        // master只写自己的日志文件 同步写入 fork时没有写线程
+        if (config.openLog)
+        {
+            Log::Instance()->init(config.logLevel, config.logs_dir.c_str(), "-master.log", 0);
+        }
+        Master master(config.port, config.workerProcesses, config.workerCpus, config.incomingCpu);
+        return master.Run(run);
+    }
+    run();
 
     return 0;
 }
@@ -0,0 +1,207 @@
+#include "flightrecorder.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+using namespace std;
+
+static const char *SPAN_NAMES[FlightRecorder::SPAN_COUNT] = {"read", "parse", "handle", "build", "write"};
+
+void FlightRecorder::Record::SetRequest(string_view m, string_view p)
+{
+    size_t len = min(m.size(), sizeof(method) - 1);
+    memcpy(method, m.data(), len);
+    method[len] = '\0';
+    len = min(p.size(), sizeof(path) - 1);
+    memcpy(path, p.data(), len);
+    path[len] = '\0';
+}
+
+uint64_t FlightRecorder::Record::End() const
+{
+    uint64_t end = start;
+    for (size_t i = 0; i < SPAN_COUNT; i++)
+    {
+        end = max(end, spans[i][1]);
+    }
+    return end;
+}
+
+FlightRecorder *FlightRecorder::Instance()
+{
+    // 不析构 其他单例的线程在静态对象析构期间退出时仍要归还环
+    static FlightRecorder *recorder = new FlightRecorder();
+    return recorder;
+}
+
+thread_local FlightRecorder::Ring *FlightRecorder::local_ = nullptr;
+thread_local FlightRecorder::LocalHolder FlightRecorder::holder_;
+
+FlightRecorder::LocalHolder::~LocalHolder()
+{
+    if (local_)
+    {
+        FlightRecorder *recorder = Instance();
+        lock_guard<mutex> locker(recorder->mtx_);
+        recorder->free_.push_back(local_);
+        local_ = nullptr;
+    }
+}
+
+FlightRecorder::Ring &FlightRecorder::Local_()
+{
+    if (local_ == nullptr)
+    {
+        FlightRecorder *recorder = Instance();
+        {
+            lock_guard<mutex> locker(recorder->mtx_);
+            if (!recorder->free_.empty())
+            {
+                local_ = recorder->free_.back();
+                recorder->free_.pop_back();
+            }
+            else
+            {
+                recorder->rings_.emplace_back(new Ring());
+                local_ = recorder->rings_.back().get();
+                local_->index = (int)recorder->rings_.size() - 1;
+            }
+        }
+        // 线程退出时析构 归还环
+        (void)&holder_;
+    }
+    return *local_;
+}
+
+void FlightRecorder::Commit(const Record &record)
+{
+    Ring &ring = Local_();
+    Slot &slot = ring.slots[ring.head++ & (RING_SIZE - 1)];
+    // seqlock 先置为奇数 读者看到奇数或前后序号不同时丢弃该槽位
+    uint32_t seq = slot.seq.load(memory_order_relaxed);
+    slot.seq.store(seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot.record = record;
+    slot.record.thread = ring.index;
+    slot.seq.store(seq + 2, memory_order_release);
+}
+
+void FlightRecorder::Slowest(size_t n, vector<Record> &out)
+{
+    out.clear();
+    lock_guard<mutex> locker(mtx_);
+    for (const auto &ring : rings_)
+    {
+        for (const Slot &slot : ring->slots)
+        {
+            uint32_t seq = slot.seq.load(memory_order_acquire);
+            if (seq == 0 || (seq & 1))
+            {
+                continue;
+            }
+            Record record = slot.record;
+            atomic_thread_fence(memory_order_acquire);
+            if (slot.seq.load(memory_order_relaxed) != seq)
+            {
+                continue; // 读取期间被改写
+            }
+            out.push_back(record);
+        }
+    }
+
+    auto slower = [](const Record &a, const Record &b)
+    { return a.End() - a.start > b.End() - b.start; };
+    n = min(n, out.size());
+    partial_sort(out.begin(), out.begin() + n, out.end(), slower);
+    out.resize(n);
+}
+
+void FlightRecorder::RenderSlowest(size_t n, string &out)
+{
+    vector<Record> records;
+    Slowest(n, records);
+
+    char line[256];
+    snprintf(line, sizeof(line), "%10s %10s %10s %10s %10s %10s %4s %6s  %s\n", "total(us)", "read", "parse",
+             "handle", "build", "write", "code", "thread", "request");
+    out += line;
+    for (const Record &r : records)
+    {
+        snprintf(line, sizeof(line), "%10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %4d %6d  %s %s\n",
+                 (r.End() - r.start) / 1e3, r.Duration(SPAN_READ) / 1e3, r.Duration(SPAN_PARSE) / 1e3,
+                 r.Duration(SPAN_HANDLE) / 1e3, r.Duration(SPAN_BUILD) / 1e3, r.Duration(SPAN_WRITE) / 1e3, r.code,
+                 r.thread, r.method, r.path);
+        out += line;
+    }
+}
+
+// JSON字符串转义 路径来自客户端
+static void AppendJsonString(string &out, const char *str)
+{
+    out += '"';
+    for (; *str; str++)
+    {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void FlightRecorder::RenderTrace(size_t n, string &out)
+{
+    vector<Record> records;
+    Slowest(n, records);
+
+    // 时间戳相对最早的请求 单位微秒
+    uint64_t base = UINT64_MAX;
+    for (const Record &r : records)
+    {
+        base = min(base, r.start);
+    }
+
+    char event[256];
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const Record &r : records)
+    {
+        // 整个请求为父事件 名称为方法与路径
+        snprintf(event, sizeof(event), "%s{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"cat\":\"request\",\"name\":",
+                 first ? "" : ",", r.thread, (r.start - base) / 1e3, (r.End() - r.start) / 1e3);
+        out += event;
+        first = false;
+        string name = r.method;
+        name += ' ';
+        name += r.path;
+        AppendJsonString(out, name.c_str());
+        snprintf(event, sizeof(event), ",\"args\":{\"code\":%d}}", r.code);
+        out += event;
+
+        for (size_t i = 0; i < SPAN_COUNT; i++)
+        {
+            if (r.spans[i][1] == 0)
+            {
+                continue;
+            }
+            snprintf(event, sizeof(event),
+                     ",{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"cat\":\"stage\",\"name\":\"%s\"}",
+                     r.thread, (r.spans[i][0] - base) / 1e3, (r.spans[i][1] - r.spans[i][0]) / 1e3, SPAN_NAMES[i]);
+            out += event;
+        }
+    }
+    out += "]}\n";
+}
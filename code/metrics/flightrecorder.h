@@ -0,0 +1,96 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * 请求追踪的飞行记录器
+ * 每个请求记录各阶段的起止时间，请求结束时写入当前线程的环形缓冲区，旧记录被覆盖。
+ * 每个线程只写自己的环：槽位用序号做seqlock，写入时没有锁，读取时跳过正在被改写的槽位。
+ * 按需(管理接口或信号)汇总所有线程的记录，输出最慢的N个请求的阶段分解，或Chrome trace JSON
+ * (chrome://tracing 或 https://ui.perfetto.dev 打开)。
+ */
+class FlightRecorder
+{
+public:
+    // 请求经历的阶段 依次发生 没有经历的阶段起止为0
+    enum Span
+    {
+        SPAN_READ,   // 收到第一批数据到最后一次解析开始 主要是等待数据
+        SPAN_PARSE,  // 解析请求的累计耗时 记在请求完整之前
+        SPAN_HANDLE, // 进程内处理函数或启动CGI
+        SPAN_BUILD,  // 生成响应报文
+        SPAN_WRITE,  // 响应生成到全部写出
+        SPAN_COUNT,
+    };
+
+    struct Record
+    {
+        uint64_t start; // 单调时钟 纳秒
+        uint64_t spans[SPAN_COUNT][2];
+        int code;
+        int thread; // 写入的环的序号 由Commit填写 线程退出后环由新线程继续使用
+        char method[8];
+        char path[64]; // 超长时截断
+
+        // 复制方法与路径 超长时截断
+        void SetRequest(std::string_view method, std::string_view path);
+        uint64_t End() const;
+        uint64_t Duration(Span span) const { return spans[span][1] - spans[span][0]; }
+    };
+
+    static FlightRecorder *Instance();
+
+    // 请求结束时在工作线程调用 只写当前线程的环
+    static void Commit(const Record &record);
+
+    // 最慢的n个请求 按总耗时降序
+    void Slowest(size_t n, std::vector<Record> &out);
+
+    // 最慢的n个请求的阶段分解 文本表格
+    void RenderSlowest(size_t n, std::string &out);
+    // 最慢的n个请求 Chrome trace JSON 每个请求一行 阶段为其子事件
+    void RenderTrace(size_t n, std::string &out);
+
+    static const size_t RING_SIZE = 1024; // 每个线程保留的记录数 2的幂
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> seq{0}; // 奇数表示正在写入 0表示从未写入
+        Record record;
+    };
+
+    struct alignas(64) Ring
+    {
+        uint64_t head = 0; // 只由所属线程访问
+        int index = 0;
+        Slot slots[RING_SIZE];
+    };
+
+    // 线程退出时归还环
+    struct LocalHolder
+    {
+        ~LocalHolder();
+    };
+
+    FlightRecorder() = default;
+
+    static Ring &Local_();
+    static thread_local Ring *local_; // 当前线程的环
+    static thread_local LocalHolder holder_;
+
+    std::mutex mtx_; // 保护rings_与free_ 只在线程第一次记录、退出和导出时加锁
+    std::vector<std::unique_ptr<Ring>> rings_;
+    // 已退出线程的环 保留其中的记录 新线程优先取用并接着写 环数不超过同时存在的线程数
+    std::vector<Ring *> free_;
+};
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,447 @@
+#include "metrics.h"
+#include "../http/router.h"
+#include "../log/log.h"
+
+#include <algorithm>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+// 0表示未使用的槽位
+const int Metrics::STATUS_CODES[STATUS_SLOTS - 1] = {200, 304, 400, 403, 404, 405, 408, 413, 429, 431, 500, 503};
+
+const uint64_t Metrics::BUCKET_BOUNDS[BUCKET_COUNT] = {
+    10000, 25000, 50000,                // 10us ~ 50us
+    100000, 250000, 500000,             // 100us ~ 500us
+    1000000, 2500000, 5000000,          // 1ms ~ 5ms
+    10000000, 25000000, 50000000,       // 10ms ~ 50ms
+    100000000, 250000000, 500000000,    // 100ms ~ 500ms
+    1000000000, 2500000000, 5000000000, // 1s ~ 5s
+    10000000000,
+};
+
+static const char *STAGE_NAMES[Metrics::STAGE_COUNT] = {"read", "parse", "build", "write"};
+static const char *SHED_NAMES[Metrics::SHED_COUNT] = {"connection_limit", "queue_full", "overload", "queue_delay"};
+static const char *LIMIT_NAMES[Metrics::LIMIT_COUNT] = {"connection", "request"};
+static const char *TIMEOUT_NAMES[Metrics::TIMEOUT_COUNT] = {"idle", "header", "body", "write"};
+
+Metrics *Metrics::Instance()
+{
+    // 不析构 其他单例的线程在静态对象析构期间退出时仍要归还分片
+    static Metrics *metrics = new Metrics();
+    return metrics;
+}
+
+thread_local Metrics::Shard *Metrics::local_ = nullptr;
+thread_local Metrics::LocalHolder Metrics::holder_;
+
+Metrics::LocalHolder::~LocalHolder()
+{
+    if (local_)
+    {
+        Instance()->Release_(local_);
+        local_ = nullptr;
+    }
+}
+
+Metrics::Shard &Metrics::Local_()
+{
+    if (local_ == nullptr)
+    {
+        Metrics *metrics = Instance();
+        bool exhausted = false;
+        {
+            lock_guard<mutex> locker(metrics->mtx_);
+            if (!metrics->free_.empty())
+            {
+                local_ = metrics->free_.back();
+                metrics->free_.pop_back();
+            }
+            else if (metrics->shared_)
+            {
+                local_ = metrics->Claim_(getpid());
+            }
+            if (local_ == nullptr)
+            {
+                exhausted = metrics->shared_ && !metrics->exhausted_;
+                metrics->exhausted_ = metrics->exhausted_ || exhausted;
+                metrics->shards_.emplace_back(new Shard());
+                local_ = metrics->shards_.back().get();
+            }
+        }
+        if (exhausted)
+        {
+            LOG_WARN("Metrics: all %zu shared shards in use, counters of new threads in pid %d are not exported",
+                     SHARED_SHARDS, (int)getpid());
+        }
+        // 线程退出时析构 归还分片
+        (void)&holder_;
+    }
+    return *local_;
+}
+
+void Metrics::Release_(Shard *shard)
+{
+    lock_guard<mutex> locker(mtx_);
+    if (!IsShared_(shard))
+    {
+        // 线程已退出 分片没有其他写者
+        Merge_(retired_, *shard);
+        shard->~Shard();
+        new (shard) Shard();
+    }
+    free_.push_back(shard);
+}
+
+Metrics::Shard *Metrics::Claim_(pid_t pid)
+{
+    while (true)
+    {
+        // 先重新领取退出进程留下的分片 计数器只增不减 在原值上继续累加
+        size_t used = min(sharedUsed_->load(memory_order_relaxed), SHARED_SHARDS);
+        for (size_t i = 0; i < used; i++)
+        {
+            pid_t idle = 0;
+            if (shared_[i].pid.compare_exchange_strong(idle, pid, memory_order_acquire, memory_order_relaxed))
+            {
+                return &shared_[i];
+            }
+        }
+        // 新分片在mmap的零页上 全部计数为0 同样以CAS领取 其他进程可能在扫描时抢先拿到
+        size_t i = sharedUsed_->fetch_add(1, memory_order_relaxed);
+        if (i >= SHARED_SHARDS)
+        {
+            return nullptr;
+        }
+        pid_t idle = 0;
+        if (shared_[i].pid.compare_exchange_strong(idle, pid, memory_order_acquire, memory_order_relaxed))
+        {
+            return &shared_[i];
+        }
+    }
+}
+
+size_t Metrics::StatusIndex_(int code)
+{
+    for (size_t i = 0; i < STATUS_SLOTS - 1 && STATUS_CODES[i]; i++)
+    {
+        if (STATUS_CODES[i] == code)
+        {
+            return i;
+        }
+    }
+    return STATUS_SLOTS - 1;
+}
+
+uint64_t Metrics::NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void Metrics::CountRequest(size_t route, int code)
+{
+    Local_().requests[route < MAX_ROUTES ? route : 0][StatusIndex_(code)].Add(1);
+}
+
+void Metrics::AddBytesIn(size_t bytes)
+{
+    Local_().bytesIn.Add(bytes);
+}
+
+void Metrics::AddBytesOut(size_t bytes)
+{
+    Local_().bytesOut.Add(bytes);
+}
+
+void Metrics::ConnOpened()
+{
+    Local_().connOpened.Add(1);
+}
+
+void Metrics::ConnClosed(bool active)
+{
+    Shard &shard = Local_();
+    shard.connClosed.Add(1);
+    if (active)
+    {
+        shard.closedActive.Add(1);
+    }
+}
+
+void Metrics::ConnActive(bool active)
+{
+    Shard &shard = Local_();
+    (active ? shard.connActivated : shard.connDeactivated).Add(1);
+}
+
+void Metrics::Observe(Stage stage, uint64_t ns)
+{
+    Histogram &hist = Local_().stages[stage];
+    size_t i = 0;
+    while (i < BUCKET_COUNT && ns > BUCKET_BOUNDS[i])
+    {
+        i++;
+    }
+    hist.buckets[i].Add(1);
+    hist.sum.Add(ns);
+}
+
+void Metrics::Shed(ShedReason reason)
+{
+    Local_().shed[reason].Add(1);
+}
+
+void Metrics::RateLimited(LimitScope scope)
+{
+    Local_().limited[scope].Add(1);
+}
+
+void Metrics::Timeout(TimeoutPhase phase)
+{
+    Local_().timeouts[phase].Add(1);
+}
+
+void Metrics::WorkerRestarted()
+{
+    Local_().workerRestarts.Add(1);
+}
+
+bool Metrics::Share()
+{
+    lock_guard<mutex> locker(mtx_);
+    if (shared_)
+    {
+        return true;
+    }
+    // 第一个缓存行放领取计数 之后是分片 只有被领取的分片占用物理内存
+    size_t size = 64 + sizeof(Shard) * SHARED_SHARDS;
+    void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+    {
+        return false;
+    }
+    sharedUsed_ = new (mem) atomic<size_t>(0);
+    shared_ = (Shard *)((char *)mem + 64);
+    // fork出的子进程继承了fork线程的分片指针与空闲列表 共享内存中的分片仍属于父进程 重新领取 否则与父进程写同一个分片
+    pthread_atfork(nullptr, nullptr, []
+                   {
+                       local_ = nullptr;
+                       Metrics *metrics = Instance();
+                       auto shared = [metrics](const Shard *shard) { return metrics->IsShared_(shard); };
+                       metrics->free_.erase(remove_if(metrics->free_.begin(), metrics->free_.end(), shared),
+                                            metrics->free_.end()); });
+    return true;
+}
+
+void Metrics::Retire(pid_t pid)
+{
+    if (shared_ == nullptr)
+    {
+        return;
+    }
+    size_t used = min(sharedUsed_->load(memory_order_relaxed), SHARED_SHARDS);
+    for (size_t i = 0; i < used; i++)
+    {
+        // 进程已经退出 它的分片没有其他写者
+        Shard &shard = shared_[i];
+        if (shard.pid.load(memory_order_relaxed) != pid)
+        {
+            continue;
+        }
+        shard.connClosed.Add(shard.connOpened.Get() - shard.connClosed.Get());
+        int64_t active = shard.connActivated.Get() - shard.connDeactivated.Get() - shard.closedActive.Get();
+        shard.closedActive.Add(max<int64_t>(active, 0));
+        // 之后领取的进程在这些计数上继续累加
+        shard.pid.store(0, memory_order_release);
+    }
+}
+
+void Metrics::AddGauge(const string &name, const string &help, function<double()> fn)
+{
+    lock_guard<mutex> locker(mtx_);
+    gauges_.push_back({name, help, move(fn)});
+}
+
+void Metrics::Merge_(Shard &into, const Shard &from)
+{
+    for (size_t r = 0; r < MAX_ROUTES; r++)
+    {
+        for (size_t c = 0; c < STATUS_SLOTS; c++)
+        {
+            into.requests[r][c].Add(from.requests[r][c].Get());
+        }
+    }
+    into.bytesIn.Add(from.bytesIn.Get());
+    into.bytesOut.Add(from.bytesOut.Get());
+    into.connOpened.Add(from.connOpened.Get());
+    into.connClosed.Add(from.connClosed.Get());
+    into.connActivated.Add(from.connActivated.Get());
+    into.connDeactivated.Add(from.connDeactivated.Get());
+    into.closedActive.Add(from.closedActive.Get());
+    for (size_t s = 0; s < STAGE_COUNT; s++)
+    {
+        for (size_t b = 0; b <= BUCKET_COUNT; b++)
+        {
+            into.stages[s].buckets[b].Add(from.stages[s].buckets[b].Get());
+        }
+        into.stages[s].sum.Add(from.stages[s].sum.Get());
+    }
+    for (size_t r = 0; r < SHED_COUNT; r++)
+    {
+        into.shed[r].Add(from.shed[r].Get());
+    }
+    for (size_t l = 0; l < LIMIT_COUNT; l++)
+    {
+        into.limited[l].Add(from.limited[l].Get());
+    }
+    for (size_t t = 0; t < TIMEOUT_COUNT; t++)
+    {
+        into.timeouts[t].Add(from.timeouts[t].Get());
+    }
+    into.workerRestarts.Add(from.workerRestarts.Get());
+}
+
+void Metrics::Render(string &out)
+{
+    // 汇总分片 计数器只增不减 读到的是某一时刻附近的值
+    lock_guard<mutex> locker(mtx_);
+    vector<const Shard *> all;
+    size_t used = shared_ ? min(sharedUsed_->load(memory_order_relaxed), SHARED_SHARDS) : 0;
+    for (size_t i = 0; i < used; i++)
+    {
+        all.push_back(&shared_[i]);
+    }
+    for (const auto &shard : shards_)
+    {
+        all.push_back(shard.get());
+    }
+    Shard sum;
+    Merge_(sum, retired_);
+    for (const Shard *shard : all)
+    {
+        Merge_(sum, *shard);
+    }
+
+    char line[1024];
+    const Router *router = Router::Instance();
+    out += "# HELP webserver_requests_total Requests answered, by route and status code.\n"
+           "# TYPE webserver_requests_total counter\n";
+    for (size_t r = 0; r < MAX_ROUTES; r++)
+    {
+        for (size_t c = 0; c < STATUS_SLOTS; c++)
+        {
+            uint64_t count = sum.requests[r][c].Get();
+            if (count == 0)
+            {
+                continue;
+            }
+            // 路由id+1为槽位 0为静态文件
+            bool routed = r > 0 && r <= router->Size();
+            const char *method = routed ? router->RouteAt(r - 1).method.c_str() : "*";
+            const char *pattern = routed ? router->RouteAt(r - 1).pattern.c_str() : "static";
+            char code[8] = "other";
+            if (c < STATUS_SLOTS - 1)
+            {
+                snprintf(code, sizeof(code), "%d", STATUS_CODES[c]);
+            }
+            snprintf(line, sizeof(line), "webserver_requests_total{method=\"%s\",route=\"%s\",code=\"%s\"} %llu\n",
+                     method, pattern, code, (unsigned long long)count);
+            out += line;
+        }
+    }
+
+    // 各分片读取的时刻不同 差值可能短暂为负
+    int64_t open = max<int64_t>(0, sum.connOpened.Get() - sum.connClosed.Get());
+    int64_t active = sum.connActivated.Get() - sum.connDeactivated.Get() - sum.closedActive.Get();
+    active = min(max<int64_t>(0, active), open);
+    snprintf(line, sizeof(line),
+             "# HELP webserver_connections_opened_total Connections accepted.\n"
+             "# TYPE webserver_connections_opened_total counter\n"
+             "webserver_connections_opened_total %llu\n"
+             "# HELP webserver_connections Open connections, by whether a request is in progress.\n"
+             "# TYPE webserver_connections gauge\n"
+             "webserver_connections{state=\"active\"} %llu\n"
+             "webserver_connections{state=\"idle\"} %llu\n"
+             "# HELP webserver_received_bytes_total Bytes read from clients.\n"
+             "# TYPE webserver_received_bytes_total counter\n"
+             "webserver_received_bytes_total %llu\n"
+             "# HELP webserver_sent_bytes_total Bytes written to clients.\n"
+             "# TYPE webserver_sent_bytes_total counter\n"
+             "webserver_sent_bytes_total %llu\n",
+             (unsigned long long)sum.connOpened.Get(), (unsigned long long)active,
+             (unsigned long long)(open - active), (unsigned long long)sum.bytesIn.Get(),
+             (unsigned long long)sum.bytesOut.Get());
+    out += line;
+
+    out += "# HELP webserver_stage_duration_seconds Time spent in each request processing stage.\n"
+           "# TYPE webserver_stage_duration_seconds histogram\n";
+    for (size_t s = 0; s < STAGE_COUNT; s++)
+    {
+        // Prometheus的桶是累计的
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b <= BUCKET_COUNT; b++)
+        {
+            cumulative += sum.stages[s].buckets[b].Get();
+            char le[32] = "+Inf";
+            if (b < BUCKET_COUNT)
+            {
+                snprintf(le, sizeof(le), "%g", BUCKET_BOUNDS[b] / 1e9);
+            }
+            snprintf(line, sizeof(line), "webserver_stage_duration_seconds_bucket{stage=\"%s\",le=\"%s\"} %llu\n",
+                     STAGE_NAMES[s], le, (unsigned long long)cumulative);
+            out += line;
+        }
+        snprintf(line, sizeof(line),
+                 "webserver_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n"
+                 "webserver_stage_duration_seconds_count{stage=\"%s\"} %llu\n",
+                 STAGE_NAMES[s], sum.stages[s].sum.Get() / 1e9, STAGE_NAMES[s], (unsigned long long)cumulative);
+        out += line;
+    }
+
+    out += "# HELP webserver_shed_total Connections rejected with 503 by admission control, by reason.\n"
+           "# TYPE webserver_shed_total counter\n";
+    for (size_t r = 0; r < SHED_COUNT; r++)
+    {
+        snprintf(line, sizeof(line), "webserver_shed_total{reason=\"%s\"} %llu\n", SHED_NAMES[r],
+                 (unsigned long long)sum.shed[r].Get());
+        out += line;
+    }
+
+    out += "# HELP webserver_rate_limited_total Connections and requests rejected with 429 by the per-client rate limit.\n"
+           "# TYPE webserver_rate_limited_total counter\n";
+    for (size_t l = 0; l < LIMIT_COUNT; l++)
+    {
+        snprintf(line, sizeof(line), "webserver_rate_limited_total{scope=\"%s\"} %llu\n", LIMIT_NAMES[l],
+                 (unsigned long long)sum.limited[l].Get());
+        out += line;
+    }
+
+    out += "# HELP webserver_timeouts_total Connections closed by a read or write deadline, by phase.\n"
+           "# TYPE webserver_timeouts_total counter\n";
+    for (size_t t = 0; t < TIMEOUT_COUNT; t++)
+    {
+        snprintf(line, sizeof(line), "webserver_timeouts_total{phase=\"%s\"} %llu\n", TIMEOUT_NAMES[t],
+                 (unsigned long long)sum.timeouts[t].Get());
+        out += line;
+    }
+
+    snprintf(line, sizeof(line),
+             "# HELP webserver_worker_restarts_total Worker processes restarted by the master after exiting.\n"
+             "# TYPE webserver_worker_restarts_total counter\n"
+             "webserver_worker_restarts_total %llu\n",
+             (unsigned long long)sum.workerRestarts.Get());
+    out += line;
+
+    for (const Gauge &gauge : gauges_)
+    {
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s gauge\n%s %g\n", gauge.name.c_str(), gauge.help.c_str(),
+                 gauge.name.c_str(), gauge.name.c_str(), gauge.fn());
+        out += line;
+    }
+}
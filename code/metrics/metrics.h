@@ -0,0 +1,177 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+/**
+ * 运行时指标
+ * 计数器和直方图按线程分片，每个线程只写自己的分片：单写者用relaxed的load+store累加，
+ * 没有锁、没有原子读改写、分片之间不共享缓存行，热路径上只有几次普通的内存写。
+ * 抓取(/metrics)时汇总所有分片，连同抓取时才求值的回调(如队列长度)一起输出为Prometheus文本格式。
+ * 线程退出后分片保留，计数不丢失。
+ * 多进程模式下master在fork前映射共享内存，之后各进程新线程的分片都从中领取，
+ * 任一worker抓取时汇总所有进程的计数器与直方图；回调指标(队列长度等)仍是当前进程的值。
+ */
+class Metrics
+{
+public:
+    // 请求处理的阶段
+    enum Stage
+    {
+        STAGE_READ,  // 收到请求的第一批数据到请求完整(含解析)
+        STAGE_PARSE, // 解析请求的CPU时间
+        STAGE_BUILD, // 生成响应
+        STAGE_WRITE, // 响应生成到全部写出
+        STAGE_COUNT,
+    };
+
+    // 准入控制拒绝连接的原因
+    enum ShedReason
+    {
+        SHED_CONNECTIONS, // 连接数达到上限
+        SHED_QUEUE_FULL,  // 等待线程的连接数达到上限
+        SHED_OVERLOAD,    // 持续过载且仍有积压 新连接直接拒绝
+        SHED_QUEUE_DELAY, // 排队超时 取出时拒绝
+        SHED_COUNT,
+    };
+
+    // 按客户端地址限速拒绝的对象
+    enum LimitScope
+    {
+        LIMIT_CONNECTION, // 新连接 返回429后关闭
+        LIMIT_REQUEST,    // 连接上的请求 返回429后关闭
+        LIMIT_COUNT,
+    };
+
+    // 因超时关闭连接时所处的阶段
+    enum TimeoutPhase
+    {
+        TIMEOUT_IDLE,   // 新连接或keep-alive连接没有发送请求
+        TIMEOUT_HEADER, // 请求头没有在时限内收完 返回408
+        TIMEOUT_BODY,   // 请求体低于最低速率 返回408
+        TIMEOUT_WRITE,  // 客户端长时间不接收响应
+        TIMEOUT_COUNT,
+    };
+
+    static Metrics *Instance();
+
+    // 以下在热路径上调用 只写当前线程的分片
+    // route为路由的id+1 0表示没有匹配路由的静态文件请求
+    static void CountRequest(size_t route, int code);
+    static void AddBytesIn(size_t bytes);
+    static void AddBytesOut(size_t bytes);
+    static void ConnOpened();
+    static void ConnClosed(bool active);
+    // 连接在空闲与处理请求之间切换
+    static void ConnActive(bool active);
+    static void Observe(Stage stage, uint64_t ns);
+    static void Shed(ShedReason reason);
+    static void RateLimited(LimitScope scope);
+    static void Timeout(TimeoutPhase phase);
+    // master重新启动了退出的worker
+    static void WorkerRestarted();
+
+    // 单调时钟 纳秒
+    static uint64_t NowNs();
+
+    // 抓取时求值的指标 如线程池队列长度 启动时注册
+    void AddGauge(const std::string &name, const std::string &help, std::function<double()> fn);
+
+    // 汇总所有分片 追加Prometheus文本到out
+    void Render(std::string &out);
+
+    // 多进程模式 master在fork worker之前调用 之后新线程的分片分配在共享内存中
+    bool Share();
+    // master回收退出的worker后调用 它的连接已经全部断开 计为已关闭
+    void Retire(pid_t pid);
+
+    static const size_t MAX_ROUTES = 64; // 超出的路由计入0号
+    static const size_t BUCKET_COUNT = 19;
+    static const size_t SHARED_SHARDS = 1024; // 共享内存中的分片数 退出进程的分片可重新领取 仍不够时新线程的分片只有本进程可见
+
+private:
+    // 单写者计数器 写线程load+store 抓取线程只读
+    struct Counter
+    {
+        std::atomic<uint64_t> value{0};
+
+        void Add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+        uint64_t Get() const { return value.load(std::memory_order_relaxed); }
+    };
+
+    struct Histogram
+    {
+        Counter buckets[BUCKET_COUNT + 1]; // 最后一个为+Inf
+        Counter sum;                       // 纳秒
+    };
+
+    // 状态码 -> 下标 不在表中的计入最后一个
+    static const size_t STATUS_SLOTS = 16;
+    static const int STATUS_CODES[STATUS_SLOTS - 1];
+
+    struct alignas(64) Shard
+    {
+        Counter requests[MAX_ROUTES][STATUS_SLOTS];
+        Counter bytesIn;
+        Counter bytesOut;
+        Counter connOpened;
+        Counter connClosed;
+        Counter connActivated;   // 进入处理状态的次数
+        Counter connDeactivated; // 回到空闲的次数 活跃连接数为两者之差
+        Counter closedActive;    // 在处理中关闭的连接
+        Histogram stages[STAGE_COUNT];
+        Counter shed[SHED_COUNT];
+        Counter limited[LIMIT_COUNT];
+        Counter timeouts[TIMEOUT_COUNT];
+        Counter workerRestarts;
+        std::atomic<pid_t> pid{0}; // 领取分片的进程 0表示空闲 进程退出后由master清零
+    };
+
+    struct Gauge
+    {
+        std::string name;
+        std::string help;
+        std::function<double()> fn;
+    };
+
+    Metrics() = default;
+
+    // 线程退出时归还分片
+    struct LocalHolder
+    {
+        ~LocalHolder();
+    };
+
+    static Shard &Local_();
+    // 从共享内存领取分片 用完时返回nullptr
+    Shard *Claim_(pid_t pid);
+    // 线程退出 本进程私有的分片计数并入retired_后清零 共享内存中的分片保留计数 都放入空闲列表
+    void Release_(Shard *shard);
+    bool IsShared_(const Shard *shard) const { return shared_ && shard >= shared_ && shard < shared_ + SHARED_SHARDS; }
+    static void Merge_(Shard &into, const Shard &from);
+    static thread_local Shard *local_; // 当前线程的分片
+    static thread_local LocalHolder holder_;
+    static size_t StatusIndex_(int code);
+
+    std::mutex mtx_; // 保护shards_、free_、retired_与gauges_ 只在线程第一次记录、退出和抓取时加锁
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<Shard *> free_; // 已退出线程的分片 新线程优先取用 分片数不超过同时存在的线程数
+    Shard retired_;             // 已退出线程的私有分片的累计
+    std::vector<Gauge> gauges_;
+    // 共享内存 fork后各进程映射到同一块 已领取的数量跨进程原子递增
+    Shard *shared_ = nullptr;
+    std::atomic<size_t> *sharedUsed_ = nullptr;
+    bool exhausted_ = false; // 已经记录过共享分片用完
+
+    static const uint64_t BUCKET_BOUNDS[BUCKET_COUNT]; // 纳秒
+};
+
+#endif // METRICS_H
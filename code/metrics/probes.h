@@ -0,0 +1,97 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <type_traits>
+
+/**
+ * USDT静态探针 provider为webserver
+ * 每个探针编译为一条nop，并在.note.stapsdt段中记录探针的地址和参数位置，
+ * perf/bpftrace按名字挂载(usdt:./server:webserver:<name>)，挂载时把nop替换为断点，不挂载时只有一条nop。
+ * 有<sys/sdt.h>(systemtap-sdt-dev)时直接使用，否则在x86-64/aarch64的GCC/Clang上生成同样格式的注释段，
+ * 两者都只是头文件，运行时不依赖任何库。定义NO_USDT_PROBES(cmake -DUSDT_PROBES=OFF)时探针为空。
+ * 参数为整数或指针，最多4个。查看二进制中的探针：readelf -n bin/server 或 bpftrace -l 'usdt:bin/server:*'
+ */
+
+#if defined(NO_USDT_PROBES)
+
+#define WEBSERVER_PROBE0(name) \
+    do                         \
+    {                          \
+    } while (0)
+#define WEBSERVER_PROBE1(name, a1) WEBSERVER_PROBE0(name)
+#define WEBSERVER_PROBE2(name, a1, a2) WEBSERVER_PROBE0(name)
+#define WEBSERVER_PROBE3(name, a1, a2, a3) WEBSERVER_PROBE0(name)
+#define WEBSERVER_PROBE4(name, a1, a2, a3, a4) WEBSERVER_PROBE0(name)
+
+#elif __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+
+#define WEBSERVER_PROBE0(name) DTRACE_PROBE(webserver, name)
+#define WEBSERVER_PROBE1(name, a1) DTRACE_PROBE1(webserver, name, a1)
+#define WEBSERVER_PROBE2(name, a1, a2) DTRACE_PROBE2(webserver, name, a1, a2)
+#define WEBSERVER_PROBE3(name, a1, a2, a3) DTRACE_PROBE3(webserver, name, a1, a2, a3)
+#define WEBSERVER_PROBE4(name, a1, a2, a3, a4) DTRACE_PROBE4(webserver, name, a1, a2, a3, a4)
+
+#elif (defined(__x86_64__) || defined(__aarch64__)) && defined(__GNUC__)
+
+// 参数描述 "大小@位置" 有符号时大小为负 位置由编译器选择(寄存器、内存或立即数) 数组按指针传递
+#define WS_SDT_TYPE(x) std::decay_t<decltype(x)>
+#define WS_SDT_SIZE(x) \
+    (std::is_signed<WS_SDT_TYPE(x)>::value ? -(int)sizeof(WS_SDT_TYPE(x)) : (int)sizeof(WS_SDT_TYPE(x)))
+#define WS_SDT_ARG(n) "%c[s" #n "]@%[a" #n "]"
+#define WS_SDT_OPERAND(n, x) [s##n] "n"(WS_SDT_SIZE(x)), [a##n] "nor"((WS_SDT_TYPE(x))(x))
+
+// 与sys/sdt.h相同的注释格式: 探针地址 基准地址 信号量(未使用) provider 名字 参数
+#define WS_SDT_PROBE(name, args, ...)                                                  \
+    __asm__ __volatile__("990: nop\n"                                                  \
+                         ".pushsection .note.stapsdt,\"?\",\"note\"\n"                  \
+                         ".balign 4\n"                                                  \
+                         ".4byte 992f-991f, 994f-993f, 3\n"                             \
+                         "991: .asciz \"stapsdt\"\n"                                    \
+                         "992: .balign 4\n"                                             \
+                         "993: .8byte 990b\n"                                           \
+                         ".8byte _.stapsdt.base\n"                                      \
+                         ".8byte 0\n"                                                   \
+                         ".asciz \"webserver\"\n"                                       \
+                         ".asciz \"" #name "\"\n"                                       \
+                         ".asciz \"" args "\"\n"                                        \
+                         "994: .balign 4\n"                                             \
+                         ".popsection\n"                                                \
+                         ".ifndef _.stapsdt.base\n"                                     \
+                         ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+                         ".weak _.stapsdt.base\n"                                       \
+                         ".hidden _.stapsdt.base\n"                                     \
+                         "_.stapsdt.base: .space 1\n"                                   \
+                         ".size _.stapsdt.base, 1\n"                                    \
+                         ".popsection\n"                                                \
+                         ".endif\n"                                                     \
+                         :                                                              \
+                         : __VA_ARGS__)
+
+#define WEBSERVER_PROBE0(name) WS_SDT_PROBE(name, "", )
+#define WEBSERVER_PROBE1(name, a1) WS_SDT_PROBE(name, WS_SDT_ARG(1), WS_SDT_OPERAND(1, a1))
+#define WEBSERVER_PROBE2(name, a1, a2) \
+    WS_SDT_PROBE(name, WS_SDT_ARG(1) " " WS_SDT_ARG(2), WS_SDT_OPERAND(1, a1), WS_SDT_OPERAND(2, a2))
+#define WEBSERVER_PROBE3(name, a1, a2, a3)                                         \
+    WS_SDT_PROBE(name, WS_SDT_ARG(1) " " WS_SDT_ARG(2) " " WS_SDT_ARG(3), WS_SDT_OPERAND(1, a1), \
+                 WS_SDT_OPERAND(2, a2), WS_SDT_OPERAND(3, a3))
+#define WEBSERVER_PROBE4(name, a1, a2, a3, a4)                                                   \
+    WS_SDT_PROBE(name, WS_SDT_ARG(1) " " WS_SDT_ARG(2) " " WS_SDT_ARG(3) " " WS_SDT_ARG(4), WS_SDT_OPERAND(1, a1), \
+                 WS_SDT_OPERAND(2, a2), WS_SDT_OPERAND(3, a3), WS_SDT_OPERAND(4, a4))
+
+#else
+
+// 其他平台 不生成探针
+#define WEBSERVER_PROBE0(name) \
+    do                         \
+    {                          \
+    } while (0)
+#define WEBSERVER_PROBE1(name, a1) WEBSERVER_PROBE0(name)
+#define WEBSERVER_PROBE2(name, a1, a2) WEBSERVER_PROBE0(name)
+#define WEBSERVER_PROBE3(name, a1, a2, a3) WEBSERVER_PROBE0(name)
+#define WEBSERVER_PROBE4(name, a1, a2, a3, a4) WEBSERVER_PROBE0(name)
+
+#endif
+
+#endif // PROBES_H
@@ -5,35 +5,22 @@
 #include <condition_variable>
 #include <queue>
 #include <thread>
+#include <vector>
 #include <functional>
+#include <algorithm>
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
 
 class ThreadPool
 {
 public:
-    explicit ThreadPool(size_t threadCount = 8) : pool_(std::make_shared<Pool>())
+    // cpus不为空时第i个线程绑定到cpus[i % cpus.size()]
+    explicit ThreadPool(size_t threadCount = 8, const std::vector<int> &cpus = {})
+        : pool_(std::make_shared<Pool>()), cpus_(cpus)
     {
         assert(threadCount > 0);
-        for (size_t i = 0; i < threadCount; i++)
-        {
-            std::thread([pool = pool_]
-                        {
-                    std::unique_lock<std::mutex> locker(pool->mtx);
-                    while(true) {
-                        // 取任务执行 注意上锁
-                        if(!pool->tasks.empty()) {
-                            auto task = std::move(pool->tasks.front());
-                            pool->tasks.pop();
-                            locker.unlock();
-                            task();
-                            locker.lock();
-                        } 
-                        else if(pool->isClosed) break;
-                        // 等待 如果任务来了就notify
-                        else pool->cond.wait(locker);
-                    } })
-                .detach();
-        }
+        Resize(threadCount);
     }
 
     ThreadPool() = default;
@@ -41,6 +28,12 @@ public:
     ThreadPool(ThreadPool &&) = default;
 
     ~ThreadPool()
+    {
+        Shutdown();
+    }
+
+    // 执行完已提交的任务后结束所有线程 可重复调用
+    void Shutdown()
     {
         if (static_cast<bool>(pool_))
         {
@@ -48,11 +41,44 @@ public:
                 std::lock_guard<std::mutex> locker(pool_->mtx);
                 pool_->isClosed = true;
             }
-            // 唤醒所有线程
+            // 唤醒所有线程 包括待命的
             pool_->cond.notify_all();
+            pool_->standby.notify_all();
+        }
+        for (std::thread &thread : threads_)
+        {
+            if (thread.joinable())
+            {
+                thread.join();
+            }
         }
     }
 
+    // 调整线程数 只由一个线程调用 不等待
+    // 调小时序号超出的线程执行完手上的任务后待命 调大时先恢复待命的线程 不够时再创建
+    // 线程不退出 线程局部的缓冲池、指标分片与追踪环在反复调整时不重新分配
+    void Resize(size_t threadCount)
+    {
+        assert(threadCount > 0);
+        {
+            std::lock_guard<std::mutex> locker(pool_->mtx);
+            pool_->threads = threadCount;
+            while (threads_.size() < threadCount)
+            {
+                Spawn_();
+            }
+        }
+        pool_->cond.notify_all();
+        pool_->standby.notify_all();
+    }
+
+    // 线程数 不含待命的
+    size_t ThreadCount() const
+    {
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        return pool_->threads;
+    }
+
     template <class F>
     void AddTask(F &&task)
     {
@@ -63,17 +89,64 @@ public:
         pool_->cond.notify_one();
     }
 
+    // 等待执行的任务数
+    size_t QueueSize() const
+    {
+        std::lock_guard<std::mutex> locker(pool_->mtx);
+        return pool_->tasks.size();
+    }
+
 private:
+    // 创建一个线程 需持有pool_->mtx
+    void Spawn_()
+    {
+        size_t index = threads_.size();
+        int cpu = cpus_.empty() ? -1 : cpus_[index % cpus_.size()];
+        threads_.emplace_back([pool = pool_, cpu, index]
+                    {
+                // 执行任务之前绑定 线程局部的缓冲池按首次访问分配在这个CPU的NUMA节点上
+                if(cpu >= 0) {
+                    cpu_set_t set;
+                    CPU_ZERO(&set);
+                    CPU_SET(cpu, &set);
+                    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+                }
+                std::unique_lock<std::mutex> locker(pool->mtx);
+                while(true) {
+                    // 线程数调小 执行完手上的任务后待命 可能收到的任务通知转给其他线程
+                    if(index >= pool->threads && !pool->isClosed) {
+                        if(!pool->tasks.empty()) pool->cond.notify_one();
+                        pool->standby.wait(locker);
+                        continue;
+                    }
+                    // 取任务执行 注意上锁
+                    if(!pool->tasks.empty()) {
+                        auto task = std::move(pool->tasks.front());
+                        pool->tasks.pop();
+                        locker.unlock();
+                        task();
+                        locker.lock();
+                    } 
+                    else if(pool->isClosed) break;
+                    // 等待 如果任务来了就notify
+                    else pool->cond.wait(locker);
+                } });
+    }
+
 // 用一个结构体封装起来 方便调用
     struct Pool
     {
         std::mutex mtx;
         std::condition_variable cond;
-        bool isClosed;
+        std::condition_variable standby; // 序号不小于threads的线程在此待命
+        bool isClosed = false;
+        size_t threads = 0; // 处理任务的线程数 序号小于它的线程取任务
         // 任务队列 函数类型为void()
         std::queue<std::function<void()>> tasks;
     };
     std::shared_ptr<Pool> pool_;
+    std::vector<std::thread> threads_;
+    std::vector<int> cpus_;
 };
 
 #endif //THREADPOOL_H
\ No newline at end of file
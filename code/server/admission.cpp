@@ -0,0 +1,166 @@
+#include "admission.h"
+#include "../log/log.h"
+
+#include <algorithm>
+#include <sys/socket.h>
+
+using namespace std;
+
+const char Admission::RESPONSE_503[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                                       "Content-Type: text/html\r\n"
+                                       "Content-Length: 88\r\n"
+                                       "Retry-After: 1\r\n"
+                                       "Connection: close\r\n"
+                                       "\r\n"
+                                       "<html><title>503</title><body><h1>503 Service Unavailable</h1>Server busy</body></html>\n";
+
+Admission::Admission(int maxConnections, int maxQueue, int targetMS)
+    : maxConnections_(maxConnections), maxQueue_(maxQueue), target_((uint64_t)targetMS * 1000000),
+      interval_((uint64_t)INTERVAL_MS * 1000000), connections_(0), overloaded_(false), firstTicket_(1), waiting_(0),
+      intervalEnd_(0), minWait_(UINT64_MAX)
+{
+}
+
+uint64_t Admission::Timeout_() const
+{
+    return overloaded_.load(memory_order_relaxed) ? target_ : interval_;
+}
+
+void Admission::Update_(uint64_t now)
+{
+    while (!pending_.empty() && pending_.front().state != WAITING)
+    {
+        pending_.pop_front();
+        firstTicket_++;
+    }
+    if (now < intervalEnd_)
+    {
+        return;
+    }
+
+    // 一个间隔结束 离开队列的连接排队时间的最小值超过目标 说明队列始终没有排空
+    // 没有连接离开时用队首的排队时间 过载时放行的连接刚入队 不能据此判断已恢复
+    uint64_t minWait = minWait_;
+    if (minWait == UINT64_MAX && !pending_.empty())
+    {
+        minWait = now - pending_.front().accepted;
+    }
+    bool overloaded = minWait != UINT64_MAX && minWait > target_;
+    if (overloaded != overloaded_.load(memory_order_relaxed))
+    {
+        overloaded_.store(overloaded, memory_order_relaxed);
+        LOG_WARN("Admission: %s, %d queued, min queue delay %.1fms", overloaded ? "overloaded" : "recovered",
+                 (int)waiting_, minWait == UINT64_MAX ? 0.0 : minWait / 1e6);
+    }
+    minWait_ = UINT64_MAX;
+    intervalEnd_ = now + interval_;
+}
+
+void Admission::Leave_(Entry &entry, uint64_t now, bool taken)
+{
+    entry.state = taken ? TAKEN : REJECTED;
+    waiting_--;
+    minWait_ = min(minWait_, now - entry.accepted);
+    if (!taken)
+    {
+        Reject_(entry.fd, Metrics::SHED_QUEUE_DELAY);
+    }
+}
+
+void Admission::SetLimits(int maxConnections, int maxQueue, int targetMS)
+{
+    maxConnections_ = maxConnections;
+    lock_guard<mutex> locker(mtx_);
+    maxQueue_ = maxQueue;
+    target_ = (uint64_t)targetMS * 1000000;
+}
+
+bool Admission::Open(int fd)
+{
+    if (connections_.load(memory_order_relaxed) >= maxConnections_)
+    {
+        Reject_(fd, Metrics::SHED_CONNECTIONS);
+        return false;
+    }
+    connections_.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+void Admission::Close()
+{
+    connections_.fetch_sub(1, memory_order_relaxed);
+}
+
+uint64_t Admission::Admit(int fd, uint64_t now)
+{
+    lock_guard<mutex> locker(mtx_);
+    if (waiting_ >= maxQueue_)
+    {
+        Reject_(fd, Metrics::SHED_QUEUE_FULL);
+        return 0;
+    }
+    // 过载时新连接排队也会超时 不如直接拒绝 队列为空时放行一个 用它的排队时间判断是否恢复
+    Update_(now);
+    if (overloaded_.load(memory_order_relaxed) && waiting_ > 0)
+    {
+        Reject_(fd, Metrics::SHED_OVERLOAD);
+        return 0;
+    }
+    pending_.push_back({now, fd, WAITING});
+    waiting_++;
+    return firstTicket_ + pending_.size() - 1;
+}
+
+void Admission::Expire(uint64_t now)
+{
+    lock_guard<mutex> locker(mtx_);
+    Update_(now);
+    uint64_t timeout = Timeout_();
+    for (Entry &entry : pending_)
+    {
+        if (now - entry.accepted <= timeout)
+        {
+            break; // 之后的连接入队更晚
+        }
+        if (entry.state == WAITING)
+        {
+            Leave_(entry, now, false);
+        }
+    }
+    Update_(now);
+}
+
+bool Admission::Dequeue(uint64_t ticket)
+{
+    uint64_t now = Metrics::NowNs();
+    lock_guard<mutex> locker(mtx_);
+    // 已被Expire拒绝 可能已经弹出队列
+    if (ticket < firstTicket_ || pending_[ticket - firstTicket_].state == REJECTED)
+    {
+        return false;
+    }
+    // 排队过久的客户端多半已经超时 把线程留给新的连接
+    Entry &entry = pending_[ticket - firstTicket_];
+    bool taken = now - entry.accepted <= Timeout_();
+    Leave_(entry, now, taken);
+    Update_(now); // 可能弹出entry
+    return taken;
+}
+
+void Admission::Reject_(int fd, Metrics::ShedReason reason)
+{
+    Metrics::Shed(reason);
+    Refuse(fd, RESPONSE_503, sizeof(RESPONSE_503) - 1);
+    shutdown(fd, SHUT_WR);
+}
+
+void Admission::Refuse(int fd, const char *response, size_t len)
+{
+    // 先读走已到达的请求 关闭时接收队列有未读数据会发送RST 客户端可能读不到响应
+    char discard[4096];
+    while (recv(fd, discard, sizeof(discard), MSG_DONTWAIT) > 0)
+    {
+    }
+    ssize_t ret = send(fd, response, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    (void)ret;
+}
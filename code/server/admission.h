@@ -0,0 +1,95 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "../metrics/metrics.h"
+
+/**
+ * 准入控制 线程池饱和时快速拒绝 而不是让所有人的延迟一起无限增长
+ * 1. 打开的连接数与等待工作线程的请求数有硬上限 超过时直接返回503
+ * 2. 连接可读时交给线程池，排队的是等待线程的连接。按CoDel的思路判断过载：
+ *    一个间隔(100ms)内离开队列的连接，排队时间的最小值超过目标值，
+ *    说明队列在这段时间里一直没有排空，是持续过载而不是突发。
+ *    没有连接离开时看队首的排队时间，工作线程全部被占用、没有连接出队时同样能发现过载。
+ *    过载时仍有积压则直接拒绝，排队超过目标值的连接由reactor线程定期拒绝，
+ *    队列为空时放行一个连接，它的排队时间决定是否恢复；
+ *    不过载时只拒绝排队超过一个间隔的连接，突发的积压可以正常消化。
+ * 拒绝时发送预先生成的503响应(带Retry-After)，不占用工作线程，连接由调用者关闭。
+ */
+class Admission
+{
+public:
+    static const int INTERVAL_MS = 100;
+
+    // maxConnections 同时存在的连接数上限 maxQueue 等待线程的连接数上限 targetMS 过载时允许的排队时间
+    Admission(int maxConnections, int maxQueue, int targetMS);
+
+    // accept后调用 连接数达到上限时发送503 返回false 由调用者关闭fd
+    bool Open(int fd);
+    // Open成功的连接关闭
+    void Close();
+
+    // reactor线程在连接可读、交给线程池前调用 通过时返回排队凭证 拒绝时已经发送503 返回0
+    uint64_t Admit(int fd, uint64_t now);
+    // reactor线程定期调用 拒绝排队过久、还没有被取出的连接 只发送503并关闭写方向
+    void Expire(uint64_t now);
+    // 工作线程取出连接时调用 返回false表示连接已被拒绝 应当关闭
+    bool Dequeue(uint64_t ticket);
+
+    // reactor线程调用 修改上限与目标值 已排队的连接按新的值处理
+    void SetLimits(int maxConnections, int maxQueue, int targetMS);
+
+    // 读走已到达的数据 发送预先生成的响应 不阻塞 不关闭fd
+    static void Refuse(int fd, const char *response, size_t len);
+
+    bool Overloaded() const { return overloaded_.load(std::memory_order_relaxed); }
+    int Connections() const { return connections_.load(std::memory_order_relaxed); }
+
+private:
+    enum State
+    {
+        WAITING,
+        TAKEN,    // 已被工作线程取出
+        REJECTED, // 排队过久 已被拒绝
+    };
+
+    struct Entry
+    {
+        uint64_t accepted;
+        int fd;
+        State state;
+    };
+
+    // 弹出队首已取出或已拒绝的连接 间隔结束时更新过载状态 需持有mtx_
+    void Update_(uint64_t now);
+    // 连接离开队列 taken为false时拒绝 需持有mtx_
+    void Leave_(Entry &entry, uint64_t now, bool taken);
+    // 当前允许的排队时间
+    uint64_t Timeout_() const;
+    // 发送503并关闭写方向 不阻塞
+    static void Reject_(int fd, Metrics::ShedReason reason);
+
+    int maxConnections_;      // 只由reactor线程读写
+    size_t maxQueue_;         // 以下两项由mtx_保护
+    uint64_t target_;         // 纳秒
+    const uint64_t interval_; // 纳秒
+
+    std::atomic<int> connections_;
+    std::atomic<bool> overloaded_;
+
+    std::mutex mtx_;            // 保护以下 每次入队出队时各加锁一次
+    std::deque<Entry> pending_; // 按入队顺序 凭证为firstTicket_+下标
+    uint64_t firstTicket_;      // pending_队首的凭证
+    size_t waiting_;            // pending_中WAITING的数量
+    uint64_t intervalEnd_;      // 当前间隔的结束时刻
+    uint64_t minWait_;          // 当前间隔内离开队列的连接的最小排队时间
+
+    static const char RESPONSE_503[];
+};
+
+#endif // ADMISSION_H
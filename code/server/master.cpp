@@ -0,0 +1,351 @@
+#include "master.h"
+#include "process.h"
+#include "../log/log.h"
+#include "../metrics/metrics.h"
+#include "../config/config.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+Master::Master(int port, int workers, const vector<int> &cpus, bool incomingCpu)
+    : port_(port), incomingCpu_(incomingCpu), signalFd_(-1), run_(nullptr),
+      stopping_(false), killDeadline_(0), upgradePid_(0), upgradeFd_(-1)
+{
+    // 小于0时每个可用的CPU一个worker
+    if (workers < 0)
+    {
+        cpu_set_t allowed;
+        workers = sched_getaffinity(0, sizeof(allowed), &allowed) == 0 ? CPU_COUNT(&allowed) : 1;
+    }
+    workers_.assign(workers, Worker{0, -1, 0, 0, 0});
+    for (int i = 0; i < workers; i++)
+    {
+        workers_[i].cpu = Process::WorkerCpu(i, cpus);
+    }
+}
+
+Master::~Master()
+{
+    if (signalFd_ >= 0)
+    {
+        close(signalFd_);
+    }
+    CloseListen_();
+}
+
+int Master::Run(const function<void()> &run)
+{
+    run_ = &run;
+    if (incomingCpu_)
+    {
+        vector<int> cpus;
+        for (const Worker &worker : workers_)
+        {
+            cpus.push_back(worker.cpu);
+        }
+        if (!Process::ListenPerCpu(port_, cpus, listenFds_))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        int fd = Process::Listen(port_);
+        if (fd < 0)
+        {
+            return 1;
+        }
+        listenFds_.push_back(fd);
+    }
+    if (!Metrics::Instance()->Share())
+    {
+        LOG_WARN("Master: shared metrics unavailable, each worker reports its own");
+    }
+
+    // 信号由signalfd读取 与重启的定时一起在poll中等待
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int sig : {SIGCHLD, SIGTERM, SIGINT, SIGUSR2, SIGHUP})
+    {
+        sigaddset(&mask, sig);
+    }
+    sigprocmask(SIG_BLOCK, &mask, &oldMask_);
+    signalFd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    LOG_INFO("Master: pid %d, %d workers", (int)getpid(), (int)workers_.size());
+    for (size_t i = 0; i < workers_.size(); i++)
+    {
+        Spawn_(i);
+    }
+    // 热升级启动的master 通知旧master开始退出
+    Process::NotifyReady();
+
+    while (true)
+    {
+        bool running = any_of(workers_.begin(), workers_.end(), [](const Worker &w)
+                              { return w.pid != 0; });
+        if (stopping_ && !running)
+        {
+            break;
+        }
+
+        struct pollfd fds[2] = {{signalFd_, POLLIN, 0}, {upgradeFd_, POLLIN, 0}};
+        int n = poll(fds, upgradeFd_ >= 0 ? 2 : 1, NextTimeout_());
+        if (n < 0 && errno != EINTR)
+        {
+            LOG_ERROR("Master: poll failed: %s", strerror(errno));
+            break;
+        }
+        if (n > 0 && fds[0].revents)
+        {
+            struct signalfd_siginfo info;
+            while (read(signalFd_, &info, sizeof(info)) == sizeof(info))
+            {
+                if (info.ssi_signo == SIGCHLD)
+                {
+                    Reap_();
+                }
+                else if (info.ssi_signo == SIGUSR2)
+                {
+                    Upgrade_();
+                }
+                else if (info.ssi_signo == SIGHUP)
+                {
+                    Reload_();
+                }
+                else
+                {
+                    Stop_();
+                }
+            }
+        }
+        if (n > 0 && upgradeFd_ >= 0 && fds[1].revents)
+        {
+            // 新master的worker已经启动 本进程的worker处理完已有的连接后退出
+            bool ready = Process::UpgradeReady(upgradeFd_, upgradePid_);
+            upgradeFd_ = -1;
+            if (ready)
+            {
+                Stop_();
+            }
+            else
+            {
+                upgradePid_ = 0;
+            }
+        }
+
+        uint64_t now = Metrics::NowNs();
+        for (size_t i = 0; i < workers_.size(); i++)
+        {
+            if (!stopping_ && workers_[i].pid == 0 && workers_[i].restartAt && now >= workers_[i].restartAt)
+            {
+                Spawn_(i);
+            }
+        }
+        if (stopping_ && now >= killDeadline_)
+        {
+            for (size_t i = 0; i < workers_.size(); i++)
+            {
+                if (workers_[i].pid)
+                {
+                    LOG_WARN("Master: worker %d (pid %d) still running, killing", (int)i, (int)workers_[i].pid);
+                    kill(workers_[i].pid, SIGKILL);
+                }
+            }
+            killDeadline_ = UINT64_MAX;
+        }
+    }
+
+    sigprocmask(SIG_SETMASK, &oldMask_, nullptr);
+    LOG_INFO("Master: all workers exited");
+    return 0;
+}
+
+void Master::Spawn_(int index)
+{
+    Worker &worker = workers_[index];
+    uint64_t now = Metrics::NowNs();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // worker进程 恢复信号屏蔽字 master的描述符不再需要
+        sigprocmask(SIG_SETMASK, &oldMask_, nullptr);
+        close(signalFd_);
+        if (upgradeFd_ >= 0)
+        {
+            close(upgradeFd_);
+        }
+        // 每个worker一个socket时关闭其他worker的 否则某个worker退出后它的socket仍在监听 积压的连接无人accept
+        int listenFd = listenFds_[incomingCpu_ ? index : 0];
+        for (int fd : listenFds_)
+        {
+            if (fd != listenFd)
+            {
+                close(fd);
+            }
+        }
+        Process::InitWorker(index, worker.cpu, listenFd);
+        (*run_)();
+        exit(0);
+    }
+    if (pid < 0)
+    {
+        LOG_ERROR("Master: fork worker %d failed: %s", index, strerror(errno));
+        worker.restartAt = now + (uint64_t)MAX_BACKOFF_MS * 1000000;
+        return;
+    }
+    if (worker.started)
+    {
+        Metrics::WorkerRestarted();
+    }
+    worker.pid = pid;
+    worker.started = now;
+    worker.restartAt = 0;
+    LOG_INFO("Master: worker %d started as pid %d on cpu %d", index, (int)pid, worker.cpu);
+}
+
+void Master::Reap_()
+{
+    // 只回收worker 热升级启动的新master由Process::UpgradeReady回收
+    for (size_t i = 0; i < workers_.size(); i++)
+    {
+        Worker &worker = workers_[i];
+        int status = 0;
+        if (worker.pid == 0 || waitpid(worker.pid, &status, WNOHANG) != worker.pid)
+        {
+            continue;
+        }
+        Metrics::Instance()->Retire(worker.pid);
+        uint64_t now = Metrics::NowNs();
+        uint64_t lived = (now - worker.started) / 1000000;
+        pid_t pid = worker.pid;
+        worker.pid = 0;
+        if (stopping_)
+        {
+            LOG_INFO("Master: worker %d (pid %d) exited", (int)i, (int)pid);
+            continue;
+        }
+
+        if (WIFSIGNALED(status))
+        {
+            LOG_ERROR("Master: worker %d (pid %d) killed by signal %d after %llums", (int)i, (int)pid,
+                      WTERMSIG(status), (unsigned long long)lived);
+        }
+        else
+        {
+            LOG_ERROR("Master: worker %d (pid %d) exited with status %d after %llums", (int)i, (int)pid,
+                      WEXITSTATUS(status), (unsigned long long)lived);
+        }
+        // 启动即崩溃时不要反复fork 延迟从100ms起翻倍
+        worker.crashes = lived < FAST_EXIT_MS ? worker.crashes + 1 : 0;
+        int delay = worker.crashes ? min(MAX_BACKOFF_MS, 100 << min(worker.crashes - 1, 7)) : 0;
+        worker.restartAt = now + (uint64_t)delay * 1000000 + 1;
+    }
+}
+
+void Master::Stop_()
+{
+    if (stopping_)
+    {
+        return;
+    }
+    stopping_ = true;
+    // worker收到SIGTERM后各自关闭监听socket master也关闭 否则内核继续完成握手但无人accept
+    CloseListen_();
+    // worker处理完已有连接的时限 可能已重新加载
+    int shutdownTimeoutMS = Config::current().shutdownTimeoutMS;
+    killDeadline_ = Metrics::NowNs() + (uint64_t)(shutdownTimeoutMS + KILL_GRACE_MS) * 1000000;
+    int running = 0;
+    for (Worker &worker : workers_)
+    {
+        worker.restartAt = 0;
+        if (worker.pid)
+        {
+            kill(worker.pid, SIGTERM);
+            running++;
+        }
+    }
+    LOG_INFO("Master: stopping %d workers", running);
+}
+
+void Master::Upgrade_()
+{
+    if (stopping_ || upgradePid_ > 0)
+    {
+        LOG_WARN("Upgrade: ignored, %s", stopping_ ? "shutting down" : "already upgrading");
+        return;
+    }
+    upgradeFd_ = Process::Upgrade(listenFds_, upgradePid_);
+    if (upgradeFd_ < 0)
+    {
+        upgradePid_ = 0;
+    }
+}
+
+void Master::Reload_()
+{
+    if (stopping_)
+    {
+        return;
+    }
+    shared_ptr<const Config> old = Config::snapshot();
+    shared_ptr<Config> next = old ? old->reload() : nullptr;
+    if (!next)
+    {
+        LOG_ERROR("Reload: invalid configuration, keeping the current one");
+        return;
+    }
+    string restart = old->restart_fields(*next);
+    if (!restart.empty())
+    {
+        LOG_WARN("Reload: %s changed, takes effect after restart", restart.c_str());
+        next->keep_restart_fields(*old);
+    }
+    // 之后fork的worker继承新快照 需要重启的配置项仍是启动时的值 与其他worker一致
+    Config::publish(next);
+    Log::Instance()->SetLevel(next->logLevel);
+    int forwarded = 0;
+    for (const Worker &worker : workers_)
+    {
+        if (worker.pid && kill(worker.pid, SIGHUP) == 0)
+        {
+            forwarded++;
+        }
+    }
+    LOG_INFO("Reload: forwarded to %d workers", forwarded);
+}
+
+int Master::NextTimeout_() const
+{
+    uint64_t next = stopping_ ? killDeadline_ : UINT64_MAX;
+    for (const Worker &worker : workers_)
+    {
+        if (worker.pid == 0 && worker.restartAt)
+        {
+            next = min(next, worker.restartAt);
+        }
+    }
+    if (next == UINT64_MAX)
+    {
+        return -1;
+    }
+    uint64_t now = Metrics::NowNs();
+    return next > now ? (int)((next - now) / 1000000) + 1 : 0;
+}
+
+void Master::CloseListen_()
+{
+    for (int fd : listenFds_)
+    {
+        close(fd);
+    }
+    listenFds_.clear();
+}
@@ -0,0 +1,73 @@
+#ifndef MASTER_H
+#define MASTER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <signal.h>
+#include <sys/types.h>
+
+/**
+ * 多进程模式 master创建监听socket后fork出多个worker进程
+ * 每个worker有自己的reactor、线程池与缓存，绑定到一个CPU，进程之间没有共享的锁；
+ * 一个worker崩溃(如断言失败)只断开它自己的连接，master回收后重新fork。
+ * 监听socket在每个worker的epoll中注册为EPOLLEXCLUSIVE，新连接只唤醒一个worker；
+ * incomingCpu时每个worker一个SO_REUSEPORT socket，新连接交给绑定在处理其网卡中断的CPU上的worker，
+ * 连接的数据从中断到应用都在同一个CPU的缓存与NUMA节点上。
+ * master不处理请求、只有一个线程，用signalfd同步处理信号：
+ *   SIGCHLD 回收退出的worker 非关闭期间退出的立即重启 启动后1秒内退出的按指数退避延迟重启
+ *   SIGTERM/SIGINT 转发给worker 等待它们处理完已有的连接后退出 超过时限的强制结束
+ *   SIGUSR2 热升级整组进程：exec新的master，新master的worker启动后通知本进程，本进程按SIGTERM退出
+ *   SIGHUP 重新读取配置，之后重启的worker使用新配置，校验通过时转发给worker，各自重新加载
+ * 指标分片在fork前映射的共享内存中，任一worker的/metrics是所有worker的汇总。
+ */
+class Master
+{
+public:
+    // workers worker进程数 cpus worker依次绑定的CPU 为空时用允许使用的所有CPU incomingCpu 每个worker一个监听socket
+    // 关闭时等待worker的时限取当前配置的shutdownTimeoutMS
+    Master(int port, int workers, const std::vector<int> &cpus, bool incomingCpu);
+    ~Master();
+
+    // 在master进程中运行 直到收到SIGTERM且所有worker退出 run在fork出的worker进程中执行 返回后worker退出
+    int Run(const std::function<void()> &run);
+
+private:
+    void Spawn_(int index);
+    // 回收所有已退出的worker 安排重启
+    void Reap_();
+    void Stop_();
+    void CloseListen_();
+    void Upgrade_();
+    void Reload_();
+    // 距下一次重启或强制结束的毫秒数 没有时返回-1
+    int NextTimeout_() const;
+
+    int port_;
+    bool incomingCpu_;
+    std::vector<int> listenFds_; // 所有worker共用一个 或incomingCpu_时每个worker一个
+    int signalFd_;
+    sigset_t oldMask_; // fork出的worker恢复原来的信号屏蔽字
+    const std::function<void()> *run_;
+
+    struct Worker
+    {
+        pid_t pid;         // 0表示未运行
+        int cpu;           // 绑定的CPU -1表示不绑定
+        uint64_t started;  // 启动时刻
+        int crashes;       // 连续的快速退出次数
+        uint64_t restartAt; // 等待重启的时刻 0表示不需要
+    };
+    std::vector<Worker> workers_;
+
+    bool stopping_;
+    uint64_t killDeadline_; // 关闭时超过这个时刻仍未退出的worker被SIGKILL
+    pid_t upgradePid_;
+    int upgradeFd_;
+
+    static const int FAST_EXIT_MS = 1000;  // 启动后这么快退出视为启动即崩溃
+    static const int MAX_BACKOFF_MS = 10000;
+    static const int KILL_GRACE_MS = 2000; // 在shutdownTimeoutMS之外再等待的时间
+};
+
+#endif // MASTER_H
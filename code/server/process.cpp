@@ -0,0 +1,367 @@
+#include "process.h"
+#include "../log/log.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+
+using namespace std;
+
+// 热升级时传给新进程的监听socket与就绪通知管道
+static const char LISTEN_FD_ENV[] = "WEBSERVER_LISTEN_FD";
+static const char READY_FD_ENV[] = "WEBSERVER_READY_FD";
+
+int Process::worker = -1;
+string Process::exePath_;
+vector<string> Process::args_;
+vector<int> Process::inheritedFds_;
+int Process::readyFd_ = -1;
+int Process::listenFd_ = -1;
+
+// 读取并清除环境变量中的描述符 没有时返回-1
+static int TakeFdEnv(const char *name)
+{
+    const char *value = getenv(name);
+    int fd = value ? atoi(value) : -1;
+    unsetenv(name);
+    return fd;
+}
+
+void Process::Init()
+{
+    char exe[4096];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len > 0)
+    {
+        exePath_.assign(exe, len);
+    }
+    ifstream cmdline("/proc/self/cmdline", ios::binary);
+    string arg;
+    while (getline(cmdline, arg, '\0'))
+    {
+        args_.push_back(arg);
+    }
+    // 监听socket可能有多个 以逗号分隔
+    const char *fds = getenv(LISTEN_FD_ENV);
+    while (fds && *fds)
+    {
+        inheritedFds_.push_back(atoi(fds));
+        fds = strchr(fds, ',');
+        fds = fds ? fds + 1 : nullptr;
+    }
+    unsetenv(LISTEN_FD_ENV);
+    readyFd_ = TakeFdEnv(READY_FD_ENV);
+}
+
+bool Process::Adopt_(int fd)
+{
+    int accepting = 0;
+    socklen_t optlen = sizeof(accepting);
+    if (getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &optlen) == 0 && accepting)
+    {
+        // 继承时去掉了FD_CLOEXEC O_NONBLOCK属于socket本身 与旧进程共享
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        LOG_INFO("Listen: inherited socket %d", fd);
+        return true;
+    }
+    LOG_ERROR("Listen: fd %d is not a listening socket", fd);
+    close(fd);
+    return false;
+}
+
+int Process::Bind_(int port, bool reusePort)
+{
+    int listenfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenfd == -1)
+    {
+        LOG_ERROR("Create socket error!");
+        return -1;
+    }
+
+    int optval = 1;
+    if (reusePort && setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) == -1)
+    {
+        LOG_ERROR("Set SO_REUSEPORT error!");
+        close(listenfd);
+        return -1;
+    }
+
+    struct sockaddr_in bindaddr;
+    bindaddr.sin_family = AF_INET;
+    bindaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    bindaddr.sin_port = htons(port);
+    if (bind(listenfd, (struct sockaddr *)&bindaddr, sizeof(bindaddr)) == -1)
+    {
+        LOG_ERROR("Bind error!");
+        close(listenfd);
+        return -1;
+    }
+
+    if (listen(listenfd, SOMAXCONN) == -1)
+    {
+        LOG_ERROR("Listen error!");
+        close(listenfd);
+        return -1;
+    }
+    return listenfd;
+}
+
+// 继承的socket数与需要的不同 关闭后由调用者重新bind 旧进程的socket仍占用端口时bind失败
+static void DropInherited(vector<int> &fds, size_t want)
+{
+    LOG_ERROR("Listen: inherited %d sockets, need %d, restart to change the listen sockets", (int)fds.size(),
+              (int)want);
+    for (int fd : fds)
+    {
+        close(fd);
+    }
+    fds.clear();
+}
+
+int Process::Listen(int port)
+{
+    // worker使用master的socket
+    if (listenFd_ >= 0)
+    {
+        return listenFd_;
+    }
+    // 旧进程已经在这个socket上listen 积压的连接由新进程接着accept
+    if (inheritedFds_.size() == 1)
+    {
+        int fd = inheritedFds_[0];
+        inheritedFds_.clear();
+        if (Adopt_(fd))
+        {
+            listenFd_ = fd;
+            return fd;
+        }
+    }
+    else if (!inheritedFds_.empty())
+    {
+        DropInherited(inheritedFds_, 1);
+    }
+    listenFd_ = Bind_(port, false);
+    return listenFd_;
+}
+
+bool Process::ListenPerCpu(int port, const vector<int> &cpus, vector<int> &fds)
+{
+    if (!inheritedFds_.empty() && inheritedFds_.size() != cpus.size())
+    {
+        DropInherited(inheritedFds_, cpus.size());
+    }
+    fds.clear();
+    for (size_t i = 0; i < cpus.size(); i++)
+    {
+        int fd = i < inheritedFds_.size() && Adopt_(inheritedFds_[i]) ? inheritedFds_[i] : Bind_(port, true);
+        if (fd < 0)
+        {
+            break;
+        }
+        fds.push_back(fd);
+        // 继承的socket也重新设置 CPU的分配可能已经改变
+        int cpu = cpus[i];
+        if (cpu >= 0 && setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == -1)
+        {
+            LOG_WARN("Listen: SO_INCOMING_CPU %d failed: %s", cpu, strerror(errno));
+        }
+    }
+    // 失败时关闭已经创建的与还没有检查的
+    for (size_t i = fds.size() + 1; i < inheritedFds_.size(); i++)
+    {
+        close(inheritedFds_[i]);
+    }
+    inheritedFds_.clear();
+    if (fds.size() < cpus.size())
+    {
+        for (int fd : fds)
+        {
+            close(fd);
+        }
+        fds.clear();
+        return false;
+    }
+    LOG_INFO("Listen: %d SO_REUSEPORT sockets steered by SO_INCOMING_CPU", (int)fds.size());
+    return true;
+}
+
+int Process::Upgrade(const vector<int> &listenFds, pid_t &pid)
+{
+    if (exePath_.empty() || args_.empty())
+    {
+        LOG_ERROR("Upgrade: executable path unknown");
+        return -1;
+    }
+    int ready[2];
+    if (pipe2(ready, O_CLOEXEC) < 0)
+    {
+        LOG_ERROR("Upgrade: pipe failed: %s", strerror(errno));
+        return -1;
+    }
+
+    // fork之后的子进程只能调用异步信号安全的函数 参数与环境变量提前准备好
+    string fds;
+    for (int fd : listenFds)
+    {
+        fds += (fds.empty() ? "" : ",") + to_string(fd);
+    }
+    vector<string> envs = {string(LISTEN_FD_ENV) + "=" + fds, string(READY_FD_ENV) + "=" + to_string(ready[1])};
+    for (char **env = environ; *env; env++)
+    {
+        if (strncmp(*env, "WEBSERVER_", 10) != 0)
+        {
+            envs.push_back(*env);
+        }
+    }
+    vector<char *> argv, envp;
+    for (string &arg : args_)
+    {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+    for (string &env : envs)
+    {
+        envp.push_back(&env[0]);
+    }
+    envp.push_back(nullptr);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        // 屏蔽的信号在exec后保持屏蔽 master用signalfd时屏蔽了SIGTERM等
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK, &none, nullptr);
+        for (int fd : listenFds)
+        {
+            fcntl(fd, F_SETFD, 0);
+        }
+        fcntl(ready[1], F_SETFD, 0);
+        execve(exePath_.c_str(), argv.data(), envp.data());
+        _exit(127);
+    }
+    close(ready[1]);
+    if (pid < 0)
+    {
+        LOG_ERROR("Upgrade: fork failed: %s", strerror(errno));
+        close(ready[0]);
+        return -1;
+    }
+    LOG_INFO("Upgrade: started %s as pid %d", exePath_.c_str(), (int)pid);
+    return ready[0];
+}
+
+bool Process::UpgradeReady(int readyFd, pid_t pid)
+{
+    char c;
+    ssize_t n = read(readyFd, &c, 1);
+    close(readyFd);
+    if (n == 1)
+    {
+        LOG_INFO("Upgrade: pid %d is accepting, draining", (int)pid);
+        return true;
+    }
+    // 写端只在新进程退出时关闭
+    int status = 0;
+    waitpid(pid, &status, 0);
+    LOG_ERROR("Upgrade: pid %d exited with status %d before accepting, keep serving", (int)pid,
+              WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status));
+    return false;
+}
+
+void Process::NotifyReady()
+{
+    if (readyFd_ < 0)
+    {
+        return;
+    }
+    char c = 1;
+    ssize_t ret = write(readyFd_, &c, 1);
+    (void)ret;
+    close(readyFd_);
+    readyFd_ = -1;
+}
+
+void Process::InitWorker(int index, int cpu, int listenFd)
+{
+    worker = index;
+    listenFd_ = listenFd;
+    // 新master通知旧master的管道只属于master 否则新master启动失败时旧master收不到EOF
+    if (readyFd_ >= 0)
+    {
+        close(readyFd_);
+        readyFd_ = -1;
+    }
+    // 在创建线程、分配缓存之前绑定 线程继承绑定 内存按首次访问分配在这个CPU的NUMA节点上
+    if (cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+}
+
+int Process::WorkerCpu(int index, const vector<int> &cpus)
+{
+    if (!cpus.empty())
+    {
+        return cpus[index % cpus.size()];
+    }
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+    {
+        return -1;
+    }
+    int count = CPU_COUNT(&allowed);
+    int nth = index % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &allowed) && nth-- == 0)
+        {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+bool Process::PinThread(pthread_t thread, const vector<int> &cpus, const char *name)
+{
+    if (cpus.empty())
+    {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        CPU_SET(cpu, &set);
+    }
+    int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+    if (err != 0)
+    {
+        LOG_WARN("Affinity: pin %s failed: %s", name, strerror(err));
+        return false;
+    }
+    return true;
+}
+
+const char *Process::LogSuffix()
+{
+    static char suffix[32];
+    if (worker < 0)
+    {
+        return ".log";
+    }
+    snprintf(suffix, sizeof(suffix), "-worker%d.log", worker);
+    return suffix;
+}
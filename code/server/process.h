@@ -0,0 +1,62 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/types.h>
+
+/**
+ * 进程相关的操作 单进程模式与多进程模式共用
+ * 监听socket可以来自父进程：热升级时旧进程exec新程序，通过环境变量传递继承的描述符，
+ * 新进程开始accept后写就绪管道，旧进程收到后退出；多进程模式下worker直接使用master fork前创建的socket。
+ * 每个worker一个socket时(SO_REUSEPORT)传递全部socket，新进程的socket数不同时无法继承，需要重启。
+ * 环境变量在Init中读取并清除，之后fork或exec出的进程不会再看到。
+ */
+class Process
+{
+public:
+    // main开始时调用 记录程序路径与参数 升级时/proc/self/exe已指向被替换掉的旧文件
+    static void Init();
+
+    // 监听port 已有监听socket(继承的或master的)时直接使用 失败返回-1
+    static int Listen(int port);
+    // 多进程模式 每个CPU一个设置了SO_REUSEPORT的socket 内核把新连接交给SO_INCOMING_CPU等于处理该连接网卡中断的CPU的socket
+    // 继承的socket数与cpus相同时直接使用 失败返回false
+    static bool ListenPerCpu(int port, const std::vector<int> &cpus, std::vector<int> &fds);
+
+    // 用启动时的程序路径与参数启动新进程 继承listenFds 返回就绪管道的读端 失败返回-1
+    static int Upgrade(const std::vector<int> &listenFds, pid_t &pid);
+    // 就绪管道可读时调用 返回新进程是否就绪 新进程已退出时回收并返回false 关闭readyFd
+    static bool UpgradeReady(int readyFd, pid_t pid);
+    // 热升级启动的新进程开始accept后调用 通知旧进程
+    static void NotifyReady();
+
+    // 多进程模式下fork出的worker在运行服务器之前调用 绑定到cpu(小于0不绑定) 使用listenFd
+    // 之后分配的内存都在这个CPU所在的NUMA节点上
+    static void InitWorker(int index, int cpu, int listenFd);
+    // 第index个worker的CPU cpus为空时取允许使用的第index个CPU(取模) 失败返回-1
+    static int WorkerCpu(int index, const std::vector<int> &cpus);
+    // 把线程绑定到cpus中的CPU cpus为空时不改变 失败时记录日志返回false
+    static bool PinThread(pthread_t thread, const std::vector<int> &cpus, const char *name);
+
+    // 日志文件后缀 worker各写各的文件
+    static const char *LogSuffix();
+
+    // 多进程模式下worker的编号 从0开始 单进程模式与master为-1
+    static int worker;
+
+private:
+    static std::string exePath_;
+    static std::vector<std::string> args_;
+    // 创建并监听socket reusePort时设置SO_REUSEPORT 失败返回-1
+    static int Bind_(int port, bool reusePort);
+    // 检查继承的socket仍在监听 不是时关闭并返回false
+    static bool Adopt_(int fd);
+
+    static std::vector<int> inheritedFds_; // 热升级时继承的监听socket
+    static int readyFd_;     // 热升级时通知旧进程的管道写端
+    static int listenFd_;    // Listen返回的socket worker从master继承
+};
+
+#endif // PROCESS_H
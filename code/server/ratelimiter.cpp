@@ -0,0 +1,153 @@
+#include "ratelimiter.h"
+
+#include <algorithm>
+#include <netinet/in.h>
+#include <string.h>
+#include <time.h>
+
+using namespace std;
+
+static uint64_t MonotonicNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+RateLimiter::RateLimiter(int rate, int burst, int capacity)
+    : interval_(rate > 0 ? max<uint64_t>(1000000 / rate, 1) : 0), burst_(interval_ * max(burst, 1)),
+      epoch_(MonotonicNs()), mask_(0)
+{
+    if (rate <= 0)
+    {
+        return;
+    }
+    size_t ways = 1;
+    while (ways * WAYS < (size_t)capacity)
+    {
+        ways <<= 1;
+    }
+    mask_ = ways - 1;
+    ways_.reset(new Way[ways]);
+    for (size_t i = 0; i < ways; i++)
+    {
+        for (int j = 0; j < WAYS; j++)
+        {
+            ways_[i].keys[j].store(EMPTY, memory_order_relaxed);
+            ways_[i].states[j].store(0, memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t RateLimiter::Key(const sockaddr *addr)
+{
+    // IPv4放在ffff::/16下 与IPv6前缀不会冲突
+    if (addr->sa_family == AF_INET)
+    {
+        const sockaddr_in *in = (const sockaddr_in *)addr;
+        return (0xffffULL << 48) | ntohl(in->sin_addr.s_addr);
+    }
+    if (addr->sa_family == AF_INET6)
+    {
+        const in6_addr &in6 = ((const sockaddr_in6 *)addr)->sin6_addr;
+        if (IN6_IS_ADDR_V4MAPPED(&in6))
+        {
+            uint32_t v4;
+            memcpy(&v4, in6.s6_addr + 12, sizeof(v4));
+            return (0xffffULL << 48) | ntohl(v4);
+        }
+        uint64_t prefix = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            prefix = (prefix << 8) | in6.s6_addr[i];
+        }
+        return prefix;
+    }
+    return 0;
+}
+
+uint64_t RateLimiter::Hash_(uint64_t key)
+{
+    // splitmix64 地址的低位变化也能打散到所有组
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+bool RateLimiter::Take_(atomic<uint64_t> &state, uint64_t tag, uint64_t now, bool &allowed)
+{
+    uint64_t old = state.load(memory_order_relaxed);
+    while (true)
+    {
+        if ((old & 0xffff) != tag)
+        {
+            return false;
+        }
+        // 理论上桶空的时刻 早于now说明令牌已补满
+        uint64_t tat = max(old >> 16, now) + interval_;
+        if (tat - now > burst_)
+        {
+            allowed = false;
+            return true;
+        }
+        if (state.compare_exchange_weak(old, (tat << 16) | tag, memory_order_relaxed))
+        {
+            allowed = true;
+            return true;
+        }
+    }
+}
+
+bool RateLimiter::Allow(uint64_t key, uint64_t now)
+{
+    if (!Enabled())
+    {
+        return true;
+    }
+    uint64_t hash = Hash_(key);
+    size_t index = hash & mask_;
+    uint64_t tag = hash >> 48;
+    now = (now - epoch_) / 1000;
+
+    Way &way = ways_[index];
+    for (int i = 0; i < WAYS; i++)
+    {
+        bool allowed;
+        if (way.keys[i].load(memory_order_acquire) == key && Take_(way.states[i], tag, now, allowed))
+        {
+            return allowed;
+        }
+    }
+    return Insert_(way, index, key, tag, now);
+}
+
+bool RateLimiter::Insert_(Way &way, size_t index, uint64_t key, uint64_t tag, uint64_t now)
+{
+    lock_guard<mutex> locker(shards_[index % SHARDS]);
+    // 加锁前可能已被其他线程插入
+    int victim = 0;
+    uint64_t oldest = UINT64_MAX;
+    for (int i = 0; i < WAYS; i++)
+    {
+        uint64_t k = way.keys[i].load(memory_order_relaxed);
+        bool allowed;
+        if (k == key && Take_(way.states[i], tag, now, allowed))
+        {
+            return allowed;
+        }
+        // 空项的时间戳为0 桶已满的项时间戳不晚于now 都会先于活跃的项被替换
+        uint64_t tat = k == EMPTY ? 0 : way.states[i].load(memory_order_relaxed) >> 16;
+        if (tat < oldest)
+        {
+            oldest = tat;
+            victim = i;
+        }
+    }
+    // 先写状态再写键 无锁的读者看到新键时一定看到新状态 看到旧键与新状态时标签不符
+    way.states[victim].store(((now + interval_) << 16) | tag, memory_order_release);
+    way.keys[victim].store(key, memory_order_release);
+    return true;
+}
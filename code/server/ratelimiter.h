@@ -0,0 +1,60 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sys/socket.h>
+
+/**
+ * 按客户端地址限速的令牌桶 IPv4按地址 IPv6按/64前缀(一个用户通常分到整个/64)
+ * 每个客户端的桶只存一个时间戳(GCRA)：桶内令牌数等价于 (now + burst*T - tat) / T，T为补充一个令牌的间隔，
+ * 检查时按当前时间惰性补充，没有定时器。桶满时的时间戳不携带任何信息，可以随时丢弃。
+ * 哈希表大小固定，组相联：每组4项占一个缓存行，查找只访问一个缓存行。
+ * 已有的客户端无锁查找，CAS更新时间戳；新客户端按组分片加锁插入，组满时替换桶已满的项，
+ * 没有时替换时间戳最小的项(最久没有消耗令牌，近似LRU)，内存不随客户端数增长。
+ * 时间戳由调用者传入，检查本身不读时钟。
+ */
+class RateLimiter
+{
+public:
+    // rate 每秒补充的令牌数 0表示不限速 burst 桶容量 capacity 记录的客户端数 向上取整为2的幂
+    RateLimiter(int rate, int burst, int capacity);
+
+    bool Enabled() const { return ways_ != nullptr; }
+
+    // 消耗一个令牌 桶空时返回false now为单调时钟纳秒
+    bool Allow(uint64_t key, uint64_t now);
+
+    // 客户端地址 -> 键 不支持的地址族返回0
+    static uint64_t Key(const sockaddr *addr);
+
+private:
+    static const int WAYS = 4;
+    static const int SHARDS = 64;
+    static const uint64_t EMPTY = ~0ULL; // ff开头为IPv6组播前缀 不会是源地址
+
+    // 一组 键与状态各4个 状态为 时间戳(微秒)<<16 | 键的标签 标签用于发现并发替换
+    struct alignas(64) Way
+    {
+        std::atomic<uint64_t> keys[WAYS];
+        std::atomic<uint64_t> states[WAYS];
+    };
+
+    static uint64_t Hash_(uint64_t key);
+    // 更新状态为state的桶 成功或桶空时返回true 状态已被替换时返回false
+    bool Take_(std::atomic<uint64_t> &state, uint64_t tag, uint64_t now, bool &allowed);
+    // 加锁插入新客户端
+    bool Insert_(Way &way, size_t index, uint64_t key, uint64_t tag, uint64_t now);
+
+    const uint64_t interval_; // 补充一个令牌的间隔 微秒
+    const uint64_t burst_;    // 桶容量对应的时长 微秒
+    const uint64_t epoch_;    // 时间戳的起点 纳秒
+    size_t mask_;
+    std::unique_ptr<Way[]> ways_;
+    std::mutex shards_[SHARDS]; // 按组分片 只在插入时加锁
+};
+
+#endif // RATE_LIMITER_H
@@ -5,13 +5,98 @@
 #include <unistd.h>
 #include <iostream>
 #include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 using namespace std;
 
-WebServer::WebServer(int port, int timeoutMS, int connPoolNum, int threadNum, bool openLog, int logLevel, int logQueSize,
-                     const char *srcDir, const char *logDir)
-    : port_(port), timeoutMS_(timeoutMS), isClose_(false), srcDir_(srcDir), logDir_(logDir),
-      timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum))
+// 收到SIGUSR1时导出追踪记录 信号处理函数只设置标志 由accept循环执行导出
+static volatile sig_atomic_t dumpTrace = 0;
+
+static const char RESPONSE_429[] = "HTTP/1.1 429 Too Many Requests\r\n"
+                                   "Content-Type: text/html\r\n"
+                                   "Content-Length: 84\r\n"
+                                   "Retry-After: 1\r\n"
+                                   "Connection: close\r\n"
+                                   "\r\n"
+                                   "<html><title>429</title><body><h1>429 Too Many Requests</h1>Slow down</body></html>\n";
+
+static const char RESPONSE_408[] = "HTTP/1.1 408 Request Timeout\r\n"
+                                   "Content-Type: text/html\r\n"
+                                   "Content-Length: 73\r\n"
+                                   "Connection: close\r\n"
+                                   "\r\n"
+                                   "<html><title>408</title><body><h1>408 Request Timeout</h1></body></html>\n";
+
+static void OnDumpSignal(int)
+{
+    dumpTrace = 1;
+}
+
+// 收到SIGTERM/SIGINT时开始关闭 由reactor循环处理
+static volatile sig_atomic_t stopServer = 0;
+
+static void OnStopSignal(int)
+{
+    stopServer = 1;
+}
+
+// 收到SIGUSR2时热升级
+static volatile sig_atomic_t upgradeServer = 0;
+
+static void OnUpgradeSignal(int)
+{
+    upgradeServer = 1;
+}
+
+// 日志中显示的CPU列表 为空时不绑定
+static string CpuList(const vector<int> &cpus)
+{
+    string list;
+    for (int cpu : cpus)
+    {
+        list += (list.empty() ? "" : ",") + to_string(cpu);
+    }
+    return list.empty() ? "unpinned" : list;
+}
+
+// 收到SIGHUP时重新加载配置
+static volatile sig_atomic_t reloadServer = 0;
+
+static void OnReloadSignal(int)
+{
+    reloadServer = 1;
+}
+
+// 查询参数n 缺省或非法时取默认值
+static size_t CountArg(const HttpRequest &request, size_t def)
+{
+    string_view n = request.GetQuery("n");
+    size_t count = 0;
+    for (char c : n)
+    {
+        if (c < '0' || c > '9' || count > 100000)
+        {
+            return def;
+        }
+        count = count * 10 + (c - '0');
+    }
+    return count ? count : def;
+}
+
+WebServer::WebServer(int port, int connPoolNum, int threadNum, bool openLog, int logLevel, int logQueSize,
+                     const char *srcDir, const char *logDir, int fileCacheMaxSize, int fileCacheCapacity,
+                     int maxConnections, int maxQueue, int queueTargetMS, int connRateLimit, int connRateBurst,
+                     int requestRateLimit, int requestRateBurst, int rateLimitClients, const vector<int> &reactorCpus,
+                     const vector<int> &threadPoolCpus, const vector<int> &logCpus)
+    : port_(port), isClose_(false), srcDir_(srcDir), logDir_(logDir),
+      reactorCpus_(reactorCpus), timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum, threadPoolCpus)),
+      admission_(new Admission(maxConnections, maxQueue, queueTargetMS)),
+      connLimiter_(new RateLimiter(connRateLimit, connRateBurst, rateLimitClients)),
+      requestLimiter_(new RateLimiter(requestRateLimit, requestRateBurst, rateLimitClients)), epollFd_(-1),
+      eventFd_(-1), draining_(false), drainStart_(0), drainDeadline_(0), upgradePid_(0), upgradeFd_(-1)
 {
     // srcDir_ = getcwd(nullptr, 256);
     // assert(srcDir_);
@@ -21,10 +106,30 @@ WebServer::WebServer(int port, int timeoutMS, int connPoolNum, int threadNum, bo
 
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
+    HttpConn::limiter = requestLimiter_->Enabled() ? requestLimiter_.get() : nullptr;
+    // 客户端断开后继续写socket不终止进程 由write返回EPIPE
+    signal(SIGPIPE, SIG_IGN);
+    // 不设置SA_RESTART 让阻塞的epoll_wait立即返回
+    struct sigaction sa = {};
+    sa.sa_handler = OnDumpSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, nullptr);
+    sa.sa_handler = OnStopSignal;
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+    sa.sa_handler = OnUpgradeSignal;
+    sigaction(SIGUSR2, &sa, nullptr);
+    sa.sa_handler = OnReloadSignal;
+    sigaction(SIGHUP, &sa, nullptr);
     if (openLog)
     {
         // Log::Instance()->init(logLevel, "./logs", ".log", logQueSize);
-        Log::Instance()->init(logLevel, logDir, ".log", logQueSize);
+        Log::Instance()->init(logLevel, logDir, Process::LogSuffix(), logQueSize);
+        // 写线程在reactor绑定之前创建 不会继承reactor的CPU
+        if (Log::Instance()->WriteThread())
+        {
+            Process::PinThread(Log::Instance()->WriteThread()->native_handle(), logCpus, "log writer");
+        }
         if (isClose_)
         {
             LOG_ERROR("========== Server init error!==========");
@@ -36,8 +141,112 @@ WebServer::WebServer(int port, int timeoutMS, int connPoolNum, int threadNum, bo
             LOG_INFO("LogSys level: %d", logLevel);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
             LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            LOG_INFO("Admission: maxConnections %d, maxQueue %d, queue target %dms", maxConnections, maxQueue,
+                     queueTargetMS);
+            LOG_INFO("RateLimit: %d conn/s burst %d, %d req/s burst %d, %d clients", connRateLimit, connRateBurst,
+                     requestRateLimit, requestRateBurst, rateLimitClients);
+            const Config &config = Config::current();
+            LOG_INFO("Deadlines: keep-alive %dms, header %dms, body %dms + 1s per %d bytes, max header %d bytes",
+                     config.timeoutMS, config.headerTimeoutMS, config.bodyTimeoutMS, config.bodyMinRate,
+                     config.maxHeaderSize);
+            LOG_INFO("Affinity: reactor %s, threadpool %s, log writer %s", CpuList(reactorCpus).c_str(),
+                     CpuList(threadPoolCpus).c_str(), CpuList(logCpus).c_str());
         }
     }
+
+    // 加载小文件缓存 错误页总是缓存
+    FileCache::Instance()->Init(srcDir_, fileCacheMaxSize, fileCacheCapacity);
+    InitRoutes_();
+    InitMetrics_();
+}
+
+void WebServer::InitRoutes_()
+{
+    Router *router = Router::Instance();
+    router->AddAlias("/", "/index.html");
+    for (const char *page : {"/index", "/register", "/login", "/welcome", "/video", "/picture"})
+    {
+        router->AddAlias(page, string(page) + ".html");
+    }
+    // 参数依次为 模式 用户名 密码 操作(1注册 2登录)
+    router->AddCgi("POST", "/api/register", "./resources_cgi/auth.cgi", {"auth", "$username", "$password", "1"});
+    router->AddCgi("POST", "/api/login", "./resources_cgi/auth.cgi", {"auth", "$username", "$password", "2"});
+    // 指标与诊断接口会暴露请求路径与负载情况 只响应本机 远程抓取需经本机的代理或隧道
+    router->AddHandler(
+        "GET", "/metrics", "text/plain; version=0.0.4; charset=utf-8",
+        [](const HttpRequest &, const Router::Match &, string &body)
+        { Metrics::Instance()->Render(body); },
+        true);
+    // 最慢请求的阶段分解 ?n=条数
+    router->AddHandler(
+        "GET", "/debug/slowest", "text/plain; charset=utf-8",
+        [](const HttpRequest &request, const Router::Match &, string &body)
+        { FlightRecorder::Instance()->RenderSlowest(CountArg(request, 20), body); },
+        true);
+    router->AddHandler(
+        "GET", "/debug/trace", "application/json",
+        [](const HttpRequest &request, const Router::Match &, string &body)
+        { FlightRecorder::Instance()->RenderTrace(CountArg(request, 100), body); },
+        true);
+    LOG_INFO("Router: %d routes", (int)router->Size());
+}
+
+void WebServer::InitMetrics_()
+{
+    Metrics *metrics = Metrics::Instance();
+    ThreadPool *pool = threadpool_.get();
+    metrics->AddGauge("webserver_threadpool_queue_depth", "Connections waiting for a worker thread.",
+                      [pool]
+                      { return (double)pool->QueueSize(); });
+    metrics->AddGauge("webserver_log_queue_depth", "Log lines waiting for the async writer.",
+                      []
+                      { return (double)Log::Instance()->QueueSize(); });
+    Admission *admission = admission_.get();
+    metrics->AddGauge("webserver_admission_overloaded", "1 while the queue delay stays above target.",
+                      [admission]
+                      { return admission->Overloaded() ? 1.0 : 0.0; });
+    metrics->AddGauge("webserver_admission_connections", "Open connections, idle, queued or being served.",
+                      [admission]
+                      { return (double)admission->Connections(); });
+}
+
+// 整个写入文件 失败时记录日志
+static bool WriteFile(const char *path, const string &data)
+{
+    FILE *fp = fopen(path, "w");
+    bool ok = fp != nullptr && fwrite(data.data(), 1, data.size(), fp) == data.size();
+    if (fp && fclose(fp) != 0)
+    {
+        ok = false;
+    }
+    if (!ok)
+    {
+        LOG_ERROR("Write %s failed: %s", path, strerror(errno));
+    }
+    return ok;
+}
+
+void WebServer::DumpTrace_()
+{
+    // 最慢的请求与Chrome trace写入日志目录 文件名带进程号与时间
+    FlightRecorder *recorder = FlightRecorder::Instance();
+    char path[512];
+    string out;
+    long now = (long)time(nullptr);
+    snprintf(path, sizeof(path), "%s/slowest-%d-%ld.txt", logDir_, (int)getpid(), now);
+    recorder->RenderSlowest(100, out);
+    if (WriteFile(path, out))
+    {
+        LOG_INFO("Slowest requests dumped to %s", path);
+    }
+
+    out.clear();
+    snprintf(path, sizeof(path), "%s/trace-%d-%ld.json", logDir_, (int)getpid(), now);
+    recorder->RenderTrace(1000, out);
+    if (WriteFile(path, out))
+    {
+        LOG_INFO("Trace dumped to %s", path);
+    }
 }
 
 WebServer::~WebServer()
@@ -45,110 +254,519 @@ WebServer::~WebServer()
     // close(listenFd_);
     isClose_ = true;
     // free(srcDir_);
+    if (epollFd_ >= 0)
+    {
+        close(epollFd_);
+        close(eventFd_);
+    }
 }
 
 void WebServer::Start()
 {
-    int listenfd = socket(AF_INET, SOCK_STREAM, 0);
+    // reactor在这里绑定 之后由reactor分配的连接表与定时器在它的NUMA节点上
+    // 读缓冲来自各工作线程的BufferPool 在取用它的工作线程的节点上 而连接每次分派都可能换一个工作线程
+    // 单进程时跨节点访问不可避免 多进程模式按workerCpus把每个worker限制在一个节点内才能避免
+    Process::PinThread(pthread_self(), reactorCpus_, "reactor");
+    int listenfd = Process::Listen(port_);
     if (listenfd == -1)
     {
-        LOG_ERROR("Create socket error!");
         return;
     }
 
-    struct sockaddr_in bindaddr;
-    bindaddr.sin_family = AF_INET;
-    bindaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    bindaddr.sin_port = htons(port_);
-    if (bind(listenfd, (struct sockaddr *)&bindaddr, sizeof(bindaddr)) == -1)
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    eventFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = {};
+    // 多个进程共享监听socket时(多进程模式、热升级期间) 一个新连接只唤醒其中一个
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.fd = listenfd;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenfd, &ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = eventFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, eventFd_, &ev);
+
+    // 热升级启动的新进程 通知旧进程开始退出
+    Process::NotifyReady();
+
+    // reactor 等待中的连接(新连接、keep-alive空闲、请求头未收完)只占epoll与定时器 不占工作线程
+    struct epoll_event events[MAX_EVENTS];
+    while (!isClose_)
+    {
+        if (upgradeServer)
+        {
+            upgradeServer = 0;
+            Upgrade_(listenfd);
+        }
+        if (reloadServer)
+        {
+            reloadServer = 0;
+            Reload_();
+        }
+        if (stopServer && !draining_)
+        {
+            BeginDrain_(listenfd);
+            listenfd = -1;
+        }
+        if (draining_)
+        {
+            if (users_.empty())
+            {
+                break;
+            }
+            if (drainDeadline_ && Metrics::NowNs() >= drainDeadline_)
+            {
+                ForceClose_();
+                drainDeadline_ = 0;
+            }
+        }
+
+        // 定时器到期的连接在GetNextTick中关闭 最长等待到下次检查排队超时
+        int timeout = timer_->GetNextTick();
+        if (timeout < 0 || timeout > Admission::INTERVAL_MS / 4)
+        {
+            timeout = Admission::INTERVAL_MS / 4;
+        }
+        int n = epoll_wait(epollFd_, events, MAX_EVENTS, timeout);
+        // 工作线程全被占用时排队的连接不会被取出 在这里拒绝排队过久的
+        admission_->Expire(Metrics::NowNs());
+        if (dumpTrace)
+        {
+            dumpTrace = 0;
+            DumpTrace_();
+        }
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == listenfd && listenfd >= 0)
+            {
+                DealListen_(listenfd);
+            }
+            else if (fd == eventFd_)
+            {
+                DealReturn_();
+            }
+            else if (fd == upgradeFd_)
+            {
+                // 新进程已在accept 本进程不再接受连接 处理完已有的连接后退出
+                if (DealUpgrade_())
+                {
+                    stopServer = 1;
+                }
+            }
+            else
+            {
+                DealRead_(fd);
+            }
+        }
+    }
+
+    if (listenfd >= 0)
     {
-        LOG_ERROR("Bind error!");
         close(listenfd);
+    }
+    // 连接都已关闭 工作线程空闲 等待退出后写完日志
+    uint64_t start = Metrics::NowNs();
+    threadpool_->Shutdown();
+    if (draining_)
+    {
+        int left = (int)(((int64_t)drainDeadline_ - (int64_t)start) / 1000000);
+        LOG_INFO("========== Server shutdown ==========");
+        if (!Log::Instance()->Close(max(left, 0)))
+        {
+            fprintf(stderr, "Shutdown: log lines dropped\n");
+        }
+    }
+}
+
+void WebServer::Reload_()
+{
+    shared_ptr<const Config> old = Config::snapshot();
+    shared_ptr<Config> next = old ? old->reload() : nullptr;
+    if (!next)
+    {
+        LOG_ERROR("Reload: invalid configuration, keeping the current one");
         return;
     }
+    string restart = old->restart_fields(*next);
+    if (!restart.empty())
+    {
+        LOG_WARN("Reload: %s changed, takes effect after restart", restart.c_str());
+        next->keep_restart_fields(*old);
+    }
 
-    if (listen(listenfd, SOMAXCONN) == -1)
+    // 之后开始读取配置的请求使用新快照 进行中的请求读到的值保持有效
+    Config::publish(next);
+    Log::Instance()->SetLevel(next->logLevel);
+    admission_->SetLimits(next->maxConnections, next->maxQueue, next->queueTargetMS);
+    if (next->threadNum != old->threadNum)
     {
-        LOG_ERROR("Listen error!");
-        close(listenfd);
+        threadpool_->Resize(next->threadNum);
+    }
+    if (next->fileCacheMaxSize != old->fileCacheMaxSize || next->fileCacheCapacity != old->fileCacheCapacity)
+    {
+        // 重新扫描资源目录可能较慢 不在reactor线程执行
+        size_t maxFileSize = next->fileCacheMaxSize, capacity = next->fileCacheCapacity;
+        threadpool_->AddTask([maxFileSize, capacity]
+                             { FileCache::Instance()->SetLimits(maxFileSize, capacity); });
+    }
+    LOG_INFO("Reload: log level %d, %d threads, keep-alive %dms, header %dms, body %dms, max header %d bytes",
+             next->logLevel, (int)threadpool_->ThreadCount(), next->timeoutMS, next->headerTimeoutMS,
+             next->bodyTimeoutMS, next->maxHeaderSize);
+}
+
+void WebServer::Upgrade_(int listenFd)
+{
+    if (Process::worker >= 0)
+    {
+        LOG_WARN("Upgrade: ignored in worker %d, send SIGUSR2 to the master", Process::worker);
         return;
     }
+    if (draining_ || upgradePid_ > 0)
+    {
+        LOG_WARN("Upgrade: ignored, %s", draining_ ? "shutting down" : "already upgrading");
+        return;
+    }
+    upgradeFd_ = Process::Upgrade({listenFd}, upgradePid_);
+    if (upgradeFd_ < 0)
+    {
+        upgradePid_ = 0;
+        return;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = upgradeFd_;
+    epoll_ctl(epollFd_, EPOLL_CTL_ADD, upgradeFd_, &ev);
+}
 
-    while (!isClose_)
+bool WebServer::DealUpgrade_()
+{
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, upgradeFd_, nullptr);
+    bool ready = Process::UpgradeReady(upgradeFd_, upgradePid_);
+    upgradeFd_ = -1;
+    if (!ready)
+    {
+        upgradePid_ = 0;
+    }
+    return ready;
+}
+
+void WebServer::BeginDrain_(int listenFd)
+{
+    draining_ = true;
+    drainStart_ = Metrics::NowNs();
+    int shutdownTimeoutMS = Config::current().shutdownTimeoutMS;
+    drainDeadline_ = drainStart_ + (uint64_t)shutdownTimeoutMS * 1000000;
+    HttpConn::draining.store(true, memory_order_relaxed);
+    // 热升级时新进程持有同一个socket close不会将其移出epoll 需要显式删除
+    // 没有热升级时 已完成握手、还没有accept的连接被重置
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, listenFd, nullptr);
+    close(listenFd);
+
+    int idle = 0;
+    for (const auto &item : users_)
+    {
+        if (busy_.count(item.first) == 0 && item.second.RequestStart() == 0 && item.second.ToWriteBytes() == 0)
+        {
+            DrainIdle_(item.first);
+            idle++;
+        }
+    }
+    LOG_INFO("Shutdown: %d idle connections, draining %d within %dms", idle, (int)users_.size(), shutdownTimeoutMS);
+}
+
+void WebServer::DrainIdle_(int fd)
+{
+    // 直接关闭时 客户端可能已经发出了下一个请求 只能得到连接重置
+    // 短暂等待 在途的请求照常处理并带Connection: close 之后没有请求的关闭
+    timer_->add(fd, min(Config::current().timeoutMS, DRAIN_IDLE_MS), [this, fd]
+                { CloseConn_(fd); });
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void WebServer::ForceClose_()
+{
+    vector<int> parked;
+    for (const auto &item : users_)
+    {
+        if (busy_.count(item.first))
+        {
+            // 工作线程的读写立即失败 连接交回后关闭
+            shutdown(item.first, SHUT_RDWR);
+        }
+        else
+        {
+            parked.push_back(item.first);
+        }
+    }
+    for (int fd : parked)
+    {
+        timer_->cancel(fd);
+        CloseConn_(fd);
+    }
+    LOG_WARN("Shutdown: deadline reached, closed %d connections, %d still in workers", (int)parked.size(),
+             (int)busy_.size());
+}
+
+void WebServer::DealListen_(int listenFd)
+{
+    while (true)
     {
         struct sockaddr_in clientaddr;
         socklen_t clientaddrlen = sizeof(clientaddr);
-        int clientfd = accept(listenfd, (struct sockaddr *)&clientaddr, &clientaddrlen);
+        int clientfd = accept4(listenFd, (struct sockaddr *)&clientaddr, &clientaddrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (clientfd < 0)
+        {
+            if (errno != EAGAIN && errno != EINTR)
+            {
+                LOG_ERROR("Accept error: %s", strerror(errno));
+            }
+            return;
+        }
+        WEBSERVER_PROBE3(accept, clientfd, ntohl(clientaddr.sin_addr.s_addr), ntohs(clientaddr.sin_port));
 
-        if (clientfd > 0)
+        // 超过该客户端的连接速率 不占用准入名额
+        if (!connLimiter_->Allow(RateLimiter::Key((struct sockaddr *)&clientaddr), Metrics::NowNs()))
         {
-            // 提交到线程池处理，每个连接一个线程
-            threadpool_->AddTask(
-                [clientfd, clientaddr, this]()
-                {
-                    HttpConn client;
-                    client.init(clientfd, clientaddr);
-                    while (client.read(nullptr) > 0 && client.process())
-                    {
-                        client.write(nullptr);
-                        if (!client.IsKeepAlive())
-                            break;
-                    }
-                    close(clientfd);
-                });
-        }
-
-        // if (clientfd == -1)
-        // {
-        //     if (errno != EINTR)
-        //     { // 忽略中断
-        //         LOG_ERROR("Accept error: %s", strerror(errno));
-        //     }
-        //     continue;
-        // }
-
-        // LOG_INFO("Client connected: %d", clientfd);
-
-        // HttpConn client;
-        // client.init(clientfd, clientaddr);
-
-        // // 7. 同步处理请求（阻塞直到完成）
-        // while (client.read(nullptr) > 0)
-        // { // 读取请求
-        //     if (!client.process())
-        //         break; // 处理请求
-        //     if (client.write(nullptr) <= 0)
-        //         break; // 发送响应
-        //     if (!client.IsKeepAlive())
-        //         break; // 非 keep-alive 就断开
-        // }
-
-        // LOG_INFO("Client disconnected: %d", clientfd);
-        // close(clientfd);
-
-        // while (true)
-        // {
-        //     char buf[1024];
-        //     bzero(&buf, sizeof(buf));
-        //     ssize_t read_bytes = read(clientfd, buf, sizeof(buf));
-        //     if (read_bytes > 0)
-        //     {
-        //         std::cout << "message from client fd " << clientfd << "  " << buf << std::endl;
-        //         write(clientfd, buf, sizeof(buf));
-        //     }
-        //     else if (read_bytes == 0)
-        //     {
-        //         std::cout << "client fd " << clientfd << " disconnected" << std::endl;
-        //         close(clientfd);
-        //         break;
-        //     }
-        //     else if (read_bytes == -1)
-        //     {
-        //         close(clientfd);
-        //         return;
-        //     }
-        // }
-    }
-
-    close(listenfd);
+            Metrics::RateLimited(Metrics::LIMIT_CONNECTION);
+            Admission::Refuse(clientfd, RESPONSE_429, sizeof(RESPONSE_429) - 1);
+            close(clientfd);
+            continue;
+        }
+        if (!admission_->Open(clientfd))
+        {
+            close(clientfd);
+            continue;
+        }
+
+        users_[clientfd].init(clientfd, clientaddr);
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.fd = clientfd;
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, clientfd, &ev);
+        // 新连接在请求头时限内没有发送数据时关闭
+        timer_->add(clientfd, Config::current().headerTimeoutMS, [this, clientfd]
+                    { OnTimeout_(clientfd, Metrics::TIMEOUT_IDLE); });
+    }
+}
+
+void WebServer::DealRead_(int fd)
+{
+    timer_->cancel(fd);
+    HttpConn *client = &users_[fd];
+    // 继续发送未写完的响应不经过准入控制 503不能插在响应中间
+    // 其余的过载时不进入队列 直接返回503
+    uint64_t ticket = 0;
+    if (client->ToWriteBytes() == 0)
+    {
+        ticket = admission_->Admit(fd, Metrics::NowNs());
+        if (ticket == 0)
+        {
+            CloseConn_(fd);
+            return;
+        }
+    }
+    busy_.insert(fd);
+    threadpool_->AddTask(
+        [this, client, ticket]()
+        {
+            // 排队过久的已经返回503
+            bool keep = (ticket == 0 || admission_->Dequeue(ticket)) && Serve_(*client);
+            Return_(client->GetFd(), keep);
+        });
+}
+
+void WebServer::DealReturn_()
+{
+    uint64_t count;
+    ssize_t ret = read(eventFd_, &count, sizeof(count));
+    (void)ret;
+    vector<pair<int, bool>> returned;
+    {
+        lock_guard<mutex> locker(returnMtx_);
+        returned.swap(returned_);
+    }
+    for (const auto &item : returned)
+    {
+        busy_.erase(item.first);
+        if (item.second)
+        {
+            Park_(item.first);
+        }
+        else
+        {
+            CloseConn_(item.first);
+        }
+    }
+}
+
+void WebServer::Park_(int fd)
+{
+    const HttpConn &client = users_[fd];
+    uint64_t start = client.RequestStart();
+    bool writing = client.ToWriteBytes() > 0;
+    if (draining_ && start == 0 && !writing)
+    {
+        DrainIdle_(fd);
+        return;
+    }
+    const Config &config = Config::current();
+    int timeout = config.timeoutMS;
+    Metrics::TimeoutPhase phase = Metrics::TIMEOUT_IDLE;
+    if (writing)
+    {
+        // 客户端不接收响应 每次有进展后重新计时
+        phase = Metrics::TIMEOUT_WRITE;
+    }
+    else if (client.IsReadingBody())
+    {
+        // 请求体 初始时限之后每收到bodyMinRate字节延长1秒 慢速发送的客户端最终超时
+        timeout = (int)(((int64_t)client.BodyDeadline() - (int64_t)Metrics::NowNs()) / 1000000);
+        phase = Metrics::TIMEOUT_BODY;
+    }
+    else if (start)
+    {
+        // 请求头未收完时从第一批数据起计时 否则为keep-alive空闲
+        timeout = config.headerTimeoutMS - (int)((Metrics::NowNs() - start) / 1000000);
+        phase = Metrics::TIMEOUT_HEADER;
+    }
+    if (timeout <= 0)
+    {
+        OnTimeout_(fd, phase);
+        return;
+    }
+    timer_->add(fd, timeout, [this, fd, phase]
+                { OnTimeout_(fd, phase); });
+    // EPOLLONESHOT 重新注册 已有数据或已可写时立即触发
+    // 等待可写时不关注EPOLLRDHUP 对端只关闭写方向时仍可接收响应
+    struct epoll_event ev = {};
+    ev.events = (writing ? EPOLLOUT : EPOLLIN | EPOLLRDHUP) | EPOLLONESHOT;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void WebServer::OnTimeout_(int fd, Metrics::TimeoutPhase phase)
+{
+    Metrics::Timeout(phase);
+    if (phase == Metrics::TIMEOUT_HEADER || phase == Metrics::TIMEOUT_BODY)
+    {
+        Admission::Refuse(fd, RESPONSE_408, sizeof(RESPONSE_408) - 1);
+    }
+    CloseConn_(fd);
+}
+
+void WebServer::CloseConn_(int fd)
+{
+    // 关闭fd时自动从epoll中移除
+    users_[fd].Close();
+    users_.erase(fd);
+    admission_->Close();
+}
+
+void WebServer::Return_(int fd, bool keep)
+{
+    {
+        lock_guard<mutex> locker(returnMtx_);
+        returned_.emplace_back(fd, keep);
+    }
+    uint64_t one = 1;
+    ssize_t ret = write(eventFd_, &one, sizeof(one));
+    (void)ret;
+}
+
+// 等待fd可读或可写 到达截止时间(单调时钟纳秒)时返回false
+static bool WaitFd(int fd, short events, uint64_t deadline)
+{
+    while (true)
+    {
+        uint64_t now = Metrics::NowNs();
+        if (now >= deadline)
+        {
+            return false;
+        }
+        struct pollfd pfd = {fd, events, 0};
+        int ret = poll(&pfd, 1, (int)((deadline - now + 999999) / 1000000));
+        if (ret > 0)
+        {
+            return true;
+        }
+        if (ret < 0 && errno != EINTR)
+        {
+            return false;
+        }
+    }
+}
+
+WebServer::FlushResult WebServer::Flush_(HttpConn &client)
+{
+    while (client.ToWriteBytes() > 0)
+    {
+        int err = 0;
+        if (client.write(&err) < 0)
+        {
+            return err == EAGAIN ? FLUSH_AGAIN : FLUSH_ERROR;
+        }
+    }
+    return FLUSH_DONE;
+}
+
+bool WebServer::Serve_(HttpConn &client)
+{
+    bool responded = false;
+    while (true)
+    {
+        // 先发送已生成的响应 包括读取请求体前的100 Continue
+        // 客户端不接收时交回reactor等待可写 不占用工作线程
+        FlushResult flushed = Flush_(client);
+        if (flushed != FLUSH_DONE)
+        {
+            return flushed == FLUSH_AGAIN;
+        }
+        // 流式响应 交替发送与读取生产者 发送失败时结束生产者
+        if (client.IsStreaming())
+        {
+            client.pump();
+            continue;
+        }
+        if (client.IsClosing())
+        {
+            return false;
+        }
+
+        int err = 0;
+        ssize_t len = client.read(&err);
+        if (len == 0 || (len < 0 && err != EAGAIN))
+        {
+            return false; // 对端关闭或出错
+        }
+        // 一次读取可能包含多个流水线请求 也可能不足一个请求 流式响应或要关闭连接时先发送
+        bool processed = false;
+        while (!client.IsStreaming() && !client.IsClosing() && client.process())
+        {
+            processed = true;
+        }
+        if (processed)
+        {
+            responded = true;
+            continue;
+        }
+        if (len > 0 || client.ToWriteBytes() > 0)
+        {
+            continue;
+        }
+
+        // 请求头或请求体不完整 交回reactor 由定时器限制时间 慢速发送的客户端不会占用工作线程
+        if (client.IsReadingBody())
+        {
+            return true;
+        }
+        // 刚响应完且没有其他连接等待线程时 稍等后续数据(下一个请求或流水线请求的剩余部分) 省去交回reactor再分派的开销
+        if (!responded || threadpool_->QueueSize() > 0 ||
+            !WaitFd(client.GetFd(), POLLIN, Metrics::NowNs() + LINGER_MS * 1000000))
+        {
+            return true;
+        }
+        responded = false;
+    }
 }
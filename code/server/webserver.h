@@ -2,6 +2,8 @@
 #define WEBSERVER_H
 
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <fcntl.h>  // fcntl()
 #include <unistd.h> // close()
 #include <assert.h>
@@ -14,50 +16,126 @@
 #include "../timer/heaptimer.h"
 #include "../pool/threadpool.h"
 #include "../http/httpconn.h"
+#include "../http/filecache.h"
+#include "../http/router.h"
+#include "../metrics/metrics.h"
+#include "../metrics/flightrecorder.h"
+#include "admission.h"
+#include "ratelimiter.h"
+#include "process.h"
+#include "../config/config.h"
 
 class WebServer
 {
 public:
     WebServer(
         int port,        // 端口
-        int timeoutMS,   // 超时事件
         int connPoolNum, // 连接池数量
         int threadNum,   // 线程池数量
         bool openLog,    // 日志开关
         int logLevel,    // 日志等级
         int logQueSize,  // 日志异步队列容量
         const char *srcDir,
-        const char *logDir);
+        const char *logDir,
+        int fileCacheMaxSize,   // 小文件缓存 单个文件大小上限
+        int fileCacheCapacity,  // 小文件缓存 总容量
+        int maxConnections,     // 同时存在的连接数上限
+        int maxQueue,           // 等待工作线程的连接数上限
+        int queueTargetMS,      // 过载时连接允许排队的时间
+        int connRateLimit,      // 每个客户端每秒新连接数 0不限制
+        int connRateBurst,
+        int requestRateLimit,   // 每个客户端每秒请求数 0不限制
+        int requestRateBurst,
+        int rateLimitClients,   // 限速记录的客户端数
+        const std::vector<int> &reactorCpus,    // reactor线程绑定的CPU 为空不绑定
+        const std::vector<int> &threadPoolCpus, // 工作线程依次绑定的CPU
+        const std::vector<int> &logCpus);       // 日志写线程绑定的CPU
     ~WebServer();
     void Start();
 
-    // void DealListen_();
-    // void DealWrite_(HttpConn* client);
-    // void DealRead_(HttpConn* client);
+private:
+    // 以下在reactor线程调用
+    // SIGUSR2 用启动时的程序路径(可能已替换为新版本)启动新进程 继承监听socket
+    // 新进程开始accept后本进程按SIGTERM的流程退出 新进程启动失败时继续服务 多进程模式下由master处理
+    void Upgrade_(int listenFd);
+    // SIGHUP 重新读取配置文件 发布新快照 调整线程池、缓存与准入控制 进行中的请求不受影响
+    void Reload_();
+    // 新进程就绪或启动失败 返回是否就绪
+    bool DealUpgrade_();
+    // 接受所有等待的连接 注册到epoll 等待第一个请求
+    void DealListen_(int listenFd);
+    // 连接可读或可写 交给线程池处理
+    void DealRead_(int fd);
+    // 处理工作线程交回的连接
+    void DealReturn_();
+    // 连接等待客户端 响应未写完时等待可写 否则等待下一批数据 按所处阶段设置时限
+    void Park_(int fd);
+    void OnTimeout_(int fd, Metrics::TimeoutPhase phase);
+    void CloseConn_(int fd);
+    // SIGTERM 停止接受连接 所有连接的下一个响应带Connection: close 之后关闭
+    void BeginDrain_(int listenFd);
+    // 关闭时空闲的keep-alive连接 等待DRAIN_IDLE_MS内可能已在途的请求
+    void DrainIdle_(int fd);
+    // 到达时限 关闭剩余的连接 处理中的连接关闭读写两个方向 由工作线程交回后关闭
+    void ForceClose_();
 
-    // void SendError_(int fd, const char*info);
-    // void ExtentTime_(HttpConn* client);
-    // void CloseConn_(HttpConn* client);
+    // 以下在工作线程调用
+    // 读取并处理请求 返回true表示连接保持 交回reactor等待数据或等待可写
+    bool Serve_(HttpConn &client);
+    enum FlushResult
+    {
+        FLUSH_DONE,
+        FLUSH_AGAIN, // socket发送缓冲区已满 剩余部分等可写时再发送
+        FLUSH_ERROR,
+    };
+    // 写出已生成的响应 不等待客户端接收
+    FlushResult Flush_(HttpConn &client);
+    // 处理完毕 交回reactor线程 keep为false时关闭
+    void Return_(int fd, bool keep);
 
-    // void OnRead_(HttpConn* client);
-    // void OnWrite_(HttpConn* client);
-    // void OnProcess(HttpConn* client);
 
-private:
+    // 注册默认路由 页面别名、登录注册的CGI与/metrics
+    static void InitRoutes_();
+    // 注册抓取时求值的指标
+    void InitMetrics_();
+    // SIGUSR1 导出最慢的请求与Chrome trace到日志目录
+    void DumpTrace_();
+
     // 端口
     int port_;
     // 优雅退出
     bool openLinger_;
-    // 超时时间
-    int timeoutMS_;
+    // 时限、请求头与请求体的上限等可重新加载的配置每次从Config::current()读取
     bool isClose_;
     int listenFd_;
     // char* srcDir_;
     const char *srcDir_;
     const char *logDir_;
+    std::vector<int> reactorCpus_;
     std::unique_ptr<HeapTimer> timer_;
     std::unique_ptr<ThreadPool> threadpool_;
+    std::unique_ptr<Admission> admission_;
+    std::unique_ptr<RateLimiter> connLimiter_;
+    std::unique_ptr<RateLimiter> requestLimiter_;
+    // 只由reactor线程增删 交给工作线程期间由工作线程独占
     std::unordered_map<int, HttpConn> users_;
+    std::unordered_set<int> busy_; // 已交给工作线程的连接
+    int epollFd_;
+    // 工作线程交回的连接 写eventFd_唤醒reactor
+    int eventFd_;
+    std::mutex returnMtx_;
+    std::vector<std::pair<int, bool>> returned_;
+    // 收到SIGTERM后正在关闭
+    bool draining_;
+    uint64_t drainStart_;
+    uint64_t drainDeadline_; // 0表示已强制关闭
+    // 热升级启动的新进程
+    pid_t upgradePid_;
+    int upgradeFd_; // 新进程就绪时写入一个字节 退出时关闭
+
+    static const int MAX_EVENTS = 1024;
+    static const int LINGER_MS = 2; // 响应后在工作线程中等待下一个请求的时间
+    static const int DRAIN_IDLE_MS = 100;
 };
 
 #endif // WEBSERVER_H
\ No newline at end of file
@@ -3,16 +3,16 @@
 void HeapTimer::siftup_(size_t i)
 {
     assert(i >= 0 && i < heap_.size());
-    size_t j = (i - 1) / 2;
-    while (j >= 0)
+    // 到达堆顶时结束 size_t的父节点下标不能用j >= 0判断
+    while (i > 0)
     {
+        size_t j = (i - 1) / 2;
         if (heap_[j] < heap_[i])
         {
             break;
         }
         SwapNode_(i, j);
         i = j;
-        j = (i - 1) / 2;
     }
 }
 
@@ -82,6 +82,15 @@ void HeapTimer::doWork(int id)
     del_(i);
 }
 
+void HeapTimer::cancel(int id)
+{
+    auto it = ref_.find(id);
+    if (it != ref_.end())
+    {
+        del_(it->second);
+    }
+}
+
 void HeapTimer::del_(size_t index)
 {
     /* 删除指定位置的结点 */
@@ -39,6 +39,9 @@ public:
 
     void doWork(int id);
 
+    // 删除指定id的结点 不触发回调
+    void cancel(int id);
+
     void clear();
 
     void tick();